@@ -0,0 +1,517 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         bench_circ_buff.c
+ *
+ * Description:  Benchmarks for the circular buffers in this directory.
+ *               Results are printed to stdout as CSV, one row per run:
+ *               benchmark,threads,capacity,ops,seconds,mops,gbps,p50_ns,p99_ns,p999_ns
+ *               Columns that do not apply to a benchmark are left empty.
+ *
+ *               single_write_read  - circ_buff_write/circ_buff_read, one
+ *                                    element at a time, filling and draining
+ *                                    the whole ring.
+ *               bulk_transfer      - circ_buff_write_n/circ_buff_read_n in
+ *                                    BULK_CHUNK element batches; gbps counts
+ *                                    the bytes that went through the ring.
+ *               spsc_round_trip    - one element bounced between two threads
+ *                                    over a pair of spsc rings; percentiles 
+ *                                    of the round trip time.
+ *               scan_sum_<isa>,    - circ_buff_sum/circ_buff_find over a full
+ *               scan_find_<isa>      ring, for each SIMD flavour supported.
+ *               mpmc_scaling       - see bench_mpmc_scaling.
+ *               shard_scaling      - see bench_shard_scaling.
+ *
+ *               All but the scaling rows run for every capacity from L1 sized 
+ *               (MIN_CAPACITY elements) to DRAM sized (MAX_CAPACITY).
+ *
+ * Usage:        ./bench_circ_buff [max_threads]
+ *               make bench writes the CSV to bench_results.csv.
+ *
+ * */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
+#include<stdatomic.h>
+#include<pthread.h>
+#include<sched.h>
+#include<time.h>
+#include "circ_buff.h"
+#include "circ_buff_spsc.h"
+#include "circ_buff_mpmc.h"
+#include "circ_buff_stats.h"
+#include "circ_buff_scan.h"
+#include "circ_buff_shard.h"
+
+#define MPMC_BENCH_SIZE 1024
+#define MPMC_BENCH_OPS  (1u<<22)
+#define DEFAULT_MAX_THREADS 8
+/*scaling consumers count locally and publish to bench_consumed this often*/
+#define BENCH_COUNT_BATCH 64
+
+/*4 KiB of elements up to 64 MiB, in steps of four*/
+#define MIN_CAPACITY (1u<<10)
+#define MAX_CAPACITY (1u<<24)
+
+/*elements pushed through the ring for every capacity*/
+#define SINGLE_OPS  (1u<<25)
+#define BULK_OPS    (1u<<27)
+#define BULK_CHUNK  4096
+#define ROUND_TRIPS 20000
+#define SCAN_OPS    (1u<<28)
+
+/*keeps the reads from being optimised away*/
+static volatile uint32_t bench_sink;
+
+
+/*returns a monotonic timestamp in seconds*/
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec+ts.tv_nsec*1e-9;
+}
+
+/*prints one CSV row without the bandwidth and latency columns*/
+static void report(const char* name, uint32_t threads, uint32_t capacity, uint64_t ops, double seconds)
+{
+    printf("%s,%u,%u,%llu,%.6f,%.3f,,,,\n", name, threads, capacity,
+           (unsigned long long)ops, seconds, ops/seconds/1e6);
+    fflush(stdout);
+}
+
+
+/*
+ * Function:     bench_single(uint32_t capacity)
+ * -----------------------------------------------------------------------------
+ * Description:  Fills the ring with circ_buff_write and drains it with
+ *               circ_buff_read until SINGLE_OPS elements have gone through,
+ *               so every slot of the storage is touched on every pass.
+ * ----------------------------------------------------------------------------
+ */
+static void bench_single(uint32_t capacity)
+{
+    circ_buff_ptr cb=NULL;
+    uint32_t pass, index, data, sum=0;
+
+    if(circ_buff_init(&cb, capacity)!=CIRC_BUFF_SUCCESS)
+         return;
+
+    /*one untimed pass to fault the storage in*/
+    for(index=0; index<capacity; index++)
+         circ_buff_write(cb, index);
+    for(index=0; index<capacity; index++)
+         circ_buff_read(cb, &data);
+
+    uint32_t passes=SINGLE_OPS/capacity ? SINGLE_OPS/capacity : 1;
+    double start=now_seconds();
+    for(pass=0; pass<passes; pass++)
+    {
+         for(index=0; index<capacity; index++)
+              circ_buff_write(cb, index);
+         for(index=0; index<capacity; index++)
+         {
+              circ_buff_read(cb, &data);
+              sum+=data;
+         }
+    }
+    double seconds=now_seconds()-start;
+    bench_sink=sum;
+
+    /*a write and a read per element*/
+    report("single_write_read", 1, capacity, 2ull*passes*capacity, seconds);
+    circ_buff_destroy(cb);
+}
+
+
+/*
+ * Function:     bench_bulk(uint32_t capacity)
+ * -----------------------------------------------------------------------------
+ * Description:  Moves BULK_OPS elements through the ring with write_n/read_n,
+ *               filling it completely before draining it.
+ * ----------------------------------------------------------------------------
+ */
+static void bench_bulk(uint32_t capacity)
+{
+    circ_buff_ptr cb=NULL;
+    uint32_t *chunk=malloc(sizeof(uint32_t)*BULK_CHUNK);
+    uint32_t index, moved;
+    uint64_t total=0;
+
+    if(chunk==NULL||circ_buff_init(&cb, capacity)!=CIRC_BUFF_SUCCESS)
+    {
+         free(chunk);
+         return;
+    }
+    for(index=0; index<BULK_CHUNK; index++)
+         chunk[index]=index;
+
+    uint32_t chunk_size=capacity<BULK_CHUNK ? capacity : BULK_CHUNK;
+    double start=now_seconds();
+    while(total<BULK_OPS)
+    {
+         while(circ_buff_write_n(cb, chunk, chunk_size, &moved)==CIRC_BUFF_SUCCESS&&moved==chunk_size)
+              ;
+         while(circ_buff_read_n(cb, chunk, chunk_size, &moved)==CIRC_BUFF_SUCCESS&&moved!=0)
+              total+=moved;
+    }
+    double seconds=now_seconds()-start;
+    bench_sink=chunk[0];
+
+    /*each element is written once and read once*/
+    printf("bulk_transfer,1,%u,%llu,%.6f,%.3f,%.3f,,,\n", capacity, (unsigned long long)(2*total), seconds,
+           2*total/seconds/1e6, 2*total*sizeof(uint32_t)/seconds/1e9);
+    fflush(stdout);
+
+    circ_buff_destroy(cb);
+    free(chunk);
+}
+
+
+/*
+ * Function:     bench_scan(uint32_t capacity)
+ * -----------------------------------------------------------------------------
+ * Description:  Runs circ_buff_sum and a circ_buff_find that never matches 
+ *               over a full, wrapped ring with each kernel flavour this CPU
+ *               supports; gbps counts the bytes scanned.
+ * ----------------------------------------------------------------------------
+ */
+static void bench_scan(uint32_t capacity)
+{
+    static const circ_buff_scan_isa isas[3]={CIRC_BUFF_SCAN_SCALAR, CIRC_BUFF_SCAN_SSE4, CIRC_BUFF_SCAN_AVX2};
+    static const char* const names[3][2]={{"scan_sum_scalar", "scan_find_scalar"}, {"scan_sum_sse4", "scan_find_sse4"},
+                                          {"scan_sum_avx2", "scan_find_avx2"}};
+    circ_buff_ptr cb=NULL;
+    uint32_t index, pass, data, position=0;
+    uint64_t sum=0;
+
+    if(circ_buff_init(&cb, capacity)!=CIRC_BUFF_SUCCESS)
+         return;
+
+    /*start half way round so the contents wrap*/
+    for(index=0; index<capacity/2; index++)
+    {
+         circ_buff_write(cb, 0);
+         circ_buff_read(cb, &data);
+    }
+    for(index=0; index<capacity; index++)
+         circ_buff_write(cb, index&0xffff);
+
+    uint32_t passes=SCAN_OPS/capacity;
+    for(index=0; index<3; index++)
+    {
+         if(circ_buff_scan_select(isas[index])!=CIRC_BUFF_SUCCESS)
+              continue;
+
+         double start=now_seconds();
+         for(pass=0; pass<passes; pass++)
+              circ_buff_sum(cb, &sum);
+         double seconds=now_seconds()-start;
+         bench_sink=(uint32_t)sum;
+         printf("%s,1,%u,%llu,%.6f,%.3f,%.3f,,,\n", names[index][0], capacity, (unsigned long long)passes*capacity, seconds,
+                (double)passes*capacity/seconds/1e6, (double)passes*capacity*sizeof(uint32_t)/seconds/1e9);
+
+         start=now_seconds();
+         for(pass=0; pass<passes; pass++)
+              circ_buff_find(cb, 0x10000, &position);
+         seconds=now_seconds()-start;
+         bench_sink=position;
+         printf("%s,1,%u,%llu,%.6f,%.3f,%.3f,,,\n", names[index][1], capacity, (unsigned long long)passes*capacity, seconds,
+                (double)passes*capacity/seconds/1e6, (double)passes*capacity*sizeof(uint32_t)/seconds/1e9);
+         fflush(stdout);
+    }
+    circ_buff_scan_select(CIRC_BUFF_SCAN_AUTO);
+
+    circ_buff_destroy(cb);
+}
+
+
+/*the two rings of the round trip run: ping goes out, pong comes back*/
+static circ_buff_spsc_ptr bench_ping, bench_pong;
+
+static void* spsc_echo(void* arg)
+{
+    uint32_t trips=(uint32_t)(uintptr_t)arg, index, data;
+
+    for(index=0; index<trips; index++)
+    {
+         circ_buff_spsc_read_wait(bench_ping, &data, -1);
+         circ_buff_spsc_write_wait(bench_pong, data, -1);
+    }
+    return NULL;
+}
+
+/*
+ * Function:     bench_round_trip(uint32_t capacity)
+ * -----------------------------------------------------------------------------
+ * Description:  Bounces one element at a time between this thread and an echo
+ *               thread through two spsc rings of 'capacity' elements. The
+ *               run is at least ROUND_TRIPS and at least two laps of the
+ *               ring, so the indices walk the whole storage and large rings
+ *               keep hitting cold lines. The blocking calls are used so the
+ *               run also works when both threads share one cpu.
+ * ----------------------------------------------------------------------------
+ */
+static void bench_round_trip(uint32_t capacity)
+{
+    static circ_buff_stats latency;
+    pthread_t echo;
+    uint32_t index, data;
+    uint32_t trips=(2*capacity>ROUND_TRIPS) ? 2*capacity : ROUND_TRIPS;
+
+    if(circ_buff_spsc_init(&bench_ping, capacity)!=CIRC_BUFF_SUCCESS)
+         return;
+    if(circ_buff_spsc_init(&bench_pong, capacity)!=CIRC_BUFF_SUCCESS)
+    {
+         circ_buff_spsc_destroy(bench_ping);
+         return;
+    }
+    memset(&latency, 0, sizeof(latency));
+    pthread_create(&echo, NULL, spsc_echo, (void*)(uintptr_t)trips);
+
+    double start=now_seconds();
+    for(index=0; index<trips; index++)
+    {
+         uint64_t sent=circ_buff_stats_now();
+         circ_buff_spsc_write_wait(bench_ping, index, -1);
+         circ_buff_spsc_read_wait(bench_pong, &data, -1);
+         circ_buff_stats_record(&latency, circ_buff_stats_now()-sent);
+    }
+    double seconds=now_seconds()-start;
+    pthread_join(echo, NULL);
+    bench_sink=data;
+
+    /*two writes and two reads per round trip*/
+    printf("spsc_round_trip,2,%u,%llu,%.6f,%.3f,,%llu,%llu,%llu\n", capacity, 4ull*trips, seconds,
+           4.0*trips/seconds/1e6,
+           (unsigned long long)circ_buff_stats_percentile(&latency, 50),
+           (unsigned long long)circ_buff_stats_percentile(&latency, 99),
+           (unsigned long long)circ_buff_stats_percentile(&latency, 99.9));
+    fflush(stdout);
+
+    circ_buff_spsc_destroy(bench_ping);
+    circ_buff_spsc_destroy(bench_pong);
+}
+
+
+/*shared state of the mpmc scaling run*/
+static circ_buff_mpmc_ptr bench_mpmc;
+static uint32_t bench_per_thread;
+static _Atomic uint64_t bench_consumed;
+static _Atomic int bench_go;
+static uint64_t bench_total;
+
+static void* mpmc_bench_producer(void* arg)
+{
+    uint32_t index;
+    (void)arg;
+
+    while(!atomic_load_explicit(&bench_go, memory_order_acquire))
+         ;
+    for(index=0; index<bench_per_thread; index++)
+    {
+         while(circ_buff_mpmc_write(bench_mpmc, index)==CIRC_BUFF_FULL)
+              sched_yield();
+    }
+    return NULL;
+}
+
+/*
+ * Function:     bench_count(uint32_t* local, int idle)
+ * -----------------------------------------------------------------------------
+ * Description:  Shared by the consumers of both scaling runs. Counts one
+ *               element read into *local, or with 'idle' set, an empty read,
+ *               and publishes the local count every BENCH_COUNT_BATCH elements
+ *               and whenever the consumer goes idle, so that the shared
+ *               counter costs every queue the same.
+ * ----------------------------------------------------------------------------
+ */
+static inline void bench_count(uint32_t* local, int idle)
+{
+    if(!idle&&++*local<BENCH_COUNT_BATCH)
+         return;
+    if(*local>0)
+         atomic_fetch_add_explicit(&bench_consumed, *local, memory_order_relaxed);
+    *local=0;
+    if(idle)
+         sched_yield();
+}
+
+static void* mpmc_bench_consumer(void* arg)
+{
+    uint32_t data, local=0;
+    (void)arg;
+
+    while(!atomic_load_explicit(&bench_go, memory_order_acquire))
+         ;
+    while(atomic_load_explicit(&bench_consumed, memory_order_relaxed)<bench_total)
+         bench_count(&local, circ_buff_mpmc_read(bench_mpmc, &data)!=CIRC_BUFF_SUCCESS);
+    return NULL;
+}
+
+/*
+ * Function:     bench_mpmc_scaling(uint32_t max_threads)
+ * -----------------------------------------------------------------------------
+ * Description:  Runs 1..max_threads producers against as many consumers on
+ *               one mpmc buffer and reports total operations per second.
+ *               The total number of elements is fixed so every row moves the
+ *               same amount of data.
+ * ----------------------------------------------------------------------------
+ */
+static void bench_mpmc_scaling(uint32_t max_threads)
+{
+    pthread_t *producers=malloc(sizeof(pthread_t)*max_threads);
+    pthread_t *consumers=malloc(sizeof(pthread_t)*max_threads);
+    uint32_t threads, index;
+
+    if(producers==NULL||consumers==NULL)
+    {
+         free(producers);
+         free(consumers);
+         return;
+    }
+
+    for(threads=1; threads<=max_threads; threads++)
+    {
+         if(circ_buff_mpmc_init(&bench_mpmc, MPMC_BENCH_SIZE)!=CIRC_BUFF_SUCCESS)
+              break;
+
+         bench_per_thread=MPMC_BENCH_OPS/threads;
+         bench_total=(uint64_t)bench_per_thread*threads;
+         atomic_store(&bench_consumed, 0);
+         atomic_store(&bench_go, 0);
+
+         for(index=0; index<threads; index++)
+         {
+              pthread_create(&consumers[index], NULL, mpmc_bench_consumer, NULL);
+              pthread_create(&producers[index], NULL, mpmc_bench_producer, NULL);
+         }
+
+         double start=now_seconds();
+         atomic_store_explicit(&bench_go, 1, memory_order_release);
+         for(index=0; index<threads; index++)
+         {
+              pthread_join(producers[index], NULL);
+              pthread_join(consumers[index], NULL);
+         }
+         double seconds=now_seconds()-start;
+
+         /*a write and a read per element*/
+         report("mpmc_scaling", threads, bench_mpmc->total_size, 2*bench_total, seconds);
+         circ_buff_mpmc_destroy(bench_mpmc);
+    }
+
+    free(producers);
+    free(consumers);
+}
+
+/*shared state of the sharded scaling run; producer n writes shard n*/
+static circ_buff_shard_ptr bench_shard;
+
+static void* shard_bench_producer(void* arg)
+{
+    uint32_t shard=(uint32_t)(uintptr_t)arg, index;
+
+    while(!atomic_load_explicit(&bench_go, memory_order_acquire))
+         ;
+    for(index=0; index<bench_per_thread; index++)
+    {
+         while(circ_buff_shard_write(bench_shard, shard, index)==CIRC_BUFF_FULL)
+              sched_yield();
+    }
+    return NULL;
+}
+
+static void* shard_bench_consumer(void* arg)
+{
+    uint32_t consumer=(uint32_t)(uintptr_t)arg, data, local=0;
+
+    while(!atomic_load_explicit(&bench_go, memory_order_acquire))
+         ;
+    while(atomic_load_explicit(&bench_consumed, memory_order_relaxed)<bench_total)
+         bench_count(&local, circ_buff_shard_read(bench_shard, consumer, &data)!=CIRC_BUFF_SUCCESS);
+    return NULL;
+}
+
+/*
+ * Function:     bench_shard_scaling(uint32_t max_threads)
+ * -----------------------------------------------------------------------------
+ * Description:  The same run as bench_mpmc_scaling on a sharded buffer with 
+ *               one shard per producer and one home shard per consumer, so
+ *               the two rows can be compared thread count by thread count.
+ * ----------------------------------------------------------------------------
+ */
+static void bench_shard_scaling(uint32_t max_threads)
+{
+    pthread_t *producers=malloc(sizeof(pthread_t)*max_threads);
+    pthread_t *consumers=malloc(sizeof(pthread_t)*max_threads);
+    uint32_t threads, index;
+
+    if(producers==NULL||consumers==NULL)
+    {
+         free(producers);
+         free(consumers);
+         return;
+    }
+
+    for(threads=1; threads<=max_threads; threads++)
+    {
+         if(circ_buff_shard_init(&bench_shard, threads, MPMC_BENCH_SIZE, threads)!=CIRC_BUFF_SUCCESS)
+              break;
+
+         bench_per_thread=MPMC_BENCH_OPS/threads;
+         bench_total=(uint64_t)bench_per_thread*threads;
+         atomic_store(&bench_consumed, 0);
+         atomic_store(&bench_go, 0);
+
+         for(index=0; index<threads; index++)
+         {
+              pthread_create(&consumers[index], NULL, shard_bench_consumer, (void*)(uintptr_t)index);
+              pthread_create(&producers[index], NULL, shard_bench_producer, (void*)(uintptr_t)index);
+         }
+
+         double start=now_seconds();
+         atomic_store_explicit(&bench_go, 1, memory_order_release);
+         for(index=0; index<threads; index++)
+         {
+              pthread_join(producers[index], NULL);
+              pthread_join(consumers[index], NULL);
+         }
+         double seconds=now_seconds()-start;
+
+         report("shard_scaling", threads, bench_shard->total_size, 2*bench_total, seconds);
+         circ_buff_shard_destroy(bench_shard);
+    }
+
+    free(producers);
+    free(consumers);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t max_threads=DEFAULT_MAX_THREADS;
+
+    if(argc>1)
+         max_threads=(uint32_t)strtoul(argv[1], NULL, 10);
+    if(max_threads==0)
+         max_threads=1;
+
+    printf("benchmark,threads,capacity,ops,seconds,mops,gbps,p50_ns,p99_ns,p999_ns\n");
+
+    uint32_t capacity;
+    for(capacity=MIN_CAPACITY; capacity<=MAX_CAPACITY; capacity<<=2)
+         bench_single(capacity);
+    for(capacity=MIN_CAPACITY; capacity<=MAX_CAPACITY; capacity<<=2)
+         bench_bulk(capacity);
+    for(capacity=MIN_CAPACITY; capacity<=MAX_CAPACITY; capacity<<=2)
+         bench_round_trip(capacity);
+    for(capacity=MIN_CAPACITY; capacity<=MAX_CAPACITY; capacity<<=2)
+         bench_scan(capacity);
+
+    bench_mpmc_scaling(max_threads);
+    bench_shard_scaling(max_threads);
+
+    return 0;
+}
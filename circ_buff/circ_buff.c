@@ -10,22 +10,265 @@
  * */
 
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include "circ_buff.h"
 #include<stdint.h>
+#include<stddef.h>
 #include<stdlib.h>
 #include<stdio.h>
 #include<inttypes.h>
+#include<string.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<sys/uio.h>
 
 
 
 
+#ifdef CIRC_BUFF_STATS
+/*								                
+ * Function:     circ_buff_stats_wrote(circ_buff_ptr cb, uint32_t tail, uint32_t count)
+ * -----------------------------------------------------------------------------
+ * Description:  Stamps the 'count' slots written from index 'tail' on and 
+ *               counts them.
+ * ----------------------------------------------------------------------------
+ */
+static inline void circ_buff_stats_wrote(circ_buff_ptr cb, uint32_t tail, uint32_t count)
+{
+    uint64_t now=circ_buff_stats_now();
+    uint32_t index;
+
+    for(index=0; index<count; index++)
+         cb->stamps[(tail+index)&cb->mask]=now;
+    cb->stats.writes+=count;
+    circ_buff_stats_high_water(&cb->stats, circ_buff_occupied(cb));
+}
+
+/*
+ * Function:     circ_buff_stats_read(circ_buff_ptr cb, uint32_t head, uint32_t count)
+ * -----------------------------------------------------------------------------
+ * Description:  Records the residency of the 'count' slots read from index 
+ *               'head' on. A zero stamp (a slot loaded from a snapshot) has no
+ *               known write time and is only counted.
+ * ----------------------------------------------------------------------------
+ */
+static inline void circ_buff_stats_read(circ_buff_ptr cb, uint32_t head, uint32_t count)
+{
+    uint64_t now=circ_buff_stats_now();
+    uint32_t index;
+
+    for(index=0; index<count; index++)
+    {
+         uint64_t stamp=cb->stamps[(head+index)&cb->mask];
+         if(stamp!=0)
+              circ_buff_stats_record(&cb->stats, now-stamp);
+    }
+    cb->stats.reads+=count;
+}
+#endif
+
+
+/*								                
+ * Function:     circ_buff_map_mirror(uint32_t storage)
+ * -----------------------------------------------------------------------------
+ * Description:  Maps 'storage' elements of one memfd twice, back to back, in a
+ *               reserved region of twice the size. Writes through either half
+ *               show up in the other. 'storage' must fill whole pages.
+ *
+ * Returns:      The start of the region, or NULL if any step fails; nothing is
+ *               left mapped in that case.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t* circ_buff_map_mirror(uint32_t storage)
+{
+    size_t bytes=sizeof(uint32_t)*(size_t)storage;
+    uint8_t *region, *half;
+
+    int fd=memfd_create("circ_buff", MFD_CLOEXEC);
+    if(fd<0)
+         return NULL;
+    if(ftruncate(fd, bytes)!=0)
+    {
+         close(fd);
+         return NULL;
+    }
+
+    /*reserve the address range first so that both halves are adjacent*/
+    region=mmap(NULL, 2*bytes, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(region==MAP_FAILED)
+    {
+         close(fd);
+         return NULL;
+    }
+
+    /*map the same pages into each half*/
+    half=mmap(region, bytes, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, fd, 0);
+    if(half!=MAP_FAILED)
+         half=mmap(region+bytes, bytes, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, fd, 0);
+
+    /*the mappings keep the memory alive without the fd*/
+    close(fd);
+
+    if(half==MAP_FAILED)
+    {
+         munmap(region, 2*bytes);
+         return NULL;
+    }
+    return (uint32_t*)region;
+}
+
+/*storage that has to be copied, rather than realloc'd, to resize*/
+#define CIRC_BUFF_STORAGE_FIXED (CIRC_BUFF_MODE_MIRROR|CIRC_BUFF_MODE_MAPPED|CIRC_BUFF_MODE_HUGEPAGE| \
+                                 CIRC_BUFF_MODE_EXTERNAL|CIRC_BUFF_MODE_SINGLE)
+
+/*								                
+ * Function:     circ_buff_map_huge(uint32_t storage)
+ * -----------------------------------------------------------------------------
+ * Description:  Maps 'storage' elements from explicit huge pages, or failing
+ *               that maps them CIRC_BUFF_HUGE_PAGE aligned (over-mapping and 
+ *               trimming the ends) and asks for transparent huge pages. The
+ *               madvise is only a hint; the memory is usable either way.
+ *
+ * Returns:      The mapping, or NULL if nothing could be mapped.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t* circ_buff_map_huge(uint32_t storage)
+{
+    size_t bytes=sizeof(uint32_t)*(size_t)storage;
+    uint8_t *region, *aligned;
+
+    region=mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+    if(region!=MAP_FAILED)
+         return (uint32_t*)region;
+
+    region=mmap(NULL, bytes+CIRC_BUFF_HUGE_PAGE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(region==MAP_FAILED)
+         return NULL;
+
+    aligned=(uint8_t*)(((uintptr_t)region+CIRC_BUFF_HUGE_PAGE-1)&~(uintptr_t)(CIRC_BUFF_HUGE_PAGE-1));
+    if(aligned>region)
+         munmap(region, aligned-region);
+    if(region+CIRC_BUFF_HUGE_PAGE>aligned)
+         munmap(aligned+bytes, region+CIRC_BUFF_HUGE_PAGE-aligned);
+    madvise(aligned, bytes, MADV_HUGEPAGE);
+
+    return (uint32_t*)aligned;
+}
+
+/*								                
+ * Function:     circ_buff_storage_alloc(uint32_t* storage, uint32_t* mode)
+ * -----------------------------------------------------------------------------
+ * Description:  Gets storage for at least *storage elements the way *mode 
+ *               asks: mirrored (at least a page), huge page backed (at least
+ *               CIRC_BUFF_HUGE_PAGE bytes), or from the heap. A flag that can
+ *               not be honoured is cleared and the next option is tried.
+ *
+ * Returns:      The storage, or NULL if even the heap fails.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t* circ_buff_storage_alloc(uint32_t* storage, uint32_t* mode)
+{
+    uint32_t* base=NULL;
+
+    if(*mode&CIRC_BUFF_MODE_MIRROR)
+    {
+         uint32_t page_elements=(uint32_t)sysconf(_SC_PAGESIZE)/sizeof(uint32_t);
+         uint32_t mirror_storage=*storage<page_elements ? page_elements : *storage;
+
+         base=circ_buff_map_mirror(mirror_storage);
+         if(base!=NULL)
+         {
+              *storage=mirror_storage;
+              *mode&=~CIRC_BUFF_MODE_HUGEPAGE;
+              return base;
+         }
+         *mode&=~CIRC_BUFF_MODE_MIRROR;
+    }
+
+    if(*mode&CIRC_BUFF_MODE_HUGEPAGE)
+    {
+         if(sizeof(uint32_t)*(size_t)*storage>=CIRC_BUFF_HUGE_PAGE)
+              base=circ_buff_map_huge(*storage);
+         if(base!=NULL)
+              return base;
+         *mode&=~CIRC_BUFF_MODE_HUGEPAGE;
+    }
+
+    return (uint32_t*)malloc(sizeof(uint32_t)*(*storage));
+}
+
+/*								                
+ * Function:     circ_buff_storage_free(uint32_t* base, uint32_t storage, uint32_t mode)
+ * -----------------------------------------------------------------------------
+ * Description:  Gives back storage of 'storage' elements the way 'mode' says
+ *               it was obtained. Caller owned and single allocation storage 
+ *               is left alone.
+ * ----------------------------------------------------------------------------
+ */
+static void circ_buff_storage_free(uint32_t* base, uint32_t storage, uint32_t mode)
+{
+    size_t bytes=sizeof(uint32_t)*(size_t)storage;
+
+    if(mode&(CIRC_BUFF_MODE_EXTERNAL|CIRC_BUFF_MODE_SINGLE))
+         return;
+    if(mode&CIRC_BUFF_MODE_MIRROR)
+         munmap(base, 2*bytes);
+    else if(mode&CIRC_BUFF_MODE_HUGEPAGE)
+         munmap(base, bytes);
+    else if(mode&CIRC_BUFF_MODE_MAPPED)
+         munmap((uint8_t*)base-sizeof(circ_buff_snapshot_header), sizeof(circ_buff_snapshot_header)+bytes);
+    else
+         free(base);
+}
+
+/*								                
+ * Function:     circ_buff_setup(circ_buff_ptr cb, uint32_t* base, uint32_t storage,
+ *                               uint32_t size, uint32_t mode)
+ * -----------------------------------------------------------------------------
+ * Description:  Fills in a freshly allocated structure around its storage. 
+ *               Shared by the init functions.
+ *
+ * Returns:      CIRC_BUFF_SUCCESS, or CIRC_BUFF_MALLOC_FAIL if the stats 
+ *               stamps can not be allocated; cb is destroyed in that case.
+ * ----------------------------------------------------------------------------
+ */
+static circ_buff_code circ_buff_setup(circ_buff_ptr cb, uint32_t* base, uint32_t storage, uint32_t size, uint32_t mode)
+{
+    cb->base=base;
+    cb->mode=mode;
+    cb->grow_limit=0;
+    cb->dropped=0;
+    cb->mask=storage-1;
+    cb->total_size=(mode&CIRC_BUFF_MODE_POW2) ? storage : size;
+
+    /*Initialise the head and tail indices to the first slot*/
+    cb->head=0;
+    cb->tail=0;
+
+#ifdef CIRC_BUFF_STATS
+    memset(&cb->stats, 0, sizeof(circ_buff_stats));
+    cb->stamps=(uint64_t*)calloc(storage, sizeof(uint64_t));
+    if(cb->stamps==NULL)
+    {
+         circ_buff_destroy(cb);
+         return CIRC_BUFF_MALLOC_FAIL;
+    }
+#endif
+    return CIRC_BUFF_SUCCESS;
+}
+
 /*								                
  * Function:     circ_buff_init(circ_buff_ptr* circ_buff_pointer, int16_t size)
  * -----------------------------------------------------------------------------
- * Description:  Assigns memory specified by 'size' to the circular buffer 
+ * Description:  Assigns memory for 'size' elements to the circular buffer 
  *               structure pointed to by the pointer argument on the heap. 
  *               Also initialises various parameters to this buffer, like the 
- *               head, tail, total size, and size_occupied, etc.  
+ *               head, tail, total size, etc.  
  *              
  *           
  * Usage:        Pass a pointer to the ptr of the circular buffer struc which 
@@ -44,34 +287,165 @@
  *               CIRC_BUFF_SUCCESS: The funcion returns successfully.
  */
 circ_buff_code circ_buff_init(circ_buff_ptr* circ_buff_pointer, int32_t size)
+{
+    return circ_buff_init_mode(circ_buff_pointer, size, CIRC_BUFF_MODE_DEFAULT);
+}
+
+/*								                
+ * Function:     circ_buff_init_mode(circ_buff_ptr* circ_buff_pointer, 
+ *                                   int32_t size, uint32_t mode)
+ * -----------------------------------------------------------------------------
+ * Description:  Same as circ_buff_init, with mode flags chosen at init time.
+ *
+ *               The storage is always a power of two elements long, so that a 
+ *               free-running index maps to its slot with a mask. Without 
+ *               CIRC_BUFF_MODE_POW2 the capacity stays exactly 'size' and the
+ *               rest of the storage is unused; with it the capacity is rounded
+ *               up to fill the storage.
+ *
+ *               With CIRC_BUFF_MODE_OVERWRITE a write to a full buffer drops
+ *               the oldest element instead of failing (a flight recorder).
+ *
+ *               With CIRC_BUFF_MODE_MIRROR the storage is mapped twice back
+ *               to back in virtual memory, so any run of up to total_size
+ *               elements from any slot is contiguous and circ_buff_peek/
+ *               circ_buff_reserve return a single span. The storage is then
+ *               at least one page. If the mapping can not be made the heap is
+ *               used and the flag is cleared in cb->mode.
+ *           
+ * Usage:        Pass a pointer to the ptr of the circular buffer, the size in 
+ *               elements and an OR of circ_buff_mode flags.
+ * 
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_POINTER: The pointer passed is detected to be a 
+ *               null. The function halts execution and returns w/o completion.   
+ *                  
+ *               CIRC_BUFF_BAD_DATA: The size parameter is less than or equal 
+ *               to zero or larger than CIRC_BUFF_MAX_SIZE.
+ *               
+ *               CIRC_BUFF_MALLOC_FAIL: The call to malloc fails.
+ *
+ *               CIRC_BUFF_SUCCESS: The funcion returns successfully.
+ */
+circ_buff_code circ_buff_init_mode(circ_buff_ptr* circ_buff_pointer, int32_t size, uint32_t mode)
 {
     /*check if the pointer is NULLi*/
     if(circ_buff_pointer==NULL)                                                 
          return CIRC_BUFF_NULL_PTR;   
+    if(size<=0||(uint32_t)size>CIRC_BUFF_MAX_SIZE)
+         return CIRC_BUFF_BAD_DATA;
+
+    /*only circ_buff_snapshot_load, circ_buff_init_storage and 
+     *circ_buff_init_single may hand out these kinds of storage*/
+    mode&=~(CIRC_BUFF_MODE_MAPPED|CIRC_BUFF_MODE_EXTERNAL|CIRC_BUFF_MODE_SINGLE);
+
+    /*round the storage up to a power of two*/
+    uint32_t storage=1;
+    while(storage<(uint32_t)size)
+         storage<<=1;
 
     /*assign the circ buff struct on the heap*/
-    *(circ_buff_pointer)=(circ_buff_ptr)malloc(sizeof(circ_buff));
-    if((*circ_buff_pointer)==NULL)
+    circ_buff_ptr cb=(circ_buff_ptr)malloc(sizeof(circ_buff));
+    if(cb==NULL)
          return CIRC_BUFF_MALLOC_FAIL;
 
-    /*access the buff pointer and allocate memory on the heap*/ 
-    (*circ_buff_pointer)->base=(uint32_t*)malloc(size);                             
-    if((*circ_buff_pointer)->base==NULL)
+    /*mirrored, huge page or heap storage; size counts elements*/ 
+    uint32_t* base=circ_buff_storage_alloc(&storage, &mode);
+    if(base==NULL)
+    {
+         free(cb);
          return CIRC_BUFF_MALLOC_FAIL;
+    }
 
-    /*Initialise total and current size to the allocated memory*/
-    (*circ_buff_pointer)->size_occupied=0;             
-    (*circ_buff_pointer)->total_size=size;
-    
-    /*Initialise the head and tail positions to base*/
-    (*circ_buff_pointer)->head=(*circ_buff_pointer)->base;                        
-    (*circ_buff_pointer)->tail=(*circ_buff_pointer)->base;   
+    circ_buff_code rc=circ_buff_setup(cb, base, storage, (uint32_t)size, mode);
+    if(rc!=CIRC_BUFF_SUCCESS)
+         return rc;
+    *circ_buff_pointer=cb;
     
     /*return successfully*/
     return CIRC_BUFF_SUCCESS;                          
 }	
 
 
+/*								                
+ * Function:     circ_buff_init_storage(circ_buff_ptr* circ_buff_pointer, 
+ *                                      uint32_t* storage, int32_t elements,
+ *                                      uint32_t mode)
+ * -----------------------------------------------------------------------------
+ * Description:  Wraps caller owned storage; only the structure is allocated.
+ * 
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_init_storage(circ_buff_ptr* circ_buff_pointer, uint32_t* storage, int32_t elements, uint32_t mode)
+{
+    /*basic pointer, size and alignment check*/
+    if(circ_buff_pointer==NULL||storage==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(elements<=0||(uint32_t)elements>CIRC_BUFF_MAX_SIZE)
+         return CIRC_BUFF_BAD_DATA;
+    if((uintptr_t)storage%_Alignof(uint32_t)!=0)
+         return CIRC_BUFF_BAD_DATA;
+
+    /*the largest power of two that fits*/
+    uint32_t slots=1;
+    while(slots*2<=(uint32_t)elements)
+         slots<<=1;
+
+    circ_buff_ptr cb=(circ_buff_ptr)malloc(sizeof(circ_buff));
+    if(cb==NULL)
+         return CIRC_BUFF_MALLOC_FAIL;
+
+    mode=(mode&(CIRC_BUFF_MODE_POW2|CIRC_BUFF_MODE_OVERWRITE))|CIRC_BUFF_MODE_EXTERNAL;
+    circ_buff_code rc=circ_buff_setup(cb, storage, slots, slots, mode);
+    if(rc!=CIRC_BUFF_SUCCESS)
+         return rc;
+
+    *circ_buff_pointer=cb;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*								                
+ * Function:     circ_buff_init_single(circ_buff_ptr* circ_buff_pointer, 
+ *                                     int32_t size, uint32_t mode)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates the structure, padded to a whole number of cache
+ *               lines, and the storage behind it in one aligned block.
+ * 
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_init_single(circ_buff_ptr* circ_buff_pointer, int32_t size, uint32_t mode)
+{
+    /*basic pointer and size check*/
+    if(circ_buff_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(size<=0||(uint32_t)size>CIRC_BUFF_MAX_SIZE)
+         return CIRC_BUFF_BAD_DATA;
+
+    uint32_t storage=1;
+    while(storage<(uint32_t)size)
+         storage<<=1;
+
+    size_t header=(sizeof(circ_buff)+CIRC_BUFF_CACHE_LINE-1)&~(size_t)(CIRC_BUFF_CACHE_LINE-1);
+    void* block=NULL;
+    if(posix_memalign(&block, CIRC_BUFF_CACHE_LINE, header+sizeof(uint32_t)*(size_t)storage)!=0)
+         return CIRC_BUFF_MALLOC_FAIL;
+
+    circ_buff_ptr cb=(circ_buff_ptr)block;
+    mode=(mode&(CIRC_BUFF_MODE_POW2|CIRC_BUFF_MODE_OVERWRITE))|CIRC_BUFF_MODE_SINGLE;
+    circ_buff_code rc=circ_buff_setup(cb, (uint32_t*)((uint8_t*)block+header), storage, (uint32_t)size, mode);
+    if(rc!=CIRC_BUFF_SUCCESS)
+         return rc;
+
+    *circ_buff_pointer=cb;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
 /*								                
  * Function:     circ_buff_destroy(circ_buff_ptr circ_buff_ptr)
  * -----------------------------------------------------------------------------
@@ -97,16 +471,20 @@ circ_buff_code circ_buff_destroy(circ_buff_ptr circ_buff_pointer)
     if(circ_buff_pointer==NULL)
 	 return CIRC_BUFF_NULL_PTR;
     
-    /*free the memory of the buffer on the heap*/
-    free(circ_buff_pointer->base);
+    /*free the memory of the buffer on the heap, or undo the mapping*/
+    circ_buff_storage_free(circ_buff_pointer->base, circ_buff_pointer->mask+1, circ_buff_pointer->mode);
+
+#ifdef CIRC_BUFF_STATS
+    free(circ_buff_pointer->stamps);
+    circ_buff_pointer->stamps=NULL;
+#endif
 
     /*Reassign all the parameters to 0*/
-    circ_buff_pointer->size_occupied=0;             
     circ_buff_pointer->total_size=0;
-    
-    /*assigning NULL to the head and tail ptrs*/
-    circ_buff_pointer->head=NULL;                        
-    circ_buff_pointer->tail=NULL;   
+    circ_buff_pointer->mask=0;
+    circ_buff_pointer->base=NULL;
+    circ_buff_pointer->head=0;                        
+    circ_buff_pointer->tail=0;   
     
     /*now deallocate the structure*/
     free(circ_buff_pointer);
@@ -115,6 +493,238 @@ circ_buff_code circ_buff_destroy(circ_buff_ptr circ_buff_pointer)
     return CIRC_BUFF_SUCCESS; 
 }
 
+
+/*								                
+ * Function:     circ_buff_rearrange(uint8_t* base, size_t element, uint32_t old_storage,
+ *                                   uint32_t new_storage, uint32_t head_slot,
+ *                                   uint32_t occupied)
+ * -----------------------------------------------------------------------------
+ * Description:  Moves the 'occupied' elements of 'element' bytes each that 
+ *               start at head_slot in a ring of old_storage slots so that they
+ *               form a valid ring of new_storage slots. The block must already
+ *               be max(old_storage, new_storage) slots long.
+ *
+ *               Growing: when the data wraps, the shorter of the two segments
+ *               moves, either the wrapped part to just past the old end, or 
+ *               the first part to the new end. Shrinking: the first part 
+ *               moves to the new end, or an unwrapped run that sticks out 
+ *               moves down to slot zero.
+ *
+ * Returns:      The new head index; the tail is that plus occupied.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t circ_buff_rearrange(uint8_t* base, size_t element, uint32_t old_storage, uint32_t new_storage,
+                                    uint32_t head_slot, uint32_t occupied)
+{
+    uint32_t first=old_storage-head_slot;
+    if(first>occupied)
+         first=occupied;
+    uint32_t wrapped=occupied-first;
+
+    if(wrapped==0)
+    {
+         if(head_slot+occupied<=new_storage)
+              return head_slot;
+         memmove(base, base+head_slot*element, occupied*element);
+         return 0;
+    }
+    if(new_storage>old_storage&&wrapped<=first)
+    {
+         memcpy(base+old_storage*element, base, wrapped*element);
+         return head_slot;
+    }
+    memmove(base+(new_storage-first)*element, base+head_slot*element, first*element);
+    return new_storage-first;
+}
+
+/*								                
+ * Function:     circ_buff_linearize(uint8_t* to, const uint8_t* from, size_t element,
+ *                                   uint32_t mask, uint32_t head, uint32_t occupied)
+ * -----------------------------------------------------------------------------
+ * Description:  Copies the 'occupied' elements from index 'head' of the ring
+ *               'from' to the start of 'to', oldest first.
+ * ----------------------------------------------------------------------------
+ */
+static void circ_buff_linearize(uint8_t* to, const uint8_t* from, size_t element,
+                                uint32_t mask, uint32_t head, uint32_t occupied)
+{
+    uint32_t slot=head&mask;
+    uint32_t first=mask+1-slot;
+    if(first>occupied)
+         first=occupied;
+
+    memcpy(to, from+slot*element, first*element);
+    memcpy(to+first*element, from, (occupied-first)*element);
+}
+
+/*								                
+ * Function:     circ_buff_resize(circ_buff_ptr circ_buff_pointer, int32_t size)
+ * -----------------------------------------------------------------------------
+ * Description:  Works out the new storage size, then either reallocs the heap
+ *               storage and rearranges it in place, or copies any other kind
+ *               of storage into a fresh block starting at slot zero. With 
+ *               CIRC_BUFF_STATS the stamps follow the elements.
+ * 
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_resize(circ_buff_ptr circ_buff_pointer, int32_t size)
+{
+    /*basic pointer and size check*/
+    if(circ_buff_pointer==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+    if(size<=0||(uint32_t)size>CIRC_BUFF_MAX_SIZE)
+         return CIRC_BUFF_BAD_DATA;
+
+    circ_buff_ptr cb=circ_buff_pointer;
+    uint32_t occupied=circ_buff_occupied(cb);
+    if((uint32_t)size<occupied&&!(cb->mode&CIRC_BUFF_MODE_OVERWRITE))
+         return CIRC_BUFF_BAD_DATA;
+
+    uint32_t old_storage=cb->mask+1, storage=1;
+    while(storage<(uint32_t)size)
+         storage<<=1;
+    if(cb->mode&CIRC_BUFF_MODE_MIRROR)
+    {
+         uint32_t page_elements=(uint32_t)sysconf(_SC_PAGESIZE)/sizeof(uint32_t);
+         if(storage<page_elements)
+              storage=page_elements;
+    }
+
+    /*a flight recorder shrinks by forgetting its oldest elements*/
+    uint32_t lost=0;
+    if((uint32_t)size<occupied)
+    {
+         lost=occupied-(uint32_t)size;
+         occupied=(uint32_t)size;
+    }
+
+    uint32_t head=cb->head+lost;
+    if(storage==old_storage)
+         ;
+    else if(cb->mode&CIRC_BUFF_STORAGE_FIXED)
+    {
+         /*the storage can not be realloc'd; copy it out in order. Mapped,
+          *caller owned and single allocation storage moves to the heap*/
+         uint32_t mode=cb->mode&~(CIRC_BUFF_MODE_MAPPED|CIRC_BUFF_MODE_EXTERNAL|CIRC_BUFF_MODE_SINGLE);
+         uint32_t* base=circ_buff_storage_alloc(&storage, &mode);
+         if(base==NULL)
+              return CIRC_BUFF_MALLOC_FAIL;
+#ifdef CIRC_BUFF_STATS
+         uint64_t* stamps=(uint64_t*)calloc(storage, sizeof(uint64_t));
+         if(stamps==NULL)
+         {
+              circ_buff_storage_free(base, storage, mode);
+              return CIRC_BUFF_MALLOC_FAIL;
+         }
+         circ_buff_linearize((uint8_t*)stamps, (const uint8_t*)cb->stamps, sizeof(uint64_t), cb->mask, head, occupied);
+         free(cb->stamps);
+         cb->stamps=stamps;
+#endif
+         circ_buff_linearize((uint8_t*)base, (const uint8_t*)cb->base, sizeof(uint32_t), cb->mask, head, occupied);
+
+         circ_buff_storage_free(cb->base, old_storage, cb->mode);
+         cb->base=base;
+         cb->mode=mode;
+         head=0;
+    }
+    else
+    {
+         /*grow the blocks before moving anything; a failure leaves the data where it was*/
+         if(storage>old_storage)
+         {
+              uint32_t* base=(uint32_t*)realloc(cb->base, sizeof(uint32_t)*storage);
+              if(base==NULL)
+                   return CIRC_BUFF_MALLOC_FAIL;
+              cb->base=base;
+#ifdef CIRC_BUFF_STATS
+              uint64_t* stamps=(uint64_t*)realloc(cb->stamps, sizeof(uint64_t)*storage);
+              if(stamps==NULL)
+                   return CIRC_BUFF_MALLOC_FAIL;
+              cb->stamps=stamps;
+#endif
+         }
+
+#ifdef CIRC_BUFF_STATS
+         circ_buff_rearrange((uint8_t*)cb->stamps, sizeof(uint64_t), old_storage, storage, head&cb->mask, occupied);
+#endif
+         head=circ_buff_rearrange((uint8_t*)cb->base, sizeof(uint32_t), old_storage, storage, head&cb->mask, occupied);
+
+         /*giving memory back may fail; the bigger block then stays in use*/
+         if(storage<old_storage)
+         {
+              uint32_t* base=(uint32_t*)realloc(cb->base, sizeof(uint32_t)*storage);
+              if(base!=NULL)
+                   cb->base=base;
+#ifdef CIRC_BUFF_STATS
+              uint64_t* stamps=(uint64_t*)realloc(cb->stamps, sizeof(uint64_t)*storage);
+              if(stamps!=NULL)
+                   cb->stamps=stamps;
+#endif
+         }
+    }
+
+    cb->mask=storage-1;
+    cb->total_size=(cb->mode&CIRC_BUFF_MODE_POW2) ? storage : (uint32_t)size;
+    cb->dropped+=lost;
+    cb->head=head;
+    cb->tail=head+occupied;
+
+    return CIRC_BUFF_SUCCESS;
+}
+
+/*								                
+ * Function:     circ_buff_autogrow(circ_buff_ptr circ_buff_pointer, int32_t limit)
+ * -----------------------------------------------------------------------------
+ * Description:  Sets the capacity the buffer may grow to when it fills.
+ * 
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_autogrow(circ_buff_ptr circ_buff_pointer, int32_t limit)
+{
+    /*basic pointer check*/
+    if(circ_buff_pointer==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+    if(limit<0||(uint32_t)limit>CIRC_BUFF_MAX_SIZE)
+         return CIRC_BUFF_BAD_DATA;
+
+    circ_buff_pointer->grow_limit=(uint32_t)limit;
+    return CIRC_BUFF_SUCCESS;
+}
+
+/*								                
+ * Function:     circ_buff_grow(circ_buff_ptr cb, uint32_t needed)
+ * -----------------------------------------------------------------------------
+ * Description:  Called when fewer than 'needed' slots are free. Doubles the
+ *               capacity until 'needed' fits, clipped to grow_limit. In
+ *               CIRC_BUFF_MODE_POW2 resize rounds up, so the clip is to the
+ *               largest power of two not above grow_limit instead.
+ * 
+ * Returns:      CIRC_BUFF_SUCCESS if the buffer grew, CIRC_BUFF_FULL if it is
+ *               already at its limit, or the failure from circ_buff_resize.
+ * ----------------------------------------------------------------------------
+ */
+static circ_buff_code circ_buff_grow(circ_buff_ptr cb, uint32_t needed)
+{
+    uint32_t limit=cb->grow_limit;
+    if(cb->mode&CIRC_BUFF_MODE_POW2)
+         while(limit&(limit-1))
+              limit&=limit-1;                                                 //clear low bits down to the top one
+    if(limit<=cb->total_size)
+         return CIRC_BUFF_FULL;
+
+    uint64_t wanted=(uint64_t)circ_buff_occupied(cb)+needed;
+    uint64_t size=(uint64_t)cb->total_size*2;
+    while(size<wanted)
+         size*=2;
+    if(size>limit)
+         size=limit;
+
+    return circ_buff_resize(cb, (int32_t)size);
+}
+
 /*								                
  * Function:     if_circ_buff_full(circ_buff_ptr circ_buff_ptr)
  * -----------------------------------------------------------------------------
@@ -139,7 +749,7 @@ circ_buff_code if_circ_buff_full(circ_buff_ptr circ_buff_pointer)
 	 return CIRC_BUFF_NULL_PTR;
 
     /*collect total and current size values of the buffer in a local variables*/ 
-    uint32_t current_buff_size=circ_buff_pointer->size_occupied, total_buff_size= circ_buff_pointer->total_size;
+    uint32_t current_buff_size=circ_buff_occupied(circ_buff_pointer), total_buff_size= circ_buff_pointer->total_size;
     
     /*check if the buffer is full*/
     if(current_buff_size ==total_buff_size)
@@ -172,7 +782,7 @@ circ_buff_code if_circ_buff_empty(circ_buff_ptr circ_buff_pointer)
 	 return CIRC_BUFF_NULL_PTR;
 
     /*read current buffer size*/
-    uint32_t current_buff_size=circ_buff_pointer->size_occupied;  
+    uint32_t current_buff_size=circ_buff_occupied(circ_buff_pointer);  
     
     /*check if the buffer is emptry*/
     if(current_buff_size ==0)
@@ -197,7 +807,9 @@ circ_buff_code if_circ_buff_empty(circ_buff_ptr circ_buff_pointer)
  *               returns.
  *
  *               CIRC_BUFF_FULL: The buffer is currently full and thus new
- *               data can not be written to it.
+ *               data can not be written to it. Never returned in 
+ *               CIRC_BUFF_MODE_OVERWRITE; there the oldest element is dropped
+ *               instead and the dropped counter is incremented.
  *
  *               CIRC_BUFF_SUCCESS: The function completes execution 
  *               successfully.   
@@ -209,26 +821,32 @@ circ_buff_code circ_buff_write(circ_buff_ptr circ_buff_pointer, uint32_t data)
     if(circ_buff_pointer==NULL)
 	 return CIRC_BUFF_NULL_PTR;
     
-    /*call if_circ_buff_full to check if a write is feasible at all*/
-    circ_buff_code if_write_ok=if_circ_buff_full(circ_buff_pointer);
-    
-    if(if_write_ok!=CIRC_BUFF_CAN_WRITE)
-	 return CIRC_BUFF_FULL;
+    /*check if a write is feasible at all*/
+    uint32_t tail=circ_buff_pointer->tail;
+    if(tail-circ_buff_pointer->head==circ_buff_pointer->total_size)
+    {
+         /*grow first if allowed; resizing renumbers the indices*/
+         if(circ_buff_grow(circ_buff_pointer, 1)==CIRC_BUFF_SUCCESS)
+              tail=circ_buff_pointer->tail;
+         else if(!(circ_buff_pointer->mode&CIRC_BUFF_MODE_OVERWRITE))
+         {
+	      CIRC_BUFF_STAT(circ_buff_pointer->stats.full++);
+	      return CIRC_BUFF_FULL;
+         }
+         else
+         {
+	      /*flight recorder: head moves with tail and the oldest element is lost*/
+	      circ_buff_pointer->head++;
+	      circ_buff_pointer->dropped++;
+         }
+    }
 
-    /*collect total size in a variable*/
-    uint32_t total_buff_size= circ_buff_pointer->total_size;
+    /*grab the tail slot and write to it*/
+    circ_buff_pointer->base[tail&circ_buff_pointer->mask]=data;  
     
-    /*grab the tail and write to it*/
-    *(circ_buff_pointer->tail)=data;  
-    
-    /*update tail circularly*/
-    if((circ_buff_pointer->tail-circ_buff_pointer->base)!=total_buff_size)
-         circ_buff_pointer->tail++;           
-    else
-	 circ_buff_pointer->tail=circ_buff_pointer->base;
-
-    /*update the size occupied by the buffer*/
-    circ_buff_pointer->size_occupied++;
+    /*the tail is free-running; the mask does the wrap*/
+    circ_buff_pointer->tail=tail+1;
+    CIRC_BUFF_STAT(circ_buff_stats_wrote(circ_buff_pointer, tail, 1));
     
     /*return successfully*/
     return CIRC_BUFF_SUCCESS;
@@ -263,125 +881,837 @@ circ_buff_code circ_buff_read(circ_buff_ptr circ_buff_pointer, uint32_t* data)
     if(circ_buff_pointer==NULL||data==NULL)
 	 return CIRC_BUFF_NULL_PTR;
 
-    /*get buffer status- find if data can be read*/
-    circ_buff_code if_read_ok=if_circ_buff_empty(circ_buff_pointer);     
-    
     /*check if a read is feasible at all*/ 
-    if(if_read_ok!=CIRC_BUFF_CAN_READ)
+    uint32_t head=circ_buff_pointer->head;
+    if(head==circ_buff_pointer->tail)
+    {
+	 CIRC_BUFF_STAT(circ_buff_pointer->stats.empty++);
 	 return CIRC_BUFF_EMPTY;                      
+    }
     
-    /*collect total size in a local variable*/ 
-    uint32_t total_buff_size= circ_buff_pointer->total_size;
-    
-    /*assign the byte located at head to data and complete the read*/
-    *data= *(circ_buff_pointer->head);  
-
-    /*update head circularly*/
-    if((circ_buff_pointer->head-circ_buff_pointer->base)!=total_buff_size)
-         circ_buff_pointer->head++;           
-    else
-	 circ_buff_pointer->head=(circ_buff_pointer->base);
+    /*assign the element located at head to data and complete the read*/
+    *data=circ_buff_pointer->base[head&circ_buff_pointer->mask];  
 
-    /*update the size occupied by the buffer*/
-    circ_buff_pointer->size_occupied--;
+    /*the head is free-running; the mask does the wrap*/
+    circ_buff_pointer->head=head+1;
+    CIRC_BUFF_STAT(circ_buff_stats_read(circ_buff_pointer, head, 1));
     
     /*return successfully*/
     return CIRC_BUFF_SUCCESS;
 }	
 
 /*								                
- * Function:     circ_buff_dump(circ_buff_ptr cb)
+ * Function:     circ_buff_size(circ_buff_ptr circ_buff_pointer, uint32_t* size)
  * -----------------------------------------------------------------------------
- * Description:  Dumps all data from the circular buffer pointed by circ_buff_ptr
- *               in a file in the same directory whose name is defined by FILE_NAME
- *               
- * Usage:        Pass a pointer to the circular buffer.
- * 
- * Returns:      Error/Status codes:
- *               CIRC_BUFF_NULL_PTR: The pointer passed to the function is a
- *               NULL and is thus invalid. The function halts execution and 
- *               returns.
- *               
- *               CIRC_BUFF_FILE_OPEN_FAILED: Call to fopen failed.
+ * Description:  Returns the number of elements currently held in *size.
+ *                
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: Either of the pointers passed is a NULL.
  *
- *               CIRC_BUFF_EMPTY: The buffer is currently empty and thus can
- *               not return any data.
- *               
- *               CIRC_BUFF_SUCCESS: The function completes execution 
- *               completely.
+ *               CIRC_BUFF_SUCCESS: *size is valid.   
  * ----------------------------------------------------------------------------
  */
-circ_buff_code dump(circ_buff_ptr cb)
+circ_buff_code circ_buff_size(circ_buff_ptr circ_buff_pointer, uint32_t* size)
 {
-    uint32_t total_size= cb->total_size, index; 
-    uint32_t head=cb->head-cb->base, tail=cb->tail-cb->base;
-    
-    FILE* fp1;
-    
-    /*get buffer status- find if data can be read*/
-    circ_buff_code if_read_ok=if_circ_buff_empty(cb);     
-    
-    /*check if there's data to be dumped in the first place*/ 
-    if(if_read_ok!=CIRC_BUFF_CAN_READ)
-	 return CIRC_BUFF_EMPTY;                      
+    /*basic pointer check; error handling*/	
+    if(circ_buff_pointer==NULL||size==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+
+    *size=circ_buff_occupied(circ_buff_pointer);
+    return CIRC_BUFF_SUCCESS;
+}
+
+/*								                
+ * Function:     circ_buff_spans(circ_buff_ptr cb, uint32_t start, 
+ *                               uint32_t count, circ_buff_span spans[2])
+ * -----------------------------------------------------------------------------
+ * Description:  Splits 'count' elements starting at index 'start' into the 
+ *               part before the end of the storage and the part after the 
+ *               wrap. The second span has a zero count when there is no wrap,
+ *               which is always the case for mirrored storage.
+ * ----------------------------------------------------------------------------
+ */
+static void circ_buff_spans(circ_buff_ptr cb, uint32_t start, uint32_t count, circ_buff_span spans[2])
+{
+    uint32_t slot=start&cb->mask;
+    uint32_t first=cb->mask+1-slot;
+    if(first>count||(cb->mode&CIRC_BUFF_MODE_MIRROR))
+         first=count;
+
+    spans[0].data=cb->base+slot;
+    spans[0].count=first;
+    spans[1].data=cb->base;
+    spans[1].count=count-first;
+}
+
+/*								                
+ * Function:     circ_buff_reserve(circ_buff_ptr circ_buff_pointer, uint32_t count,
+ *                                 circ_buff_span spans[2], uint32_t* reserved)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns up to two writable spans of free storage starting at
+ *               the tail, covering up to 'count' elements in total. Nothing
+ *               is published until circ_buff_commit is called.
+ *               
+ * Usage:        Pass a pointer to the circular buffer, the number of elements
+ *               wanted, an array of two spans and a pointer to a uint32_t that
+ *               receives the number of elements actually reserved. Fill 
+ *               spans[0] first, then spans[1], and commit what was filled.
+ * 
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: One of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_FULL: The buffer is full; *reserved is zero.
+ *
+ *               CIRC_BUFF_SUCCESS: *reserved elements are available.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_reserve(circ_buff_ptr circ_buff_pointer, uint32_t count, circ_buff_span spans[2], uint32_t* reserved)
+{
+    /*basic pointer check; error handling*/	
+    if(circ_buff_pointer==NULL||spans==NULL||reserved==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+
+    uint32_t free_space=circ_buff_pointer->total_size-circ_buff_occupied(circ_buff_pointer);
+    if(count>free_space&&circ_buff_grow(circ_buff_pointer, count)==CIRC_BUFF_SUCCESS)
+         free_space=circ_buff_pointer->total_size-circ_buff_occupied(circ_buff_pointer);
     
-    /*open a file*/ 
-    fp1=fopen(FILE_NAME, "w+");
+    /*clip the request to the free space*/
+    if(count>free_space)
+         count=free_space;
+    *reserved=count;
+
+    circ_buff_spans(circ_buff_pointer, circ_buff_pointer->tail, count, spans);
+
+    if(free_space==0)
+    {
+         CIRC_BUFF_STAT(circ_buff_pointer->stats.full++);
+         return CIRC_BUFF_FULL;
+    }
+    return CIRC_BUFF_SUCCESS;
+}
+
+/*								                
+ * Function:     circ_buff_commit(circ_buff_ptr circ_buff_pointer, uint32_t count)
+ * -----------------------------------------------------------------------------
+ * Description:  Publishes 'count' elements written into the spans returned by
+ *               circ_buff_reserve by moving the tail past them.
+ *               
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: count is larger than the free space; 
+ *               nothing is committed.
+ *
+ *               CIRC_BUFF_SUCCESS: The elements are now readable.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_commit(circ_buff_ptr circ_buff_pointer, uint32_t count)
+{
+    /*basic pointer check; error handling*/	
+    if(circ_buff_pointer==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+
+    if(count>circ_buff_pointer->total_size-circ_buff_occupied(circ_buff_pointer))
+	 return CIRC_BUFF_BAD_DATA;
+
+    /*the tail is free-running; the mask does the wrap*/
+    circ_buff_pointer->tail+=count;
+    CIRC_BUFF_STAT(circ_buff_stats_wrote(circ_buff_pointer, circ_buff_pointer->tail-count, count));
+
+    return CIRC_BUFF_SUCCESS;
+}
+
+/*								                
+ * Function:     circ_buff_peek(circ_buff_ptr circ_buff_pointer, uint32_t count,
+ *                              circ_buff_span spans[2], uint32_t* available)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns up to two readable spans starting at the head, covering
+ *               up to 'count' elements in total. The elements stay in the 
+ *               buffer until circ_buff_release is called.
+ *               
+ * Usage:        Pass a pointer to the circular buffer, the number of elements
+ *               wanted, an array of two spans and a pointer to a uint32_t that
+ *               receives the number of elements actually available. 
+ * 
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: One of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_EMPTY: The buffer is empty; *available is zero.
+ *
+ *               CIRC_BUFF_SUCCESS: *available elements can be read in place.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_peek(circ_buff_ptr circ_buff_pointer, uint32_t count, circ_buff_span spans[2], uint32_t* available)
+{
+    /*basic pointer check; error handling*/	
+    if(circ_buff_pointer==NULL||spans==NULL||available==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+
+    uint32_t occupied=circ_buff_occupied(circ_buff_pointer);
     
-    if(fp1==NULL)
-	 return CIRC_BUFF_FILE_OPEN_FAILED;
+    /*clip the request to what is stored*/
+    if(count>occupied)
+         count=occupied;
+    *available=count;
+
+    circ_buff_spans(circ_buff_pointer, circ_buff_pointer->head, count, spans);
+
+    if(occupied==0)
+    {
+         CIRC_BUFF_STAT(circ_buff_pointer->stats.empty++);
+         return CIRC_BUFF_EMPTY;
+    }
+    return CIRC_BUFF_SUCCESS;
+}
+
+/*								                
+ * Function:     circ_buff_iter_begin(circ_buff_ptr circ_buff_pointer, circ_buff_iter* iter)
+ * -----------------------------------------------------------------------------
+ * Description:  Copies the storage pointer and the current head and tail into
+ *               the iterator. Unlike circ_buff_peek it does not count an
+ *               empty buffer as a failed read in the stats.
+ * 
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_iter_begin(circ_buff_ptr circ_buff_pointer, circ_buff_iter* iter)
+{
+    /*basic pointer check; error handling*/	
+    if(circ_buff_pointer==NULL||iter==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+
+    iter->base=circ_buff_pointer->base;
+    iter->mask=circ_buff_pointer->mask;
+    iter->mirror=(circ_buff_pointer->mode&CIRC_BUFF_MODE_MIRROR)!=0;
+    iter->index=circ_buff_pointer->head;
+    iter->end=circ_buff_pointer->tail;
+
+    return iter->index==iter->end ? CIRC_BUFF_EMPTY : CIRC_BUFF_SUCCESS;
+}
+
+/*								                
+ * Function:     circ_buff_iter_span(circ_buff_iter* iter, circ_buff_span* span)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the run from the iterator's index up to the end of 
+ *               the storage or the end of the walk, whichever is first.
+ * 
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_iter_span(circ_buff_iter* iter, circ_buff_span* span)
+{
+    /*basic pointer check; error handling*/	
+    if(iter==NULL||span==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+
+    uint32_t count=iter->end-iter->index;
+    uint32_t slot=iter->index&iter->mask;
+    if(!iter->mirror&&count>iter->mask+1-slot)
+         count=iter->mask+1-slot;
+
+    span->data=(uint32_t*)iter->base+slot;
+    span->count=count;
+    iter->index+=count;
+
+    return count==0 ? CIRC_BUFF_EMPTY : CIRC_BUFF_SUCCESS;
+}
+
+/*								                
+ * Function:     circ_buff_release(circ_buff_ptr circ_buff_pointer, uint32_t count)
+ * -----------------------------------------------------------------------------
+ * Description:  Frees 'count' elements at the head, typically after they have
+ *               been consumed through circ_buff_peek.
+ *               
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: count is larger than the number of 
+ *               elements stored; nothing is released.
+ *
+ *               CIRC_BUFF_SUCCESS: The elements are released.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_release(circ_buff_ptr circ_buff_pointer, uint32_t count)
+{
+    /*basic pointer check; error handling*/	
+    if(circ_buff_pointer==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+
+    if(count>circ_buff_occupied(circ_buff_pointer))
+	 return CIRC_BUFF_BAD_DATA;
+
+    /*the head is free-running; the mask does the wrap*/
+    circ_buff_pointer->head+=count;
+    CIRC_BUFF_STAT(circ_buff_stats_read(circ_buff_pointer, circ_buff_pointer->head-count, count));
+
+    return CIRC_BUFF_SUCCESS;
+}
+
+/*								                
+ * Function:     circ_buff_dropped(circ_buff_ptr circ_buff_pointer, uint64_t* dropped)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns in *dropped the number of elements discarded so far by
+ *               writes to a full buffer in CIRC_BUFF_MODE_OVERWRITE. Always 
+ *               zero in the other modes.
+ *                
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: Either of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_SUCCESS: *dropped is valid.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_dropped(circ_buff_ptr circ_buff_pointer, uint64_t* dropped)
+{
+    /*basic pointer check; error handling*/	
+    if(circ_buff_pointer==NULL||dropped==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+
+    *dropped=circ_buff_pointer->dropped;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+#ifdef CIRC_BUFF_STATS
+/*								                
+ * Function:     circ_buff_stats_get(circ_buff_ptr circ_buff_pointer, 
+ *                                   circ_buff_stats* stats)
+ * -----------------------------------------------------------------------------
+ * Description:  Copies the counters of the circular buffer into *stats.
+ *                
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_stats_get(circ_buff_ptr circ_buff_pointer, circ_buff_stats* stats)
+{
+    /*basic pointer check; error handling*/	
+    if(circ_buff_pointer==NULL||stats==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+
+    *stats=circ_buff_pointer->stats;
+    return CIRC_BUFF_SUCCESS;
+}
+#endif
+
+/*								                
+ * Function:     circ_buff_write_n(circ_buff_ptr circ_buff_pointer, 
+ *                                 const uint32_t* data, uint32_t count,
+ *                                 uint32_t* written)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes up to 'count' elements from data to the circular buffer
+ *               in at most two memcpy calls: one up to the end of the storage
+ *               and one from base after the wrap.
+ *               
+ * Usage:        Pass a pointer to the circular buffer, the array to be written,
+ *               its length and a pointer to a uint32_t that receives the number
+ *               of elements actually written. If there is less free space than
+ *               'count', only as many elements as fit are written.
+ * 
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: One of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_FULL: count is non-zero but the buffer is full; 
+ *               *written is zero. In CIRC_BUFF_MODE_OVERWRITE the oldest 
+ *               elements are dropped to make room instead, so all 'count' 
+ *               elements are accepted and only the newest total_size of 
+ *               them are kept.
+ *
+ *               CIRC_BUFF_SUCCESS: *written elements were written.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_write_n(circ_buff_ptr circ_buff_pointer, const uint32_t* data, uint32_t count, uint32_t* written)
+{
+    /*basic pointer check; error handling*/	
+    if(circ_buff_pointer==NULL||data==NULL||written==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+
+    /*grow if allowed; in overwrite mode, then make room by dropping the oldest elements*/
+    uint32_t free_space=circ_buff_pointer->total_size-circ_buff_occupied(circ_buff_pointer);
+    if(count>free_space&&circ_buff_grow(circ_buff_pointer, count)==CIRC_BUFF_SUCCESS)
+         free_space=circ_buff_pointer->total_size-circ_buff_occupied(circ_buff_pointer);
+    if((circ_buff_pointer->mode&CIRC_BUFF_MODE_OVERWRITE)&&count>free_space)
+    {
+         uint32_t total_buff_size=circ_buff_pointer->total_size, accepted=count;
+
+	 /*only the newest total_size elements of the batch can survive*/
+	 if(count>total_buff_size)
+	 {
+	      circ_buff_pointer->dropped+=count-total_buff_size;
+	      data+=count-total_buff_size;
+	      count=total_buff_size;
+	 }
+	 circ_buff_pointer->head+=count-free_space;
+	 circ_buff_pointer->dropped+=count-free_space;
+
+	 circ_buff_code rc=circ_buff_write_n(circ_buff_pointer, data, count, written);
+	 *written=accepted;
+	 return rc;
+    }
+
+    circ_buff_span spans[2];
+    circ_buff_code rc=circ_buff_reserve(circ_buff_pointer, count, spans, written);
     
-    /*heading*/ 
-    fprintf(fp1, "Buffer Data:\n");
+    /*a zero length batch always succeeds*/
+    if(*written==0)
+	 return count==0 ? CIRC_BUFF_SUCCESS : rc;
+
+    memcpy(spans[0].data, data, sizeof(uint32_t)*spans[0].count);
+    memcpy(spans[1].data, data+spans[0].count, sizeof(uint32_t)*spans[1].count);
+
+    return circ_buff_commit(circ_buff_pointer, *written);
+}
+
+/*								                
+ * Function:     circ_buff_read_n(circ_buff_ptr circ_buff_pointer, uint32_t* data,
+ *                                uint32_t count, uint32_t* read)
+ * -----------------------------------------------------------------------------
+ * Description:  Reads up to 'count' elements from the head of the circular
+ *               buffer into data in at most two memcpy calls.
+ *               
+ * Usage:        Pass a pointer to the circular buffer, an array with room for
+ *               'count' elements, 'count' and a pointer to a uint32_t that 
+ *               receives the number of elements actually read. 
+ * 
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: One of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_EMPTY: count is non-zero but the buffer is empty; 
+ *               *read is zero.
+ *
+ *               CIRC_BUFF_SUCCESS: *read elements were read.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_read_n(circ_buff_ptr circ_buff_pointer, uint32_t* data, uint32_t count, uint32_t* read)
+{
+    /*basic pointer check; error handling*/	
+    if(circ_buff_pointer==NULL||data==NULL||read==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+
+    circ_buff_span spans[2];
+    circ_buff_code rc=circ_buff_peek(circ_buff_pointer, count, spans, read);
     
-    /*handle case by case*/ 
-    /*Case 1:*/
-    /*Buffer scenario:*/
-    /*  ###########************##############             
-     *  ^          ^           ^            ^
-     *  |          |           |            |
-     *  base_ptr   tail_ptr    head_ptr     base_ptr+total_size
-     *  #-Data element
-     *  *-empty element
-     * */
-    if(head>tail)
+    /*a zero length batch always succeeds*/
+    if(*read==0)
+	 return count==0 ? CIRC_BUFF_SUCCESS : rc;
+
+    memcpy(data, spans[0].data, sizeof(uint32_t)*spans[0].count);
+    memcpy(data+spans[0].count, spans[1].data, sizeof(uint32_t)*spans[1].count);
+
+    return circ_buff_release(circ_buff_pointer, *read);
+}
+
+/*								                
+ * Structure:    circ_buff_sink
+ * -----------------------------------------------------------------------------
+ * Description:  Where a dump goes: an fd, or a stdio stream when 'file' is set.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_sink
+{
+    int   fd;
+    FILE *file;
+}circ_buff_sink;
+
+
+/*								                
+ * Function:     circ_buff_sink_writev(const circ_buff_sink* sink, struct iovec* iov,
+ *                                     int iovcnt)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes all of the iovecs, retrying short writes and EINTR.
+ *               The iovecs are consumed in the process.
+ *
+ * Returns:      CIRC_BUFF_WRITE_FAILED or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+static circ_buff_code circ_buff_sink_writev(const circ_buff_sink* sink, struct iovec* iov, int iovcnt)
+{
+    int index;
+
+    if(sink->file!=NULL)
     {
-         /*using for loop to print as per the above scenario*/
-	 for(index=0; index<tail; index++)
-              fprintf(fp1, "%"PRIu32"\t", *(cb->base+index));
-         for(index=tail; index<head; index++){
-              fprintf(fp1, "*\t");
-         }
-         for(index=head; index<total_size; index++){
-              fprintf(fp1, "%"PRIu32"\t", *(cb->base+index));
+         for(index=0; index<iovcnt; index++)
+         {
+              if(fwrite(iov[index].iov_base, 1, iov[index].iov_len, sink->file)!=iov[index].iov_len)
+                   return CIRC_BUFF_WRITE_FAILED;
          }
+         return CIRC_BUFF_SUCCESS;
     }
-    /*Case 2:*/
-    /*Buffer scenario:*/
-    /*  ***********############**************             
-     *  ^          ^           ^            ^
-     *  |          |           |            |
-     *  base_ptr   head_ptr    tail_ptr     base_ptr+total_size
-     *  
-     *  '#'-Data element
-     *  '*'-empty
-     *
-     * */
-    else{
-         /*using for loop to print as per the above scenario*/
-         for(index=0; index<head; index++){
-              fprintf(fp1, "*\t");
-         }
-         
-         for(index=head; index<tail; index++){
-              fprintf(fp1, "%"PRIu32"\t", *(cb->base+index));
+
+    while(iovcnt>0)
+    {
+         ssize_t written=writev(sink->fd, iov, iovcnt);
+         if(written<0)
+         {
+              if(errno==EINTR)
+                   continue;
+              return CIRC_BUFF_WRITE_FAILED;
          }
 
-         for(index=tail; index<total_size; index++){
-              fprintf(fp1, "*\t");
+         /*skip what went out; a short write leaves the rest for next time*/
+         while(iovcnt>0&&(size_t)written>=iov->iov_len)
+         {
+              written-=iov->iov_len;
+              iov++;
+              iovcnt--;
+         }
+         if(iovcnt>0)
+         {
+              iov->iov_base=(char*)iov->iov_base+written;
+              iov->iov_len-=written;
          }
+    }
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*two ascii digits for every value 0-99*/
+static const char circ_buff_digit_pairs[201]=
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/*								                
+ * Function:     circ_buff_format_u32(char* out, uint32_t value)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes value in decimal at out, two digits per division.
+ *
+ * Returns:      The position just after the last digit.
+ * ----------------------------------------------------------------------------
+ */
+static char* circ_buff_format_u32(char* out, uint32_t value)
+{
+    char digits[10];
+    char* start=digits+sizeof(digits);
+
+    while(value>=100)
+    {
+         uint32_t pair=(value%100)*2;
+         value/=100;
+         start-=2;
+         start[0]=circ_buff_digit_pairs[pair];
+         start[1]=circ_buff_digit_pairs[pair+1];
+    }
+    if(value>=10)
+    {
+         start-=2;
+         start[0]=circ_buff_digit_pairs[value*2];
+         start[1]=circ_buff_digit_pairs[value*2+1];
+    }
+    else
+         *--start=(char)('0'+value);
+
+    size_t length=digits+sizeof(digits)-start;
+    memcpy(out, start, length);
+    return out+length;
+}
+
+
+/*								                
+ * Function:     circ_buff_dump_sink(circ_buff_ptr cb, const circ_buff_sink* sink,
+ *                                   circ_buff_dump_format format)
+ * -----------------------------------------------------------------------------
+ * Description:  Common body of circ_buff_dump_fd and circ_buff_dump_file. Only
+ *               the occupied region is visited, as the (at most) two spans 
+ *               that circ_buff_peek returns.
+ *
+ * Returns:      CIRC_BUFF_BAD_DATA, CIRC_BUFF_EMPTY, CIRC_BUFF_WRITE_FAILED or
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+static circ_buff_code circ_buff_dump_sink(circ_buff_ptr cb, const circ_buff_sink* sink, circ_buff_dump_format format)
+{
+    circ_buff_span spans[2];
+    uint32_t occupied=circ_buff_occupied(cb);
     
-    }    
-    /*the above scenarios encompass all the buffer states*/ 
+    /*check if there's data to be dumped in the first place*/ 
+    if(occupied==0)
+	 return CIRC_BUFF_EMPTY;                      
+
+    circ_buff_spans(cb, cb->head, occupied, spans);
+
+    /*raw elements go straight from the storage to the kernel*/
+    if(format==CIRC_BUFF_DUMP_BINARY)
+    {
+         struct iovec iov[2];
+         iov[0].iov_base=spans[0].data;
+         iov[0].iov_len=sizeof(uint32_t)*spans[0].count;
+         iov[1].iov_base=spans[1].data;
+         iov[1].iov_len=sizeof(uint32_t)*spans[1].count;
+         return circ_buff_sink_writev(sink, iov, spans[1].count ? 2 : 1);
+    }
+    if(format!=CIRC_BUFF_DUMP_TEXT)
+         return CIRC_BUFF_BAD_DATA;
+
+    /*room for the longest element, "4294967295\t", and the closing '\n' is kept free at the end*/
+    char staging[CIRC_BUFF_DUMP_STAGING];
+    char* limit=staging+sizeof(staging)-12;
+    char* out=staging;
+    struct iovec iov;
+    int span;
+    uint32_t index;
+
+    /*heading*/ 
+    memcpy(out, "Buffer Data:\n", 13);
+    out+=13;
+
+    for(span=0; span<2; span++)
+    {
+         for(index=0; index<spans[span].count; index++)
+         {
+              if(out>limit)
+              {
+                   iov.iov_base=staging;
+                   iov.iov_len=out-staging;
+                   if(circ_buff_sink_writev(sink, &iov, 1)!=CIRC_BUFF_SUCCESS)
+                        return CIRC_BUFF_WRITE_FAILED;
+                   out=staging;
+              }
+              out=circ_buff_format_u32(out, spans[span].data[index]);
+              *out++='\t';
+         }
+    }
+    *out++='\n';
+
+    iov.iov_base=staging;
+    iov.iov_len=out-staging;
+    return circ_buff_sink_writev(sink, &iov, 1);
+}
+
+
+/*								                
+ * Function:     circ_buff_dump_fd(circ_buff_ptr circ_buff_pointer, int fd,
+ *                                 circ_buff_dump_format format)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes the elements held, oldest first, to fd.
+ *               
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_EMPTY,
+ *               CIRC_BUFF_WRITE_FAILED or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_dump_fd(circ_buff_ptr circ_buff_pointer, int fd, circ_buff_dump_format format)
+{
+    /*basic pointer check; error handling*/	
+    if(circ_buff_pointer==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+    if(fd<0)
+         return CIRC_BUFF_BAD_DATA;
+
+    circ_buff_sink sink={fd, NULL};
+    return circ_buff_dump_sink(circ_buff_pointer, &sink, format);
+}
+
+
+/*								                
+ * Function:     circ_buff_dump_file(circ_buff_ptr circ_buff_pointer, FILE* file,
+ *                                   circ_buff_dump_format format)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes the elements held, oldest first, to a stdio stream.
+ *               
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_EMPTY,
+ *               CIRC_BUFF_WRITE_FAILED or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_dump_file(circ_buff_ptr circ_buff_pointer, FILE* file, circ_buff_dump_format format)
+{
+    /*basic pointer check; error handling*/	
+    if(circ_buff_pointer==NULL||file==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+
+    circ_buff_sink sink={-1, file};
+    return circ_buff_dump_sink(circ_buff_pointer, &sink, format);
+}
+
+
+/*								                
+ * Function:     circ_buff_checksum(uint64_t sum, const void* data, size_t bytes)
+ * -----------------------------------------------------------------------------
+ * Description:  Fletcher style checksum over 32 bit words, continued from 
+ *               'sum'. bytes must be a multiple of four. Two running sums make
+ *               it sensitive to the order of the words, not just their values.
+ * ----------------------------------------------------------------------------
+ */
+static uint64_t circ_buff_checksum(uint64_t sum, const void* data, size_t bytes)
+{
+    const uint32_t* word=(const uint32_t*)data;
+    uint64_t low=(uint32_t)sum, high=sum>>32;
+    size_t index, count=bytes/sizeof(uint32_t);
+
+    for(index=0; index<count; index++)
+    {
+         low+=word[index];
+         high+=low;
+
+         /*fold before either sum can overflow 64 bits*/
+         if((index&0xffff)==0xffff)
+         {
+              low=(low&0xffffffffu)+(low>>32);
+              high=(high&0xffffffffu)+(high>>32);
+         }
+    }
+    low=(low&0xffffffffu)+(low>>32);
+    high=(high&0xffffffffu)+(high>>32);
+    return (high<<32)^low;
+}
+
+
+/*								                
+ * Function:     circ_buff_snapshot_checksum(const circ_buff_snapshot_header* header,
+ *                                           const uint32_t* storage)
+ * -----------------------------------------------------------------------------
+ * Description:  Checksum of a header, with its checksum field taken as zero,
+ *               followed by the storage it describes.
+ * ----------------------------------------------------------------------------
+ */
+static uint64_t circ_buff_snapshot_checksum(const circ_buff_snapshot_header* header, const uint32_t* storage)
+{
+    /*copied into words so the header is not read through a uint32_t* alias*/
+    uint32_t words[sizeof(circ_buff_snapshot_header)/sizeof(uint32_t)];
+    memcpy(words, header, sizeof(words));
+    memset((uint8_t*)words+offsetof(circ_buff_snapshot_header, checksum), 0, sizeof(header->checksum));
+
+    uint64_t sum=circ_buff_checksum(0, words, sizeof(words));
+    return circ_buff_checksum(sum, storage, sizeof(uint32_t)*((size_t)header->mask+1));
+}
+
+
+/*								                
+ * Function:     circ_buff_snapshot_save(circ_buff_ptr circ_buff_pointer, int fd)
+ * -----------------------------------------------------------------------------
+ * Description:  Fills in a header and writes it and the storage with one 
+ *               writev.
+ * 
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_WRITE_FAILED
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_snapshot_save(circ_buff_ptr circ_buff_pointer, int fd)
+{
+    /*basic pointer check; error handling*/	
+    if(circ_buff_pointer==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+    if(fd<0)
+         return CIRC_BUFF_BAD_DATA;
+
+    circ_buff_snapshot_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic=CIRC_BUFF_SNAPSHOT_MAGIC;
+    header.version=CIRC_BUFF_SNAPSHOT_VERSION;
+    header.total_size=circ_buff_pointer->total_size;
+    header.mask=circ_buff_pointer->mask;
+    header.head=circ_buff_pointer->head;
+    header.tail=circ_buff_pointer->tail;
+    header.mode=circ_buff_pointer->mode&(CIRC_BUFF_MODE_POW2|CIRC_BUFF_MODE_OVERWRITE);
+    header.dropped=circ_buff_pointer->dropped;
+    header.checksum=circ_buff_snapshot_checksum(&header, circ_buff_pointer->base);
+
+    struct iovec iov[2];
+    iov[0].iov_base=&header;
+    iov[0].iov_len=sizeof(header);
+    iov[1].iov_base=circ_buff_pointer->base;
+    iov[1].iov_len=sizeof(uint32_t)*((size_t)header.mask+1);
+
+    circ_buff_sink sink={fd, NULL};
+    return circ_buff_sink_writev(&sink, iov, 2);
+}
+
+
+/*								                
+ * Function:     circ_buff_snapshot_load(circ_buff_ptr* circ_buff_pointer, int fd)
+ * -----------------------------------------------------------------------------
+ * Description:  Maps the snapshot file copy-on-write, checks it and adopts 
+ *               the storage behind the header as base.
+ * 
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_snapshot_load(circ_buff_ptr* circ_buff_pointer, int fd)
+{
+    /*basic pointer check; error handling*/	
+    if(circ_buff_pointer==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+
+    struct stat st;
+    if(fd<0||fstat(fd, &st)!=0||(size_t)st.st_size<sizeof(circ_buff_snapshot_header))
+         return CIRC_BUFF_BAD_DATA;
+
+    uint8_t* map=(uint8_t*)mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if(map==MAP_FAILED)
+         return CIRC_BUFF_MALLOC_FAIL;
+
+    /*the header must describe exactly this file*/
+    const circ_buff_snapshot_header* header=(const circ_buff_snapshot_header*)map;
+    uint32_t* storage=(uint32_t*)(map+sizeof(circ_buff_snapshot_header));
+    size_t storage_bytes=sizeof(uint32_t)*((size_t)header->mask+1);
+    if(header->magic!=CIRC_BUFF_SNAPSHOT_MAGIC||header->version!=CIRC_BUFF_SNAPSHOT_VERSION
+       ||((header->mask+1)&header->mask)!=0||header->mask>=CIRC_BUFF_MAX_SIZE
+       ||header->total_size==0||header->total_size>header->mask+1
+       ||header->tail-header->head>header->total_size
+       ||(size_t)st.st_size!=sizeof(circ_buff_snapshot_header)+storage_bytes
+       ||header->checksum!=circ_buff_snapshot_checksum(header, storage))
+    {
+         munmap(map, st.st_size);
+         return CIRC_BUFF_BAD_DATA;
+    }
+
+    circ_buff_ptr cb=(circ_buff_ptr)malloc(sizeof(circ_buff));
+    if(cb==NULL)
+    {
+         munmap(map, st.st_size);
+         return CIRC_BUFF_MALLOC_FAIL;
+    }
+
+    cb->base=storage;
+    cb->head=header->head;
+    cb->tail=header->tail;
+    cb->total_size=header->total_size;
+    cb->mask=header->mask;
+    cb->mode=(header->mode&(CIRC_BUFF_MODE_POW2|CIRC_BUFF_MODE_OVERWRITE))|CIRC_BUFF_MODE_MAPPED;
+    cb->grow_limit=0;
+    cb->dropped=header->dropped;
+
+#ifdef CIRC_BUFF_STATS
+    /*write times are not saved; the loaded elements get zero stamps*/
+    memset(&cb->stats, 0, sizeof(circ_buff_stats));
+    cb->stamps=(uint64_t*)calloc((size_t)cb->mask+1, sizeof(uint64_t));
+    if(cb->stamps==NULL)
+    {
+         circ_buff_destroy(cb);
+         return CIRC_BUFF_MALLOC_FAIL;
+    }
+#endif
+
+    *circ_buff_pointer=cb;
     return CIRC_BUFF_SUCCESS;
 }
+
+
+/*								                
+ * Function:     dump(circ_buff_ptr cb)
+ * -----------------------------------------------------------------------------
+ * Description:  Dumps all data from the circular buffer pointed by circ_buff_ptr
+ *               as text in the file named by FILE_NAME, and closes it.
+ *               
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_FILE_OPEN_FAILED, CIRC_BUFF_EMPTY,
+ *               CIRC_BUFF_WRITE_FAILED or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code dump(circ_buff_ptr cb)
+{
+    /*basic pointer check; error handling*/	
+    if(cb==NULL)
+	 return CIRC_BUFF_NULL_PTR;
+
+    /*check if there's data to be dumped in the first place*/ 
+    if(circ_buff_occupied(cb)==0)
+	 return CIRC_BUFF_EMPTY;                      
+    
+    /*open a file*/ 
+    int fd=open(FILE_NAME, O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+    if(fd<0)
+	 return CIRC_BUFF_FILE_OPEN_FAILED;
+
+    circ_buff_code rc=circ_buff_dump_fd(cb, fd, CIRC_BUFF_DUMP_TEXT);
+    if(close(fd)!=0&&rc==CIRC_BUFF_SUCCESS)
+         rc=CIRC_BUFF_WRITE_FAILED;
+    return rc;
+}
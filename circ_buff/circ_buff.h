@@ -3,16 +3,71 @@
 #ifndef _CIRC_BUFF_H
 #define _CIRC_BUFF_H  
 #include<stdint.h>
+#include<stdio.h>
+#include "circ_buff_stats.h"
 #define FILE_NAME "stdout"
 
-typedef enum {CIRC_BUFF_SUCCESS, CIRC_BUFF_NULL_PTR, CIRC_BUFF_MALLOC_FAIL, CIRC_BUFF_BAD_DATA, CIRC_BUFF_EMPTY, CIRC_BUFF_FULL, CIRC_BUFF_CAN_WRITE, CIRC_BUFF_CAN_READ, CIRC_BUFF_FILE_OPEN_FAILED} circ_buff_code;
+/*bytes staged before a text dump is handed to the kernel*/
+#define CIRC_BUFF_DUMP_STAGING (1u<<16)
+
+/*identifies a snapshot file and its layout*/
+#define CIRC_BUFF_SNAPSHOT_MAGIC   0x4e534243u
+#define CIRC_BUFF_SNAPSHOT_VERSION 1u
+
+/*largest number of elements a circular buffer can hold*/
+#define CIRC_BUFF_MAX_SIZE (1u<<30)
+
+/*size of a cache line on the targets we care about*/
+#define CIRC_BUFF_CACHE_LINE 64
+
+/*huge page size CIRC_BUFF_MODE_HUGEPAGE maps in*/
+#define CIRC_BUFF_HUGE_PAGE (2u<<20)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {CIRC_BUFF_SUCCESS, CIRC_BUFF_NULL_PTR, CIRC_BUFF_MALLOC_FAIL, CIRC_BUFF_BAD_DATA, CIRC_BUFF_EMPTY, CIRC_BUFF_FULL, CIRC_BUFF_CAN_WRITE, CIRC_BUFF_CAN_READ, CIRC_BUFF_FILE_OPEN_FAILED, CIRC_BUFF_WRITE_FAILED} circ_buff_code;
+
+
+/*mode flags for circ_buff_init_mode; OR them together*/
+typedef enum {CIRC_BUFF_MODE_DEFAULT=0, CIRC_BUFF_MODE_POW2=1<<0, CIRC_BUFF_MODE_OVERWRITE=1<<1, CIRC_BUFF_MODE_MIRROR=1<<2, CIRC_BUFF_MODE_MAPPED=1<<3,
+              CIRC_BUFF_MODE_HUGEPAGE=1<<4, CIRC_BUFF_MODE_EXTERNAL=1<<5, CIRC_BUFF_MODE_SINGLE=1<<6} circ_buff_mode;
+
+/*output formats for circ_buff_dump_fd/circ_buff_dump_file*/
+typedef enum {CIRC_BUFF_DUMP_TEXT, CIRC_BUFF_DUMP_BINARY} circ_buff_dump_format;
 
 
 /*								                
  * Structure:    circ_buff 
  * -----------------------------------------------------------------------------
  * Description:  A circular buffer structure that tracks the head, the tail, 
- *               the total size and the current size of the circular buffer.
+ *               the total size and the storage mask of the circular buffer.
+ *
+ *               The storage holds mask+1 elements, always a power of two.
+ *               head and tail are free-running 32 bit indices; the slot of an
+ *               index is index&mask, and the number of elements held is
+ *               tail-head, which unsigned arithmetic keeps right across the
+ *               32 bit wrap. There is no separate occupancy counter.
+ *
+ *               'dropped' counts the elements overwritten in 
+ *               CIRC_BUFF_MODE_OVERWRITE.
+ *
+ *               'grow_limit' is the capacity circ_buff_autogrow may grow the
+ *               buffer to when it fills; zero means it never grows.
+ *
+ *               In CIRC_BUFF_MODE_MIRROR base[i] and base[i+mask+1] are the
+ *               same memory, so base may be indexed up to 2*(mask+1).
+ *
+ *               CIRC_BUFF_MODE_MAPPED is set by circ_buff_snapshot_load when
+ *               base points into a mapped snapshot file; it can not be asked 
+ *               for in circ_buff_init_mode. Likewise CIRC_BUFF_MODE_EXTERNAL 
+ *               marks storage owned by the caller (circ_buff_init_storage) and
+ *               CIRC_BUFF_MODE_SINGLE storage that shares one allocation with
+ *               the structure (circ_buff_init_single).
+ *
+ *               With CIRC_BUFF_STATS defined, 'stats' holds the counters and 
+ *               stamps[slot] the time the element in that slot was written.
  *           
  * Usage:        Use regular structure syntax to access any of the members of 
  *               this structure       
@@ -26,12 +81,39 @@ typedef struct circ_buff *circ_buff_ptr;
 typedef struct circ_buff
 {
     uint32_t *base;
-    uint32_t *head;
-    uint32_t *tail;
+    uint32_t  head;
+    uint32_t  tail;
     uint32_t  total_size;
-    uint32_t  size_occupied;
+    uint32_t  mask;
+    uint32_t  mode;
+    uint32_t  grow_limit;
+    uint64_t  dropped;
+#ifdef CIRC_BUFF_STATS
+    uint64_t *stamps;
+    circ_buff_stats stats;
+#endif
 }circ_buff;
 
+/*number of elements held; branch free*/
+static inline uint32_t circ_buff_occupied(const circ_buff* cb)
+{
+    return cb->tail-cb->head;
+}
+
+
+/*								                
+ * Structure:    circ_buff_span 
+ * -----------------------------------------------------------------------------
+ * Description:  A contiguous run of 'count' elements inside the storage of a
+ *               circular buffer. A region that wraps is described by two spans.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_span
+{
+    uint32_t *data;
+    uint32_t  count;
+}circ_buff_span;
+
 
 /*								                
  * Function:     circ_buff_init(circ_buff_ptr* circ_buff_pointer, int16_t size)
@@ -39,7 +121,7 @@ typedef struct circ_buff
  * Description:  Assigns memory specified by 'size' to the circular buffer 
  *               structure pointed to by the pointer argument on the heap. 
  *               Also initialises various parameters to this buffer, like the 
- *               head, tail, total size, and size_occupied, etc.  
+ *               head, tail, total size, etc.  
  *              
  *           
  * Usage:        Pass a pointer to the ptr of the circular buffer struc which 
@@ -58,6 +140,95 @@ typedef struct circ_buff
  *               CIRC_BUFF_SUCCESS: The funcion returns successfully.
  */
 circ_buff_code circ_buff_init(circ_buff_ptr* circ_buff_pointer, int32_t size);
+/*								                
+ * Function:     circ_buff_init_mode(circ_buff_ptr* circ_buff_pointer, 
+ *                                   int32_t size, uint32_t mode)
+ * -----------------------------------------------------------------------------
+ * Description:  Same as circ_buff_init, with mode flags chosen at init time.
+ *
+ *               The storage is always a power of two elements long, so that a 
+ *               free-running index maps to its slot with a mask. Without 
+ *               CIRC_BUFF_MODE_POW2 the capacity stays exactly 'size' and the
+ *               rest of the storage is unused; with it the capacity is rounded
+ *               up to fill the storage.
+ *
+ *               With CIRC_BUFF_MODE_OVERWRITE a write to a full buffer drops
+ *               the oldest element instead of failing (a flight recorder).
+ *
+ *               With CIRC_BUFF_MODE_MIRROR the storage is mapped twice back
+ *               to back in virtual memory, so any run of up to total_size
+ *               elements from any slot is contiguous and circ_buff_peek/
+ *               circ_buff_reserve return a single span. The storage is then
+ *               at least one page. If the mapping can not be made the heap is
+ *               used and the flag is cleared in cb->mode.
+ *
+ *               With CIRC_BUFF_MODE_HUGEPAGE storage of CIRC_BUFF_HUGE_PAGE
+ *               bytes or more is mapped from explicit huge pages if the 
+ *               system has some reserved, and otherwise mapped huge page
+ *               aligned and marked for transparent huge pages, which cuts the
+ *               TLB misses of a big ring. Smaller storage comes from the heap
+ *               and the flag is cleared. CIRC_BUFF_MODE_MIRROR takes 
+ *               precedence.
+ *           
+ * Usage:        Pass a pointer to the ptr of the circular buffer, the size in 
+ *               elements and an OR of circ_buff_mode flags.
+ * 
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_POINTER: The pointer passed is detected to be a 
+ *               null. The function halts execution and returns w/o completion.   
+ *                  
+ *               CIRC_BUFF_BAD_DATA: The size parameter is less than or equal 
+ *               to zero or larger than CIRC_BUFF_MAX_SIZE.
+ *               
+ *               CIRC_BUFF_MALLOC_FAIL: The call to malloc fails.
+ *
+ *               CIRC_BUFF_SUCCESS: The funcion returns successfully.
+ */
+circ_buff_code circ_buff_init_mode(circ_buff_ptr* circ_buff_pointer, int32_t size, uint32_t mode);
+/*								                
+ * Function:     circ_buff_init_storage(circ_buff_ptr* circ_buff_pointer, 
+ *                                      uint32_t* storage, int32_t elements,
+ *                                      uint32_t mode)
+ * -----------------------------------------------------------------------------
+ * Description:  Same as circ_buff_init_mode, but the elements live in memory
+ *               the caller owns: a static array, an arena, NUMA-local memory.
+ *               The largest power of two that fits in 'elements' is used and
+ *               that is also the capacity. circ_buff_destroy frees only the 
+ *               structure; the storage must outlive the buffer. 
+ *
+ *               Only CIRC_BUFF_MODE_OVERWRITE and CIRC_BUFF_MODE_POW2 are 
+ *               used. circ_buff_resize moves the data to the heap and leaves
+ *               the caller's storage alone from then on.
+ *           
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: A pointer passed is a NULL.
+ *                  
+ *               CIRC_BUFF_BAD_DATA: elements is less than or equal to zero or
+ *               larger than CIRC_BUFF_MAX_SIZE, or storage is not aligned for
+ *               uint32_t.
+ *               
+ *               CIRC_BUFF_MALLOC_FAIL: The structure can not be allocated.
+ *
+ *               CIRC_BUFF_SUCCESS: The funcion returns successfully.
+ */
+circ_buff_code circ_buff_init_storage(circ_buff_ptr* circ_buff_pointer, uint32_t* storage, int32_t elements, uint32_t mode);
+/*								                
+ * Function:     circ_buff_init_single(circ_buff_ptr* circ_buff_pointer, 
+ *                                     int32_t size, uint32_t mode)
+ * -----------------------------------------------------------------------------
+ * Description:  Same as circ_buff_init_mode, but the structure and the storage
+ *               are one CIRC_BUFF_CACHE_LINE aligned allocation, with the 
+ *               storage starting on the first cache line after the structure.
+ *               One malloc, one free, and no pointer chase to a far away 
+ *               block.
+ *
+ *               Only CIRC_BUFF_MODE_OVERWRITE and CIRC_BUFF_MODE_POW2 are 
+ *               used. circ_buff_resize moves the data to a separate heap block.
+ *           
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL or
+ *               CIRC_BUFF_SUCCESS, as circ_buff_init_mode.
+ */
+circ_buff_code circ_buff_init_single(circ_buff_ptr* circ_buff_pointer, int32_t size, uint32_t mode);
 /*								                
  * Function:     circ_buff_destroy(circ_buff_ptr circ_buff_ptr)
  * -----------------------------------------------------------------------------
@@ -78,6 +249,57 @@ circ_buff_code circ_buff_init(circ_buff_ptr* circ_buff_pointer, int32_t size);
  * ----------------------------------------------------------------------------
  */
 circ_buff_code circ_buff_destroy(circ_buff_ptr circ_buff_pointer);
+/*								                
+ * Function:     circ_buff_resize(circ_buff_ptr circ_buff_pointer, int32_t size)
+ * -----------------------------------------------------------------------------
+ * Description:  Changes the capacity of a buffer that may hold data, keeping
+ *               the elements held and their order. Heap storage is grown or 
+ *               shrunk with realloc, and only the smaller of the two segments
+ *               of a wrapped buffer is moved. Mirrored or mapped storage is 
+ *               copied into a new block. CIRC_BUFF_MODE_POW2 rounds the new
+ *               capacity up as circ_buff_init_mode does.
+ *
+ *               Any spans from circ_buff_reserve/circ_buff_peek are invalid 
+ *               afterwards.
+ *           
+ * Usage:        Pass a pointer to the circular buffer and the new size in 
+ *               elements.
+ * 
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: size is less than or equal to zero, larger
+ *               than CIRC_BUFF_MAX_SIZE, or smaller than the number of 
+ *               elements held. In CIRC_BUFF_MODE_OVERWRITE the oldest 
+ *               elements are dropped instead.
+ *
+ *               CIRC_BUFF_MALLOC_FAIL: The new storage can not be allocated;
+ *               the buffer is unchanged.
+ *
+ *               CIRC_BUFF_SUCCESS: The buffer now holds up to 'size' elements.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_resize(circ_buff_ptr circ_buff_pointer, int32_t size);
+/*								                
+ * Function:     circ_buff_autogrow(circ_buff_ptr circ_buff_pointer, int32_t limit)
+ * -----------------------------------------------------------------------------
+ * Description:  Lets the buffer grow on its own up to 'limit' elements. A 
+ *               write, write_n or reserve that finds too little free space 
+ *               first doubles the capacity (or more, for a large batch), 
+ *               clipped to the limit. Once the buffer can not grow, write and
+ *               write_n return CIRC_BUFF_FULL, or overwrite the oldest
+ *               elements in CIRC_BUFF_MODE_OVERWRITE; reserve never
+ *               overwrites and returns CIRC_BUFF_FULL in every mode when no
+ *               space is left. A limit of zero turns growing off, which is
+ *               the default. The limit is never
+ *               exceeded; in CIRC_BUFF_MODE_POW2 the buffer stops at the
+ *               largest power of two not above it.
+ * 
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA (limit negative or 
+ *               larger than CIRC_BUFF_MAX_SIZE) or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_autogrow(circ_buff_ptr circ_buff_pointer, int32_t limit);
 /*								                
  * Function:     if_circ_buff_full(circ_buff_ptr circ_buff_ptr)
  * -----------------------------------------------------------------------------
@@ -132,7 +354,9 @@ circ_buff_code if_circ_buff_empty(circ_buff_ptr circ_buff_pointer);
  *               returns.
  *
  *               CIRC_BUFF_FULL: The buffer is currently full and thus new
- *               data can not be written to it.
+ *               data can not be written to it. Never returned in 
+ *               CIRC_BUFF_MODE_OVERWRITE; there the oldest element is dropped
+ *               instead and the dropped counter is incremented.
  *
  *               CIRC_BUFF_SUCCESS: The function completes execution 
  *               successfully.   
@@ -167,10 +391,371 @@ circ_buff_code circ_buff_read(circ_buff_ptr circ_buff_pointer, uint32_t* data);
 
 
 /*								                
- * Function:     circ_buff_dump(circ_buff_ptr cb)
+ * Function:     circ_buff_size(circ_buff_ptr circ_buff_pointer, uint32_t* size)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the number of elements currently held in *size.
+ *                
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: Either of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_SUCCESS: *size is valid.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_size(circ_buff_ptr circ_buff_pointer, uint32_t* size);
+
+/*								                
+ * Function:     circ_buff_dropped(circ_buff_ptr circ_buff_pointer, uint64_t* dropped)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns in *dropped the number of elements discarded so far by
+ *               writes to a full buffer in CIRC_BUFF_MODE_OVERWRITE. Always 
+ *               zero in the other modes.
+ *                
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: Either of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_SUCCESS: *dropped is valid.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_dropped(circ_buff_ptr circ_buff_pointer, uint64_t* dropped);
+
+#ifdef CIRC_BUFF_STATS
+/*								                
+ * Function:     circ_buff_stats_get(circ_buff_ptr circ_buff_pointer, 
+ *                                   circ_buff_stats* stats)
+ * -----------------------------------------------------------------------------
+ * Description:  Copies the counters of the circular buffer into *stats. Only
+ *               built with CIRC_BUFF_STATS. Overwritten elements count in 
+ *               circ_buff_dropped, not in the residency histogram.
+ *                
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: Either of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_SUCCESS: *stats is valid.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_stats_get(circ_buff_ptr circ_buff_pointer, circ_buff_stats* stats);
+#endif
+
+/*								                
+ * Function:     circ_buff_write_n(circ_buff_ptr circ_buff_pointer, 
+ *                                 const uint32_t* data, uint32_t count,
+ *                                 uint32_t* written)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes up to 'count' elements from data to the circular buffer
+ *               in at most two memcpy calls: one up to the end of the storage
+ *               and one from base after the wrap.
+ *               
+ * Usage:        Pass a pointer to the circular buffer, the array to be written,
+ *               its length and a pointer to a uint32_t that receives the number
+ *               of elements actually written. If there is less free space than
+ *               'count', only as many elements as fit are written.
+ * 
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: One of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_FULL: count is non-zero but the buffer is full; 
+ *               *written is zero. In CIRC_BUFF_MODE_OVERWRITE the oldest 
+ *               elements are dropped to make room instead, so all 'count' 
+ *               elements are accepted and only the newest total_size of 
+ *               them are kept.
+ *
+ *               CIRC_BUFF_SUCCESS: *written elements were written.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_write_n(circ_buff_ptr circ_buff_pointer, const uint32_t* data, uint32_t count, uint32_t* written);
+
+/*								                
+ * Function:     circ_buff_read_n(circ_buff_ptr circ_buff_pointer, uint32_t* data,
+ *                                uint32_t count, uint32_t* read)
+ * -----------------------------------------------------------------------------
+ * Description:  Reads up to 'count' elements from the head of the circular
+ *               buffer into data in at most two memcpy calls.
+ *               
+ * Usage:        Pass a pointer to the circular buffer, an array with room for
+ *               'count' elements, 'count' and a pointer to a uint32_t that 
+ *               receives the number of elements actually read. 
+ * 
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: One of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_EMPTY: count is non-zero but the buffer is empty; 
+ *               *read is zero.
+ *
+ *               CIRC_BUFF_SUCCESS: *read elements were read.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_read_n(circ_buff_ptr circ_buff_pointer, uint32_t* data, uint32_t count, uint32_t* read);
+
+
+/*								                
+ * Function:     circ_buff_reserve(circ_buff_ptr circ_buff_pointer, uint32_t count,
+ *                                 circ_buff_span spans[2], uint32_t* reserved)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns up to two writable spans of free storage starting at
+ *               the tail, covering up to 'count' elements in total. Nothing
+ *               is published until circ_buff_commit is called.
+ *               
+ * Usage:        Pass a pointer to the circular buffer, the number of elements
+ *               wanted, an array of two spans and a pointer to a uint32_t that
+ *               receives the number of elements actually reserved. Fill 
+ *               spans[0] first, then spans[1], and commit what was filled.
+ * 
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: One of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_FULL: The buffer is full; *reserved is zero.
+ *
+ *               CIRC_BUFF_SUCCESS: *reserved elements are available.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_reserve(circ_buff_ptr circ_buff_pointer, uint32_t count, circ_buff_span spans[2], uint32_t* reserved);
+
+/*								                
+ * Function:     circ_buff_commit(circ_buff_ptr circ_buff_pointer, uint32_t count)
+ * -----------------------------------------------------------------------------
+ * Description:  Publishes 'count' elements written into the spans returned by
+ *               circ_buff_reserve by moving the tail past them.
+ *               
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: count is larger than the free space; 
+ *               nothing is committed.
+ *
+ *               CIRC_BUFF_SUCCESS: The elements are now readable.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_commit(circ_buff_ptr circ_buff_pointer, uint32_t count);
+
+/*								                
+ * Function:     circ_buff_peek(circ_buff_ptr circ_buff_pointer, uint32_t count,
+ *                              circ_buff_span spans[2], uint32_t* available)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns up to two readable spans starting at the head, covering
+ *               up to 'count' elements in total. The elements stay in the 
+ *               buffer until circ_buff_release is called.
+ *               
+ * Usage:        Pass a pointer to the circular buffer, the number of elements
+ *               wanted, an array of two spans and a pointer to a uint32_t that
+ *               receives the number of elements actually available. 
+ * 
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: One of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_EMPTY: The buffer is empty; *available is zero.
+ *
+ *               CIRC_BUFF_SUCCESS: *available elements can be read in place.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_peek(circ_buff_ptr circ_buff_pointer, uint32_t count, circ_buff_span spans[2], uint32_t* available);
+
+/*								                
+ * Structure:    circ_buff_iter 
+ * -----------------------------------------------------------------------------
+ * Description:  A read-only cursor over the elements a circular buffer held 
+ *               when circ_buff_iter_begin was called, oldest first. Nothing is
+ *               consumed. Reads during the walk are fine; writes are too, 
+ *               except in CIRC_BUFF_MODE_OVERWRITE, where they may replace 
+ *               elements not yet visited. A resize invalidates the iterator.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_iter
+{
+    const uint32_t *base;
+    uint32_t  mask;
+    uint32_t  mirror;
+    uint32_t  index;
+    uint32_t  end;
+}circ_buff_iter;
+
+/*								                
+ * Function:     circ_buff_iter_begin(circ_buff_ptr circ_buff_pointer, circ_buff_iter* iter)
+ * -----------------------------------------------------------------------------
+ * Description:  Points iter at the oldest element held.
+ * 
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY (nothing to visit) or 
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_iter_begin(circ_buff_ptr circ_buff_pointer, circ_buff_iter* iter);
+
+/*								                
+ * Function:     circ_buff_iter_span(circ_buff_iter* iter, circ_buff_span* span)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the rest of the current contiguous run of elements 
+ *               and moves past it. A wrapped buffer takes two calls, a 
+ *               mirrored one always one.
+ * 
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY (nothing left) or 
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_iter_span(circ_buff_iter* iter, circ_buff_span* span);
+
+/*next element of the walk; CIRC_BUFF_EMPTY at the end. Inline, it is per element*/
+static inline circ_buff_code circ_buff_iter_next(circ_buff_iter* iter, uint32_t* data)
+{
+    if(iter->index==iter->end)
+         return CIRC_BUFF_EMPTY;
+    *data=iter->base[iter->index&iter->mask];
+    iter->index++;
+    return CIRC_BUFF_SUCCESS;
+}
+
+/*								                
+ * Function:     circ_buff_release(circ_buff_ptr circ_buff_pointer, uint32_t count)
+ * -----------------------------------------------------------------------------
+ * Description:  Frees 'count' elements at the head, typically after they have
+ *               been consumed through circ_buff_peek.
+ *               
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: count is larger than the number of 
+ *               elements stored; nothing is released.
+ *
+ *               CIRC_BUFF_SUCCESS: The elements are released.   
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_release(circ_buff_ptr circ_buff_pointer, uint32_t count);
+
+
+/*								                
+ * Function:     circ_buff_dump_fd(circ_buff_ptr circ_buff_pointer, int fd,
+ *                                 circ_buff_dump_format format)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes the elements held, oldest first, to the file 
+ *               descriptor fd. The buffer is not modified.
+ *
+ *               CIRC_BUFF_DUMP_TEXT: a "Buffer Data:" heading, then each 
+ *               element in decimal followed by a tab, then a newline. The text
+ *               is built in a CIRC_BUFF_DUMP_STAGING byte buffer and written
+ *               once per full staging buffer.
+ *
+ *               CIRC_BUFF_DUMP_BINARY: the elements as raw native endian 
+ *               uint32_t, written straight from the storage with one writev.
+ *               
+ * Usage:        Pass a pointer to the circular buffer, an open fd and the 
+ *               format. The fd is not closed.
+ * 
+ * Returns:      Error/Status codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: fd is negative or format is unknown.
+ *
+ *               CIRC_BUFF_EMPTY: The buffer is empty; nothing is written.
+ *
+ *               CIRC_BUFF_WRITE_FAILED: A write to fd fails.
+ *               
+ *               CIRC_BUFF_SUCCESS: Everything is written.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_dump_fd(circ_buff_ptr circ_buff_pointer, int fd, circ_buff_dump_format format);
+
+
+/*								                
+ * Function:     circ_buff_dump_file(circ_buff_ptr circ_buff_pointer, FILE* file,
+ *                                   circ_buff_dump_format format)
+ * -----------------------------------------------------------------------------
+ * Description:  As circ_buff_dump_fd, but writes to a stdio stream with 
+ *               fwrite, in the same staging buffer sized pieces. The stream
+ *               is not flushed or closed.
+ * 
+ * Returns:      As circ_buff_dump_fd.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_dump_file(circ_buff_ptr circ_buff_pointer, FILE* file, circ_buff_dump_format format);
+
+
+/*								                
+ * Structure:    circ_buff_snapshot_header 
+ * -----------------------------------------------------------------------------
+ * Description:  The first bytes of a snapshot file. The whole storage, mask+1
+ *               native endian uint32_t, follows right after it, so a slot
+ *               keeps its position and head/tail can be used as they are.
+ *
+ *               checksum covers this header (with checksum taken as zero) and
+ *               the storage. The header is one cache line long so that the
+ *               storage that follows stays aligned when the file is mapped.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_snapshot_header
+{
+    uint32_t  magic;
+    uint32_t  version;
+    uint32_t  total_size;
+    uint32_t  mask;
+    uint32_t  head;
+    uint32_t  tail;
+    uint32_t  mode;
+    uint32_t  reserved;
+    uint64_t  dropped;
+    uint64_t  checksum;
+    uint8_t   padding[CIRC_BUFF_CACHE_LINE-48];
+}circ_buff_snapshot_header;
+
+
+/*								                
+ * Function:     circ_buff_snapshot_save(circ_buff_ptr circ_buff_pointer, int fd)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes a snapshot of the circular buffer (header and storage)
+ *               to fd with one sequential writev, starting at the current 
+ *               file offset. The buffer is not modified.
+ *
+ * Usage:        Pass a pointer to the circular buffer and an fd opened for
+ *               writing, normally on a fresh or truncated file. Write to a
+ *               temporary name and rename() it for an atomic replace.
+ * 
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: fd is negative.
+ *
+ *               CIRC_BUFF_WRITE_FAILED: The write fails.
+ *               
+ *               CIRC_BUFF_SUCCESS: The snapshot is written.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_snapshot_save(circ_buff_ptr circ_buff_pointer, int fd);
+
+
+/*								                
+ * Function:     circ_buff_snapshot_load(circ_buff_ptr* circ_buff_pointer, int fd)
+ * -----------------------------------------------------------------------------
+ * Description:  Rebuilds a circular buffer from a snapshot file by mapping it
+ *               privately and adopting the mapped storage as base; elements
+ *               are never copied or parsed one by one. Writes to the buffer
+ *               afterwards do not change the file. The checksum is verified
+ *               before the buffer is handed out.
+ *
+ *               The loaded buffer works like any other and is released with
+ *               circ_buff_destroy. A snapshot of a mirror mode buffer comes 
+ *               back without the mirror.
+ *
+ * Usage:        Pass a pointer to a circ_buff ptr and an fd open for reading
+ *               on a snapshot file. The fd may be closed afterwards.
+ * 
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: The file is not a snapshot of this 
+ *               version, its size does not match the header, or the checksum
+ *               does not match.
+ *
+ *               CIRC_BUFF_MALLOC_FAIL: mmap or the structure allocation fails.
+ *               
+ *               CIRC_BUFF_SUCCESS: *circ_buff_pointer holds the snapshot.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_snapshot_load(circ_buff_ptr* circ_buff_pointer, int fd);
+
+
+/*								                
+ * Function:     dump(circ_buff_ptr cb)
  * -----------------------------------------------------------------------------
  * Description:  Dumps all data from the circular buffer pointed by circ_buff_ptr
- *               in a file in the same directory whose name is defined by FILE_NAME
+ *               as text in a file in the same directory whose name is defined 
+ *               by FILE_NAME. The file is truncated first and closed after.
  *               
  * Usage:        Pass a pointer to the circular buffer.
  * 
@@ -179,10 +764,12 @@ circ_buff_code circ_buff_read(circ_buff_ptr circ_buff_pointer, uint32_t* data);
  *               NULL and is thus invalid. The function halts execution and 
  *               returns.
  *               
- *               CIRC_BUFF_FILE_OPEN_FAILED: Call to fopen failed.
+ *               CIRC_BUFF_FILE_OPEN_FAILED: Call to open failed.
  *
  *               CIRC_BUFF_EMPTY: The buffer is currently empty and thus can
  *               not return any data.
+ *
+ *               CIRC_BUFF_WRITE_FAILED: Writing the file fails.
  *               
  *               CIRC_BUFF_SUCCESS: The function completes execution 
  *               completely.
@@ -190,4 +777,8 @@ circ_buff_code circ_buff_read(circ_buff_ptr circ_buff_pointer, uint32_t* data);
  */
 circ_buff_code dump(circ_buff_ptr cb);
 
-#endif    
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff.hpp
+ *
+ * Description:  C++ circular buffer with the element type and the capacity as
+ *               template parameters. It has the same semantics as circ_buff.h
+ *               (free-running head/tail indices, power of two storage, the
+ *               capacity kept exactly, circ_buff_code return values) but the
+ *               capacity and mask are constexpr and the storage lives inline,
+ *               so the hot path compiles down to a compare, a store and an
+ *               increment.
+ *
+ *               Elements are constructed in place in the storage and moved
+ *               out on read; nothing is default constructed up front.
+ *
+ * Usage:        circ::circ_buff<uint64_t, 1024> ring;
+ *               ring.write(stamp);
+ *               ring.emplace(a, b);      //constructs T(a, b) in the tail slot
+ *               ring.read(stamp);
+ *
+ * */
+
+#ifndef _CIRC_BUFF_HPP
+#define _CIRC_BUFF_HPP
+
+#include<cstddef>
+#include<cstdint>
+#include<new>
+#include<utility>
+#include<type_traits>
+#include "circ_buff.h"
+
+namespace circ
+{
+
+/*
+ * Class:        circ_buff<T, Capacity>
+ * -----------------------------------------------------------------------------
+ * Description:  A fixed capacity circular buffer of T. Not thread safe; use
+ *               circ_buff_spsc/circ_buff_mpmc to hand data between threads.
+ * ----------------------------------------------------------------------------
+ */
+template<typename T, std::uint32_t Capacity>
+class circ_buff
+{
+    static_assert(Capacity>0&&Capacity<=CIRC_BUFF_MAX_SIZE, "capacity out of range");
+
+    /*smallest power of two >= n*/
+    static constexpr std::uint32_t pow2_ceil(std::uint32_t n)
+    {
+         std::uint32_t storage=1;
+         while(storage<n)
+              storage<<=1;
+         return storage;
+    }
+
+public:
+    static constexpr std::uint32_t capacity=Capacity;
+    static constexpr std::uint32_t storage=pow2_ceil(Capacity);
+    static constexpr std::uint32_t mask=storage-1;
+
+    circ_buff() noexcept : head(0), tail(0) {}
+
+    /*destroys whatever is still held*/
+    ~circ_buff()
+    {
+         clear();
+    }
+
+    circ_buff(const circ_buff&)=delete;
+    circ_buff& operator=(const circ_buff&)=delete;
+
+    std::uint32_t size() const noexcept { return tail-head; }
+    bool empty() const noexcept { return tail==head; }
+    bool full() const noexcept { return tail-head==Capacity; }
+
+    /*constructs T(args...) in the tail slot*/
+    template<typename... Args>
+    circ_buff_code emplace(Args&&... args) noexcept(std::is_nothrow_constructible<T, Args&&...>::value)
+    {
+         if(full())
+              return CIRC_BUFF_FULL;
+         ::new(static_cast<void*>(slot(tail))) T(std::forward<Args>(args)...);
+         tail++;
+         return CIRC_BUFF_SUCCESS;
+    }
+
+    circ_buff_code write(const T& data) { return emplace(data); }
+    circ_buff_code write(T&& data) { return emplace(std::move(data)); }
+
+    /*moves the oldest element into data and destroys the slot*/
+    circ_buff_code read(T& data) noexcept(std::is_nothrow_move_assignable<T>::value)
+    {
+         if(empty())
+              return CIRC_BUFF_EMPTY;
+         T* element=slot(head);
+         data=std::move(*element);
+         element->~T();
+         head++;
+         return CIRC_BUFF_SUCCESS;
+    }
+
+    /*the oldest element in place, or nullptr when empty*/
+    T* front() noexcept { return empty() ? nullptr : slot(head); }
+
+    /*destroys the oldest element without reading it*/
+    circ_buff_code pop() noexcept
+    {
+         if(empty())
+              return CIRC_BUFF_EMPTY;
+         slot(head)->~T();
+         head++;
+         return CIRC_BUFF_SUCCESS;
+    }
+
+    void clear() noexcept
+    {
+         if(!std::is_trivially_destructible<T>::value)
+         {
+              while(!empty())
+                   pop();
+         }
+         head=tail;
+    }
+
+private:
+    T* slot(std::uint32_t index) noexcept
+    {
+         return std::launder(reinterpret_cast<T*>(&storage_bytes[(index&mask)*sizeof(T)]));
+    }
+
+    std::uint32_t head;
+    std::uint32_t tail;
+    alignas(alignof(T)>CIRC_BUFF_CACHE_LINE ? alignof(T) : CIRC_BUFF_CACHE_LINE)
+         unsigned char storage_bytes[sizeof(T)*storage];
+};
+
+}
+
+#endif
@@ -0,0 +1,456 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_bcast.c
+ *
+ * Description:  Contains the one writer, many reader broadcast buffer. See
+ *               circ_buff_bcast.h for the gate and the lapped read check.
+ *
+ * */
+
+
+#include "circ_buff_bcast.h"
+#include<stdint.h>
+#include<stdlib.h>
+#include<stdatomic.h>
+#include<string.h>
+#include<sched.h>
+
+
+/*
+ * Function:     circ_buff_bcast_lock(circ_buff_bcast_ptr bc)
+ * -----------------------------------------------------------------------------
+ * Description:  Takes the registration lock. It is only ever held for a walk
+ *               of the reader cursors, so a spin is enough; it yields in case
+ *               the holder is waiting for the same CPU.
+ * ----------------------------------------------------------------------------
+ */
+static inline void circ_buff_bcast_lock(circ_buff_bcast_ptr bc)
+{
+    while(atomic_flag_test_and_set_explicit(&bc->lock, memory_order_acquire))
+         sched_yield();
+}
+
+static inline void circ_buff_bcast_unlock(circ_buff_bcast_ptr bc)
+{
+    atomic_flag_clear_explicit(&bc->lock, memory_order_release);
+}
+
+/*
+ * Function:     circ_buff_bcast_refresh(circ_buff_bcast_ptr bc, uint32_t tail)
+ * -----------------------------------------------------------------------------
+ * Description:  Moves the writer's gate up to the head of the slowest active
+ *               reader, or to the tail when there are no readers. Returns the
+ *               free room this leaves.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t circ_buff_bcast_refresh(circ_buff_bcast_ptr bc, uint32_t tail)
+{
+    uint32_t index, lag=0;
+
+    circ_buff_bcast_lock(bc);
+    for(index=0; index<bc->max_readers; index++)
+    {
+         circ_buff_bcast_reader* reader=&bc->readers[index];
+         if(atomic_load_explicit(&reader->active, memory_order_relaxed)==0)
+              continue;
+         uint32_t behind=tail-atomic_load_explicit(&reader->head, memory_order_acquire);
+         if(behind>lag)
+              lag=behind;
+    }
+    circ_buff_bcast_unlock(bc);
+
+    bc->gate=tail-lag;
+    return bc->total_size-lag;
+}
+
+/*
+ * Function:     circ_buff_bcast_room(circ_buff_bcast_ptr bc, uint32_t tail, uint32_t count)
+ * -----------------------------------------------------------------------------
+ * Description:  How many of 'count' elements the writer may write now. Only 
+ *               walks the readers when the cached gate says there is not
+ *               enough room.
+ * ----------------------------------------------------------------------------
+ */
+static inline uint32_t circ_buff_bcast_room(circ_buff_bcast_ptr bc, uint32_t tail, uint32_t count)
+{
+    if(bc->mode&CIRC_BUFF_MODE_OVERWRITE)
+         return count;
+
+    uint32_t room=bc->total_size-(tail-bc->gate);
+    if(room<count)
+         room=circ_buff_bcast_refresh(bc, tail);
+    return room<count ? room : count;
+}
+
+/*
+ * Function:     circ_buff_bcast_fill(circ_buff_bcast_ptr bc, uint32_t tail,
+ *                                    const uint32_t* data, uint32_t count)
+ * -----------------------------------------------------------------------------
+ * Description:  Stores 'count' elements from 'tail' on and publishes them. In
+ *               CIRC_BUFF_MODE_OVERWRITE the claim is announced first, and 
+ *               the release fence keeps it ahead of the slot stores.
+ * ----------------------------------------------------------------------------
+ */
+static inline void circ_buff_bcast_fill(circ_buff_bcast_ptr bc, uint32_t tail, const uint32_t* data, uint32_t count)
+{
+    uint32_t index;
+
+    if(bc->mode&CIRC_BUFF_MODE_OVERWRITE)
+    {
+         atomic_store_explicit(&bc->claim, tail+count, memory_order_relaxed);
+         atomic_thread_fence(memory_order_release);
+    }
+    for(index=0; index<count; index++)
+         atomic_store_explicit(&bc->base[(tail+index)&bc->mask], data[index], memory_order_relaxed);
+    atomic_store_explicit(&bc->tail, tail+count, memory_order_release);
+}
+
+/*
+ * Function:     circ_buff_bcast_take(circ_buff_bcast_ptr bc, circ_buff_bcast_reader* reader,
+ *                                    uint32_t* data, uint32_t count)
+ * -----------------------------------------------------------------------------
+ * Description:  Copies up to 'count' of the reader's next elements and moves
+ *               its head past them. Returns how many were copied.
+ *
+ *               In the gated mode the writer can not touch slots at or after
+ *               the reader's head, so the copy is final. In 
+ *               CIRC_BUFF_MODE_OVERWRITE the reader first skips anything the
+ *               tail says is already overwritten, copies, and then checks 
+ *               claim: copies of positions that the writer has since started
+ *               refilling are thrown away and counted as dropped.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t circ_buff_bcast_take(circ_buff_bcast_ptr bc, circ_buff_bcast_reader* reader,
+                                     uint32_t* data, uint32_t count)
+{
+    uint32_t head=atomic_load_explicit(&reader->head, memory_order_relaxed);
+    uint32_t index, available;
+
+    if(!(bc->mode&CIRC_BUFF_MODE_OVERWRITE))
+    {
+         available=reader->tail_cache-head;
+         if(available<count)
+         {
+              reader->tail_cache=atomic_load_explicit(&bc->tail, memory_order_acquire);
+              available=reader->tail_cache-head;
+         }
+         if(available<count)
+              count=available;
+         for(index=0; index<count; index++)
+              data[index]=atomic_load_explicit(&bc->base[(head+index)&bc->mask], memory_order_relaxed);
+         atomic_store_explicit(&reader->head, head+count, memory_order_release);
+         return count;
+    }
+
+    for(;;)
+    {
+         uint32_t tail=atomic_load_explicit(&bc->tail, memory_order_acquire);
+         int32_t pending=(int32_t)(tail-head);
+         if(pending<=0)
+         {
+              count=0;
+              break;
+         }
+
+         /*lapped: everything before tail-total_size is gone*/
+         if((uint32_t)pending>bc->total_size)
+         {
+              reader->dropped+=(uint32_t)pending-bc->total_size;
+              head=tail-bc->total_size;
+              pending=(int32_t)bc->total_size;
+         }
+         if((uint32_t)pending<count)
+              count=(uint32_t)pending;
+
+         for(index=0; index<count; index++)
+              data[index]=atomic_load_explicit(&bc->base[(head+index)&bc->mask], memory_order_relaxed);
+         atomic_thread_fence(memory_order_acquire);
+
+         /*slots before claim-total_size may have been refilled during the copy*/
+         uint32_t oldest=atomic_load_explicit(&bc->claim, memory_order_relaxed)-bc->total_size;
+         int32_t stale=(int32_t)(oldest-head);
+         if(stale<=0)
+              break;
+         reader->dropped+=(uint32_t)stale;
+         if((uint32_t)stale<count)
+         {
+              count-=(uint32_t)stale;
+              memmove(data, data+stale, sizeof(uint32_t)*count);
+              head=oldest;
+              break;
+         }
+         head=oldest;
+    }
+
+    atomic_store_explicit(&reader->head, head+count, memory_order_release);
+    return count;
+}
+
+
+/*
+ * Function:     circ_buff_bcast_init(circ_buff_bcast_ptr* bcast_pointer, int32_t size,
+ *                                    uint32_t max_readers, uint32_t mode)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates the buffer, the storage and the reader cursors.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_init(circ_buff_bcast_ptr* bcast_pointer, int32_t size, uint32_t max_readers, uint32_t mode)
+{
+    /*basic pointer and size check*/
+    if(bcast_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(size<=0||(uint32_t)size>CIRC_BUFF_BCAST_MAX_SIZE)
+         return CIRC_BUFF_BAD_DATA;
+    if(max_readers==0||max_readers>CIRC_BUFF_BCAST_MAX_READERS)
+         return CIRC_BUFF_BAD_DATA;
+
+    /*round the capacity up to a power of two*/
+    uint32_t capacity=1;
+    while(capacity<(uint32_t)size)
+         capacity<<=1;
+
+    circ_buff_bcast_ptr bc=NULL;
+    if(posix_memalign((void**)&bc, CIRC_BUFF_CACHE_LINE, sizeof(circ_buff_bcast))!=0)
+         return CIRC_BUFF_MALLOC_FAIL;
+
+    bc->base=(_Atomic uint32_t*)calloc(capacity, sizeof(uint32_t));
+    if(bc->base==NULL)
+    {
+         free(bc);
+         return CIRC_BUFF_MALLOC_FAIL;
+    }
+    if(posix_memalign((void**)&bc->readers, CIRC_BUFF_CACHE_LINE, sizeof(circ_buff_bcast_reader)*max_readers)!=0)
+    {
+         free((void*)bc->base);
+         free(bc);
+         return CIRC_BUFF_MALLOC_FAIL;
+    }
+    memset(bc->readers, 0, sizeof(circ_buff_bcast_reader)*max_readers);
+
+    bc->total_size=capacity;
+    bc->mask=capacity-1;
+    bc->mode=mode&CIRC_BUFF_MODE_OVERWRITE;
+    bc->max_readers=max_readers;
+    atomic_flag_clear(&bc->lock);
+    atomic_init(&bc->tail, 0);
+    atomic_init(&bc->claim, 0);
+    bc->gate=0;
+
+    *bcast_pointer=bc;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_bcast_destroy(circ_buff_bcast_ptr bcast_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  De-allocates the storage, the cursors and the structure.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_destroy(circ_buff_bcast_ptr bcast_pointer)
+{
+    /*basic pointer check*/
+    if(bcast_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    free((void*)bcast_pointer->base);
+    free(bcast_pointer->readers);
+    free(bcast_pointer);
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_bcast_register(circ_buff_bcast_ptr bcast_pointer, uint32_t* reader)
+ * -----------------------------------------------------------------------------
+ * Description:  Takes the first free cursor and starts it at the tail. Done
+ *               under the lock so that the writer's next walk sees it.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_FULL or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_register(circ_buff_bcast_ptr bcast_pointer, uint32_t* reader)
+{
+    /*basic pointer check*/
+    if(bcast_pointer==NULL||reader==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    uint32_t index;
+    circ_buff_code status=CIRC_BUFF_FULL;
+
+    circ_buff_bcast_lock(bcast_pointer);
+    for(index=0; index<bcast_pointer->max_readers; index++)
+    {
+         circ_buff_bcast_reader* cursor=&bcast_pointer->readers[index];
+         if(atomic_load_explicit(&cursor->active, memory_order_relaxed)!=0)
+              continue;
+
+         uint32_t tail=atomic_load_explicit(&bcast_pointer->tail, memory_order_acquire);
+         atomic_store_explicit(&cursor->head, tail, memory_order_relaxed);
+         cursor->tail_cache=tail;
+         cursor->dropped=0;
+         atomic_store_explicit(&cursor->active, 1, memory_order_relaxed);
+         *reader=index;
+         status=CIRC_BUFF_SUCCESS;
+         break;
+    }
+    circ_buff_bcast_unlock(bcast_pointer);
+
+    return status;
+}
+
+
+/*
+ * Function:     circ_buff_bcast_unregister(circ_buff_bcast_ptr bcast_pointer, uint32_t reader)
+ * -----------------------------------------------------------------------------
+ * Description:  Marks the cursor free under the lock.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_unregister(circ_buff_bcast_ptr bcast_pointer, uint32_t reader)
+{
+    /*basic pointer check*/
+    if(bcast_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(reader>=bcast_pointer->max_readers)
+         return CIRC_BUFF_BAD_DATA;
+
+    circ_buff_code status=CIRC_BUFF_BAD_DATA;
+    circ_buff_bcast_lock(bcast_pointer);
+    if(atomic_load_explicit(&bcast_pointer->readers[reader].active, memory_order_relaxed)!=0)
+    {
+         atomic_store_explicit(&bcast_pointer->readers[reader].active, 0, memory_order_relaxed);
+         status=CIRC_BUFF_SUCCESS;
+    }
+    circ_buff_bcast_unlock(bcast_pointer);
+
+    return status;
+}
+
+
+/*
+ * Function:     circ_buff_bcast_write(circ_buff_bcast_ptr bcast_pointer, uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Checks the gate, stores the element and advances the tail.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_FULL or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_write(circ_buff_bcast_ptr bcast_pointer, uint32_t data)
+{
+    /*basic pointer check*/
+    if(bcast_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    uint32_t tail=atomic_load_explicit(&bcast_pointer->tail, memory_order_relaxed);
+    if(circ_buff_bcast_room(bcast_pointer, tail, 1)==0)
+         return CIRC_BUFF_FULL;
+
+    circ_buff_bcast_fill(bcast_pointer, tail, &data, 1);
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_bcast_write_bulk(circ_buff_bcast_ptr bcast_pointer,
+ *                                          const uint32_t* data, uint32_t count,
+ *                                          uint32_t* written)
+ * -----------------------------------------------------------------------------
+ * Description:  Checks the gate once for the whole run, stores it and 
+ *               advances the tail once.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_FULL or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_write_bulk(circ_buff_bcast_ptr bcast_pointer, const uint32_t* data,
+                                          uint32_t count, uint32_t* written)
+{
+    /*basic pointer check*/
+    if(bcast_pointer==NULL||written==NULL||(data==NULL&&count>0))
+         return CIRC_BUFF_NULL_PTR;
+
+    uint32_t tail=atomic_load_explicit(&bcast_pointer->tail, memory_order_relaxed);
+    uint32_t room=circ_buff_bcast_room(bcast_pointer, tail, count);
+    if(room>0)
+         circ_buff_bcast_fill(bcast_pointer, tail, data, room);
+
+    *written=room;
+    return room==count ? CIRC_BUFF_SUCCESS : CIRC_BUFF_FULL;
+}
+
+
+/*
+ * Function:     circ_buff_bcast_read(circ_buff_bcast_ptr bcast_pointer, uint32_t reader,
+ *                                    uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Takes one element for the reader.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_EMPTY or 
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_read(circ_buff_bcast_ptr bcast_pointer, uint32_t reader, uint32_t* data)
+{
+    /*basic pointer check*/
+    if(bcast_pointer==NULL||data==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(reader>=bcast_pointer->max_readers)
+         return CIRC_BUFF_BAD_DATA;
+
+    if(circ_buff_bcast_take(bcast_pointer, &bcast_pointer->readers[reader], data, 1)==0)
+         return CIRC_BUFF_EMPTY;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_bcast_read_bulk(circ_buff_bcast_ptr bcast_pointer, uint32_t reader,
+ *                                         uint32_t* data, uint32_t count, uint32_t* read)
+ * -----------------------------------------------------------------------------
+ * Description:  Takes up to 'count' elements for the reader.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_EMPTY or 
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_read_bulk(circ_buff_bcast_ptr bcast_pointer, uint32_t reader, uint32_t* data,
+                                         uint32_t count, uint32_t* read)
+{
+    /*basic pointer check*/
+    if(bcast_pointer==NULL||read==NULL||(data==NULL&&count>0))
+         return CIRC_BUFF_NULL_PTR;
+    if(reader>=bcast_pointer->max_readers)
+         return CIRC_BUFF_BAD_DATA;
+
+    *read=circ_buff_bcast_take(bcast_pointer, &bcast_pointer->readers[reader], data, count);
+    return *read==0 ? CIRC_BUFF_EMPTY : CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_bcast_dropped(circ_buff_bcast_ptr bcast_pointer, uint32_t reader,
+ *                                       uint64_t* dropped)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the reader's lapped count.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_dropped(circ_buff_bcast_ptr bcast_pointer, uint32_t reader, uint64_t* dropped)
+{
+    /*basic pointer check*/
+    if(bcast_pointer==NULL||dropped==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(reader>=bcast_pointer->max_readers)
+         return CIRC_BUFF_BAD_DATA;
+
+    *dropped=bcast_pointer->readers[reader].dropped;
+    return CIRC_BUFF_SUCCESS;
+}
@@ -0,0 +1,249 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_bcast.h
+ *
+ * Description:  Declares a broadcast variant of the circular buffer defined in
+ *               circ_buff.h: one writer thread and any number of reader 
+ *               threads that each see every element. There is one storage
+ *               array and one write cursor; each reader registers its own
+ *               read cursor. Memory use and write bandwidth do not depend on
+ *               how many readers there are.
+ *
+ *               By default the writer is gated by the slowest registered 
+ *               reader and gets CIRC_BUFF_FULL when it would overwrite an
+ *               element that reader has not read. With CIRC_BUFF_MODE_OVERWRITE
+ *               the writer never waits; a reader that falls a whole lap
+ *               behind skips to the oldest element still held and counts what
+ *               it missed.
+ *
+ * Usage:        circ_buff_bcast_init(&bc, 4096, 8, CIRC_BUFF_MODE_DEFAULT);
+ *               circ_buff_bcast_register(bc, &reader);      //in each reader
+ *               circ_buff_bcast_write(bc, sample);          //in the writer
+ *               circ_buff_bcast_read(bc, reader, &sample);  //in each reader
+ *
+ * */
+
+#ifndef _CIRC_BUFF_BCAST_H
+#define _CIRC_BUFF_BCAST_H
+#include<stdint.h>
+#include<stdatomic.h>
+#include "circ_buff.h"
+
+/*largest capacity; positions are compared as 32 bit differences*/
+#define CIRC_BUFF_BCAST_MAX_SIZE (1u<<30)
+
+/*largest number of reader cursors one buffer can have*/
+#define CIRC_BUFF_BCAST_MAX_READERS 1024
+
+
+/*
+ * Structure:    circ_buff_bcast_reader
+ * -----------------------------------------------------------------------------
+ * Description:  The cursor of one reader, on its own cache line. 'head' is 
+ *               the next position the reader will read; the writer reads it
+ *               when it refreshes its gate. 'tail_cache' is the reader's 
+ *               private copy of the write cursor. 'dropped' counts elements 
+ *               the reader was lapped on in CIRC_BUFF_MODE_OVERWRITE.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_bcast_reader
+{
+    _Alignas(CIRC_BUFF_CACHE_LINE) _Atomic uint32_t head;
+    _Atomic uint32_t active;
+    uint32_t  tail_cache;
+    uint64_t  dropped;
+}circ_buff_bcast_reader;
+
+
+/*
+ * Structure:    circ_buff_bcast
+ * -----------------------------------------------------------------------------
+ * Description:  'tail' is the next position the writer fills. In the gated 
+ *               mode the writer keeps 'gate', the lowest reader head it last
+ *               saw, and only walks the reader cursors again when tail 
+ *               reaches gate+total_size. A new reader starts at the tail, 
+ *               which is never behind the gate, so it is safe until the next
+ *               walk; the walk and registration are serialised by 'lock' so
+ *               the walk never misses a reader.
+ *
+ *               In CIRC_BUFF_MODE_OVERWRITE the writer first announces the
+ *               position it is about to fill in 'claim', then fills the slot,
+ *               then advances tail. A reader re-checks claim after copying an
+ *               element, seqlock style, and throws the copy away if the slot
+ *               was being refilled under it.
+ *
+ *               The capacity is rounded up to a power of two so that a 
+ *               position maps to its slot with a mask. Slots are atomics only
+ *               so that a lapped read is a race the language allows; the 
+ *               loads and stores are relaxed and compile to plain moves.
+ *
+ * Usage:        Do not access the members directly; use the functions below.
+ * ----------------------------------------------------------------------------
+ */
+
+/*typedef a circ_buff_bcast ptr type so that "*" does not have to be used always*/
+typedef struct circ_buff_bcast *circ_buff_bcast_ptr;
+
+typedef struct circ_buff_bcast
+{
+    /*read-only after init*/
+    _Atomic uint32_t *base;
+    circ_buff_bcast_reader *readers;
+    uint32_t  total_size;
+    uint32_t  mask;
+    uint32_t  mode;
+    uint32_t  max_readers;
+
+    /*taken to register a reader and by the writer to walk the readers*/
+    atomic_flag lock;
+
+    /*the writer's line*/
+    _Alignas(CIRC_BUFF_CACHE_LINE) _Atomic uint32_t tail;
+    _Atomic uint32_t claim;
+    uint32_t  gate;
+}circ_buff_bcast;
+
+
+/*
+ * Function:     circ_buff_bcast_init(circ_buff_bcast_ptr* bcast_pointer, int32_t size,
+ *                                    uint32_t max_readers, uint32_t mode)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates a broadcast buffer holding at least 'size' uint32_t
+ *               elements, rounded up to a power of two, with room for 
+ *               'max_readers' reader cursors. The only mode flag used is 
+ *               CIRC_BUFF_MODE_OVERWRITE.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: The size is less than or equal to zero or
+ *               larger than CIRC_BUFF_BCAST_MAX_SIZE, or max_readers is zero 
+ *               or larger than CIRC_BUFF_BCAST_MAX_READERS.
+ *
+ *               CIRC_BUFF_MALLOC_FAIL: An allocation fails. Nothing is leaked.
+ *
+ *               CIRC_BUFF_SUCCESS: The funcion returns successfully.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_init(circ_buff_bcast_ptr* bcast_pointer, int32_t size, uint32_t max_readers, uint32_t mode);
+
+/*
+ * Function:     circ_buff_bcast_destroy(circ_buff_bcast_ptr bcast_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  De-allocates the storage, the cursors and the structure. No
+ *               thread may use the buffer during or after this call.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_destroy(circ_buff_bcast_ptr bcast_pointer);
+
+/*
+ * Function:     circ_buff_bcast_register(circ_buff_bcast_ptr bcast_pointer, uint32_t* reader)
+ * -----------------------------------------------------------------------------
+ * Description:  Claims a free reader cursor and returns its number in *reader.
+ *               The reader sees every element written from now on. Safe to 
+ *               call while the writer and other readers are running.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: A pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_FULL: All max_readers cursors are in use.
+ *
+ *               CIRC_BUFF_SUCCESS: *reader is the new reader's number.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_register(circ_buff_bcast_ptr bcast_pointer, uint32_t* reader);
+
+/*
+ * Function:     circ_buff_bcast_unregister(circ_buff_bcast_ptr bcast_pointer, uint32_t reader)
+ * -----------------------------------------------------------------------------
+ * Description:  Frees a reader cursor. The writer stops waiting for it.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA (not a registered 
+ *               reader) or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_unregister(circ_buff_bcast_ptr bcast_pointer, uint32_t reader);
+
+/*
+ * Function:     circ_buff_bcast_write(circ_buff_bcast_ptr bcast_pointer, uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes data for every registered reader. Only one thread may
+ *               write.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_FULL: The slowest reader is a whole buffer behind; 
+ *               nothing is written. Never returned in 
+ *               CIRC_BUFF_MODE_OVERWRITE.
+ *
+ *               CIRC_BUFF_SUCCESS: The data is written.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_write(circ_buff_bcast_ptr bcast_pointer, uint32_t data);
+
+/*
+ * Function:     circ_buff_bcast_write_bulk(circ_buff_bcast_ptr bcast_pointer,
+ *                                          const uint32_t* data, uint32_t count,
+ *                                          uint32_t* written)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes as many of the 'count' elements as there is room for
+ *               and publishes them to the readers at once.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_FULL (fewer than count written)
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_write_bulk(circ_buff_bcast_ptr bcast_pointer, const uint32_t* data,
+                                          uint32_t count, uint32_t* written);
+
+/*
+ * Function:     circ_buff_bcast_read(circ_buff_bcast_ptr bcast_pointer, uint32_t reader,
+ *                                    uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Reads the reader's next element. Each reader number must be
+ *               used by one thread at a time.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: A pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: reader is out of range.
+ *
+ *               CIRC_BUFF_EMPTY: The reader has seen every element written.
+ *
+ *               CIRC_BUFF_SUCCESS: The data is read.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_read(circ_buff_bcast_ptr bcast_pointer, uint32_t reader, uint32_t* data);
+
+/*
+ * Function:     circ_buff_bcast_read_bulk(circ_buff_bcast_ptr bcast_pointer, uint32_t reader,
+ *                                         uint32_t* data, uint32_t count, uint32_t* read)
+ * -----------------------------------------------------------------------------
+ * Description:  Reads up to 'count' of the reader's next elements and returns
+ *               how many in *read.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_EMPTY or 
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_read_bulk(circ_buff_bcast_ptr bcast_pointer, uint32_t reader, uint32_t* data,
+                                         uint32_t count, uint32_t* read);
+
+/*
+ * Function:     circ_buff_bcast_dropped(circ_buff_bcast_ptr bcast_pointer, uint32_t reader,
+ *                                       uint64_t* dropped)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns how many elements the reader has missed because the
+ *               writer lapped it (CIRC_BUFF_MODE_OVERWRITE only). Call it from
+ *               the reader's own thread.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_bcast_dropped(circ_buff_bcast_ptr bcast_pointer, uint32_t reader, uint64_t* dropped);
+
+#endif
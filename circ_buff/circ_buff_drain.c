@@ -0,0 +1,462 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_drain.c
+ *
+ * Description:  Contains the background drain. The io_uring part uses the raw
+ *               syscalls and the structures of linux/io_uring.h, so there is
+ *               no library to link; any failure to set it up, or to submit
+ *               to it, falls back to pwritev.
+ *
+ * */
+
+
+#include "circ_buff_drain.h"
+#include<stdint.h>
+#include<stdlib.h>
+#include<stdatomic.h>
+#include<string.h>
+#include<errno.h>
+#include<time.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/syscall.h>
+#include<sys/uio.h>
+#include<linux/io_uring.h>
+
+/*submission queue entries asked for; two batches are ever in flight*/
+#define CIRC_BUFF_DRAIN_QUEUE 4
+
+/*how long an idle worker sleeps before it looks at 'stop' again*/
+#define CIRC_BUFF_DRAIN_IDLE_MS 10
+
+
+static uint64_t circ_buff_drain_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec*1000000000u+(uint64_t)now.tv_nsec;
+}
+
+/*
+ * Function:     circ_buff_drain_uring_setup(circ_buff_drain_uring* uring)
+ * -----------------------------------------------------------------------------
+ * Description:  Creates an io_uring and maps its submission ring, completion
+ *               ring and entry array. Kernels without io_uring, or with it
+ *               blocked (ENOSYS, EPERM), make this fail cleanly.
+ *
+ * Returns:      0, or -1 with nothing left mapped or open.
+ * ----------------------------------------------------------------------------
+ */
+static int circ_buff_drain_uring_setup(circ_buff_drain_uring* uring)
+{
+    struct io_uring_params params;
+
+    memset(&params, 0, sizeof(params));
+    memset(uring, 0, sizeof(circ_buff_drain_uring));
+    uring->fd=(int)syscall(__NR_io_uring_setup, CIRC_BUFF_DRAIN_QUEUE, &params);
+    if(uring->fd<0)
+         return -1;
+
+    uring->sq_bytes=params.sq_off.array+params.sq_entries*sizeof(uint32_t);
+    uring->cq_bytes=params.cq_off.cqes+params.cq_entries*sizeof(struct io_uring_cqe);
+    uring->sqes_bytes=params.sq_entries*sizeof(struct io_uring_sqe);
+    uring->sq_map=mmap(NULL, uring->sq_bytes, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, uring->fd, IORING_OFF_SQ_RING);
+    uring->cq_map=mmap(NULL, uring->cq_bytes, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, uring->fd, IORING_OFF_CQ_RING);
+    uring->sqes=mmap(NULL, uring->sqes_bytes, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, uring->fd, IORING_OFF_SQES);
+    if(uring->sq_map==MAP_FAILED||uring->cq_map==MAP_FAILED||uring->sqes==MAP_FAILED)
+    {
+         if(uring->sq_map!=MAP_FAILED)
+              munmap(uring->sq_map, uring->sq_bytes);
+         if(uring->cq_map!=MAP_FAILED)
+              munmap(uring->cq_map, uring->cq_bytes);
+         if(uring->sqes!=MAP_FAILED)
+              munmap(uring->sqes, uring->sqes_bytes);
+         close(uring->fd);
+         return -1;
+    }
+
+    uint8_t *sq=(uint8_t*)uring->sq_map, *cq=(uint8_t*)uring->cq_map;
+    uring->sq_head=(_Atomic uint32_t*)(sq+params.sq_off.head);
+    uring->sq_tail=(_Atomic uint32_t*)(sq+params.sq_off.tail);
+    uring->sq_mask=(uint32_t*)(sq+params.sq_off.ring_mask);
+    uring->sq_array=(uint32_t*)(sq+params.sq_off.array);
+    uring->cq_head=(_Atomic uint32_t*)(cq+params.cq_off.head);
+    uring->cq_tail=(_Atomic uint32_t*)(cq+params.cq_off.tail);
+    uring->cq_mask=(uint32_t*)(cq+params.cq_off.ring_mask);
+    uring->cqes=cq+params.cq_off.cqes;
+    return 0;
+}
+
+static void circ_buff_drain_uring_teardown(circ_buff_drain_uring* uring)
+{
+    munmap(uring->sqes, uring->sqes_bytes);
+    munmap(uring->cq_map, uring->cq_bytes);
+    munmap(uring->sq_map, uring->sq_bytes);
+    close(uring->fd);
+}
+
+/*
+ * Function:     circ_buff_drain_uring_enter(circ_buff_drain_uring* uring, uint32_t submit,
+ *                                           uint32_t wait)
+ * -----------------------------------------------------------------------------
+ * Description:  Submits 'submit' queued entries and, if 'wait', blocks until a
+ *               completion is posted. Retries EINTR.
+ *
+ * Returns:      The number submitted, or -1.
+ * ----------------------------------------------------------------------------
+ */
+static int circ_buff_drain_uring_enter(circ_buff_drain_uring* uring, uint32_t submit, uint32_t wait)
+{
+    for(;;)
+    {
+         int rc=(int)syscall(__NR_io_uring_enter, uring->fd, submit, wait, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+         if(rc>=0||errno!=EINTR)
+              return rc;
+    }
+}
+
+/*
+ * Function:     circ_buff_drain_uring_submit(circ_buff_drain_uring* uring, int fd,
+ *                                            struct iovec* iov, uint64_t offset,
+ *                                            uint64_t user_data)
+ * -----------------------------------------------------------------------------
+ * Description:  Queues one IORING_OP_WRITEV and submits it. If the kernel does
+ *               not take it, the entry is taken back off the queue so that a
+ *               later submit can not write it a second time.
+ *
+ * Returns:      0, or -1 if the write was not submitted.
+ * ----------------------------------------------------------------------------
+ */
+static int circ_buff_drain_uring_submit(circ_buff_drain_uring* uring, int fd, struct iovec* iov, uint64_t offset, uint64_t user_data)
+{
+    uint32_t tail=atomic_load_explicit(uring->sq_tail, memory_order_relaxed);
+    uint32_t index=tail&*uring->sq_mask;
+    struct io_uring_sqe* sqe=&((struct io_uring_sqe*)uring->sqes)[index];
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode=IORING_OP_WRITEV;
+    sqe->fd=fd;
+    sqe->addr=(uint64_t)(uintptr_t)iov;
+    sqe->len=1;
+    sqe->off=offset;
+    sqe->user_data=user_data;
+    uring->sq_array[index]=index;
+
+    /*release: the entry is filled in before the kernel sees the new tail*/
+    atomic_store_explicit(uring->sq_tail, tail+1, memory_order_release);
+    if(circ_buff_drain_uring_enter(uring, 1, 0)==1)
+         return 0;
+
+    atomic_store_explicit(uring->sq_tail, tail, memory_order_release);
+    return -1;
+}
+
+/*
+ * Function:     circ_buff_drain_pwrite(int fd, struct iovec iov, uint64_t offset)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes the whole iovec at 'offset', retrying short writes and
+ *               EINTR.
+ *
+ * Returns:      0, or the errno of the failed write.
+ * ----------------------------------------------------------------------------
+ */
+static int circ_buff_drain_pwrite(int fd, struct iovec iov, uint64_t offset)
+{
+    while(iov.iov_len>0)
+    {
+         ssize_t written=pwritev(fd, &iov, 1, (off_t)offset);
+         if(written<0)
+         {
+              if(errno==EINTR)
+                   continue;
+              return errno;
+         }
+         iov.iov_base=(uint8_t*)iov.iov_base+written;
+         iov.iov_len-=written;
+         offset+=written;
+    }
+    return 0;
+}
+
+/*
+ * Function:     circ_buff_drain_done(circ_buff_drain_ptr drain, circ_buff_drain_batch* batch,
+ *                                    int64_t result)
+ * -----------------------------------------------------------------------------
+ * Description:  Finishes a batch whose write returned 'result' bytes or a
+ *               negative errno. Whatever the kernel did not write is written
+ *               with pwritev; a batch that still fails is counted as lost.
+ *               The batch is then empty and free to fill.
+ * ----------------------------------------------------------------------------
+ */
+static void circ_buff_drain_done(circ_buff_drain_ptr drain, circ_buff_drain_batch* batch, int64_t result)
+{
+    struct iovec rest=batch->iov;
+    int error=0;
+
+    if(result<0)
+         result=0;
+    if((uint64_t)result<rest.iov_len)
+    {
+         rest.iov_base=(uint8_t*)rest.iov_base+result;
+         rest.iov_len-=result;
+         error=circ_buff_drain_pwrite(drain->fd, rest, batch->offset+result);
+    }
+
+    if(error!=0)
+    {
+         int none=0;
+         atomic_compare_exchange_strong(&drain->error, &none, error);
+         atomic_fetch_add_explicit(&drain->lost, batch->count, memory_order_relaxed);
+    }
+    else
+         atomic_fetch_add_explicit(&drain->elements, batch->count, memory_order_relaxed);
+    atomic_fetch_add_explicit(&drain->flushes, 1, memory_order_relaxed);
+
+    batch->count=0;
+    batch->in_flight=0;
+}
+
+/*
+ * Function:     circ_buff_drain_reap(circ_buff_drain_ptr drain, int wait)
+ * -----------------------------------------------------------------------------
+ * Description:  Finishes every batch whose completion has been posted, after
+ *               first waiting for one if 'wait'.
+ * ----------------------------------------------------------------------------
+ */
+static void circ_buff_drain_reap(circ_buff_drain_ptr drain, int wait)
+{
+    circ_buff_drain_uring* uring=&drain->uring;
+
+    if(wait)
+         circ_buff_drain_uring_enter(uring, 0, 1);
+
+    uint32_t head=atomic_load_explicit(uring->cq_head, memory_order_relaxed);
+    uint32_t tail=atomic_load_explicit(uring->cq_tail, memory_order_acquire);
+    for(; head!=tail; head++)
+    {
+         struct io_uring_cqe* cqe=&((struct io_uring_cqe*)uring->cqes)[head&*uring->cq_mask];
+         circ_buff_drain_done(drain, &drain->batches[cqe->user_data], cqe->res);
+    }
+    atomic_store_explicit(uring->cq_head, head, memory_order_release);
+}
+
+/*
+ * Function:     circ_buff_drain_flush(circ_buff_drain_ptr drain, circ_buff_drain_batch* batch)
+ * -----------------------------------------------------------------------------
+ * Description:  Gives the batch the next stretch of the file and submits it,
+ *               or writes it on the spot without io_uring.
+ * ----------------------------------------------------------------------------
+ */
+static void circ_buff_drain_flush(circ_buff_drain_ptr drain, circ_buff_drain_batch* batch)
+{
+    batch->iov.iov_base=batch->data;
+    batch->iov.iov_len=sizeof(uint32_t)*(size_t)batch->count;
+    batch->offset=drain->offset;
+    drain->offset+=batch->iov.iov_len;
+
+    if(drain->use_uring&&circ_buff_drain_uring_submit(&drain->uring, drain->fd, &batch->iov, batch->offset,
+                                                      (uint64_t)(batch-drain->batches))==0)
+    {
+         batch->in_flight=1;
+         return;
+    }
+    circ_buff_drain_done(drain, batch, 0);
+}
+
+/*
+ * Function:     circ_buff_drain_worker(void* arg)
+ * -----------------------------------------------------------------------------
+ * Description:  Fills the active batch from the ring and flushes it when it
+ *               is full, when its oldest element has waited flush_latency_us
+ *               or, once stopping, when the ring is empty. It then switches to
+ *               the other batch, waiting for its write first if it is still
+ *               in flight; that wait is what the producer sees as 'behind'.
+ *               With nothing to pull it sleeps in circ_buff_spsc_read_wait
+ *               until data comes or the active batch falls due.
+ * ----------------------------------------------------------------------------
+ */
+static void* circ_buff_drain_worker(void* arg)
+{
+    circ_buff_drain_ptr drain=(circ_buff_drain_ptr)arg;
+    uint64_t latency=(uint64_t)drain->config.flush_latency_us*1000u;
+    uint32_t active=0, got, size;
+
+    for(;;)
+    {
+         circ_buff_drain_batch* batch=&drain->batches[active];
+         int stopping=atomic_load_explicit(&drain->stop, memory_order_acquire);
+
+         circ_buff_spsc_read_n(drain->ring, batch->data+batch->count, drain->batch_size-batch->count, &got);
+         uint64_t now=circ_buff_drain_now();
+         if(got>0&&batch->count==0)
+              batch->first=now;
+         batch->count+=got;
+         if(drain->config.behind_mark>0)
+         {
+              circ_buff_spsc_size(drain->ring, &size);
+              atomic_store_explicit(&drain->behind, size>=drain->config.behind_mark, memory_order_relaxed);
+         }
+         if(drain->use_uring)
+              circ_buff_drain_reap(drain, 0);
+
+         if(batch->count==drain->batch_size||(batch->count>0&&(now-batch->first>=latency||(stopping&&got==0))))
+         {
+              circ_buff_drain_flush(drain, batch);
+              active^=1;
+              if(drain->batches[active].in_flight)
+              {
+                   atomic_fetch_add_explicit(&drain->stalls, 1, memory_order_relaxed);
+                   atomic_store_explicit(&drain->behind, 1, memory_order_relaxed);
+                   while(drain->batches[active].in_flight)
+                        circ_buff_drain_reap(drain, 1);
+                   atomic_store_explicit(&drain->behind, 0, memory_order_relaxed);
+              }
+              continue;
+         }
+
+         if(got==0)
+         {
+              if(stopping)
+                   break;
+
+              /*sleep until data comes or the batch is due*/
+              int32_t timeout=CIRC_BUFF_DRAIN_IDLE_MS;
+              if(batch->count>0)
+                   timeout=(int32_t)((latency-(now-batch->first)+999999)/1000000);
+              uint32_t data;
+              if(circ_buff_spsc_read_wait(drain->ring, &data, timeout)==CIRC_BUFF_SUCCESS)
+              {
+                   if(batch->count==0)
+                        batch->first=circ_buff_drain_now();
+                   batch->data[batch->count++]=data;
+              }
+         }
+    }
+
+    /*the active batch is empty; wait for the other one*/
+    while(drain->batches[active^1].in_flight)
+         circ_buff_drain_reap(drain, 1);
+    return NULL;
+}
+
+
+/*
+ * Function:     circ_buff_drain_start(circ_buff_drain_ptr* drain_pointer, circ_buff_spsc_ptr ring,
+ *                                     int fd, const circ_buff_drain_config* config)
+ * -----------------------------------------------------------------------------
+ * Description:  Fills in the configuration, allocates the two batches, tries
+ *               to set up io_uring and starts the worker.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_drain_start(circ_buff_drain_ptr* drain_pointer, circ_buff_spsc_ptr ring, int fd,
+                                     const circ_buff_drain_config* config)
+{
+    /*basic pointer and descriptor check*/
+    if(drain_pointer==NULL||ring==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    off_t offset=fd<0 ? -1 : lseek(fd, 0, SEEK_CUR);
+    if(offset<0)
+         return CIRC_BUFF_BAD_DATA;
+
+    circ_buff_drain_ptr drain=(circ_buff_drain_ptr)calloc(1, sizeof(circ_buff_drain));
+    if(drain==NULL)
+         return CIRC_BUFF_MALLOC_FAIL;
+
+    if(config!=NULL)
+         drain->config=*config;
+    if(drain->config.flush_bytes<sizeof(uint32_t))
+         drain->config.flush_bytes=CIRC_BUFF_DRAIN_FLUSH_BYTES;
+    if(drain->config.flush_latency_us==0)
+         drain->config.flush_latency_us=CIRC_BUFF_DRAIN_FLUSH_LATENCY;
+
+    drain->ring=ring;
+    drain->fd=fd;
+    drain->offset=(uint64_t)offset;
+    drain->batch_size=drain->config.flush_bytes/sizeof(uint32_t);
+    drain->batches[0].data=(uint32_t*)malloc(sizeof(uint32_t)*(size_t)drain->batch_size);
+    drain->batches[1].data=(uint32_t*)malloc(sizeof(uint32_t)*(size_t)drain->batch_size);
+    if(drain->batches[0].data==NULL||drain->batches[1].data==NULL)
+    {
+         free(drain->batches[0].data);
+         free(drain->batches[1].data);
+         free(drain);
+         return CIRC_BUFF_MALLOC_FAIL;
+    }
+
+    if(!(drain->config.flags&CIRC_BUFF_DRAIN_PWRITEV))
+         drain->use_uring=circ_buff_drain_uring_setup(&drain->uring)==0;
+
+    if(pthread_create(&drain->worker, NULL, circ_buff_drain_worker, drain)!=0)
+    {
+         if(drain->use_uring)
+              circ_buff_drain_uring_teardown(&drain->uring);
+         free(drain->batches[0].data);
+         free(drain->batches[1].data);
+         free(drain);
+         return CIRC_BUFF_MALLOC_FAIL;
+    }
+
+    *drain_pointer=drain;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_drain_stop(circ_buff_drain_ptr drain_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  Raises 'stop', joins the worker, leaves fd's offset after the
+ *               last element written and frees everything.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_WRITE_FAILED or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_drain_stop(circ_buff_drain_ptr drain_pointer)
+{
+    /*basic pointer check*/
+    if(drain_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    atomic_store_explicit(&drain_pointer->stop, 1, memory_order_release);
+    pthread_join(drain_pointer->worker, NULL);
+
+    lseek(drain_pointer->fd, (off_t)drain_pointer->offset, SEEK_SET);
+    if(drain_pointer->use_uring)
+         circ_buff_drain_uring_teardown(&drain_pointer->uring);
+    circ_buff_code rc=atomic_load(&drain_pointer->error) ? CIRC_BUFF_WRITE_FAILED : CIRC_BUFF_SUCCESS;
+
+    free(drain_pointer->batches[0].data);
+    free(drain_pointer->batches[1].data);
+    free(drain_pointer);
+    return rc;
+}
+
+
+/*
+ * Function:     circ_buff_drain_status_get(circ_buff_drain_ptr drain_pointer,
+ *                                          circ_buff_drain_status* status)
+ * -----------------------------------------------------------------------------
+ * Description:  Copies the counters; each is exact, but they are not read at
+ *               one instant.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_drain_status_get(circ_buff_drain_ptr drain_pointer, circ_buff_drain_status* status)
+{
+    /*basic pointer check*/
+    if(drain_pointer==NULL||status==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    status->elements=atomic_load_explicit(&drain_pointer->elements, memory_order_relaxed);
+    status->flushes=atomic_load_explicit(&drain_pointer->flushes, memory_order_relaxed);
+    status->stalls=atomic_load_explicit(&drain_pointer->stalls, memory_order_relaxed);
+    status->lost=atomic_load_explicit(&drain_pointer->lost, memory_order_relaxed);
+    status->behind=atomic_load_explicit(&drain_pointer->behind, memory_order_relaxed);
+    status->error=atomic_load_explicit(&drain_pointer->error, memory_order_relaxed);
+    status->uring=drain_pointer->use_uring;
+    return CIRC_BUFF_SUCCESS;
+}
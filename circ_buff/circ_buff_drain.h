@@ -0,0 +1,224 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_drain.h
+ *
+ * Description:  Declares a background drain: a worker thread that is the
+ *               consumer of an spsc buffer (circ_buff_spsc.h) and appends
+ *               everything written to it to a file, in the format of
+ *               circ_buff_dump_fd with CIRC_BUFF_DUMP_BINARY. The producer
+ *               only ever does an spsc write, so it never waits for the disk.
+ *
+ *               The worker pulls large batches into one of two buffers and
+ *               hands a full buffer to the kernel while it fills the other.
+ *               Writes go through io_uring when the kernel allows it and
+ *               through pwritev from the worker otherwise.
+ *
+ * Usage:        circ_buff_spsc_init(&ring, 1<<16);
+ *               circ_buff_drain_start(&drain, ring, fd, NULL);
+ *               circ_buff_spsc_write(ring, sample);       //producer, as usual
+ *               circ_buff_drain_stop(drain);               //drains and flushes
+ *
+ * */
+
+#ifndef _CIRC_BUFF_DRAIN_H
+#define _CIRC_BUFF_DRAIN_H
+#include<stdint.h>
+#include<stdatomic.h>
+#include<pthread.h>
+#include<sys/uio.h>
+#include "circ_buff.h"
+#include "circ_buff_spsc.h"
+
+/*defaults for a zero field of circ_buff_drain_config*/
+#define CIRC_BUFF_DRAIN_FLUSH_BYTES   (1u<<20)
+#define CIRC_BUFF_DRAIN_FLUSH_LATENCY 10000
+
+/*circ_buff_drain_config flags*/
+#define CIRC_BUFF_DRAIN_PWRITEV 1u
+
+
+/*
+ * Structure:    circ_buff_drain_config
+ * -----------------------------------------------------------------------------
+ * Description:  'flush_bytes' is the size of each of the two buffers; a buffer
+ *               is written as soon as it is full. 'flush_latency_us' bounds
+ *               how long an element waits in a buffer that does not fill.
+ *               'behind_mark' is the number of elements left in the ring
+ *               after a pull at which the drain reports that it is behind;
+ *               zero leaves only the waits on the disk to report it.
+ *               CIRC_BUFF_DRAIN_PWRITEV in 'flags' skips io_uring.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_drain_config
+{
+    uint32_t  flush_bytes;
+    uint32_t  flush_latency_us;
+    uint32_t  behind_mark;
+    uint32_t  flags;
+}circ_buff_drain_config;
+
+
+/*
+ * Structure:    circ_buff_drain_status
+ * -----------------------------------------------------------------------------
+ * Description:  A snapshot of the drain. 'behind' is the backpressure signal:
+ *               set while the worker is waiting for the disk before it can
+ *               pull more, or while the ring is over behind_mark. 'stalls'
+ *               counts the waits. 'error' is the errno of the first failed
+ *               write; the elements of a failed write are counted in 'lost'.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_drain_status
+{
+    uint64_t  elements;
+    uint64_t  flushes;
+    uint64_t  stalls;
+    uint64_t  lost;
+    int       behind;
+    int       uring;
+    int       error;
+}circ_buff_drain_status;
+
+
+/*
+ * Structure:    circ_buff_drain_batch
+ * -----------------------------------------------------------------------------
+ * Description:  One of the two buffers. 'iov' describes it to the kernel and
+ *               has to stay put while it is in flight. 'first' is when its
+ *               oldest element was pulled from the ring, 'offset' where in
+ *               the file it goes.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_drain_batch
+{
+    uint32_t *data;
+    uint32_t  count;
+    int       in_flight;
+    uint64_t  first;
+    uint64_t  offset;
+    struct iovec iov;
+}circ_buff_drain_batch;
+
+
+/*
+ * Structure:    circ_buff_drain_uring
+ * -----------------------------------------------------------------------------
+ * Description:  A submission/completion ring pair set up with the raw
+ *               io_uring syscalls. The pointers point into the kernel's
+ *               shared mappings.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_drain_uring
+{
+    int       fd;
+    void     *sq_map;
+    void     *cq_map;
+    void     *sqes;
+    size_t    sq_bytes;
+    size_t    cq_bytes;
+    size_t    sqes_bytes;
+    _Atomic uint32_t *sq_head;
+    _Atomic uint32_t *sq_tail;
+    uint32_t *sq_mask;
+    uint32_t *sq_array;
+    _Atomic uint32_t *cq_head;
+    _Atomic uint32_t *cq_tail;
+    uint32_t *cq_mask;
+    void     *cqes;
+}circ_buff_drain_uring;
+
+
+/*
+ * Structure:    circ_buff_drain
+ * -----------------------------------------------------------------------------
+ * Description:  Everything but 'stop' and the status counters belongs to the
+ *               worker thread once it is started. The counters are written
+ *               by the worker and read by circ_buff_drain_status_get.
+ *
+ * Usage:        Do not access the members directly; use the functions below.
+ * ----------------------------------------------------------------------------
+ */
+
+/*typedef a circ_buff_drain ptr type so that "*" does not have to be used always*/
+typedef struct circ_buff_drain *circ_buff_drain_ptr;
+
+typedef struct circ_buff_drain
+{
+    circ_buff_spsc_ptr ring;
+    int       fd;
+    uint64_t  offset;
+    circ_buff_drain_config config;
+    uint32_t  batch_size;
+    circ_buff_drain_batch batches[2];
+    circ_buff_drain_uring uring;
+    int       use_uring;
+    pthread_t worker;
+
+    _Atomic int stop;
+    _Atomic int behind;
+    _Atomic int error;
+    _Atomic uint64_t elements;
+    _Atomic uint64_t flushes;
+    _Atomic uint64_t stalls;
+    _Atomic uint64_t lost;
+}circ_buff_drain;
+
+
+/*
+ * Function:     circ_buff_drain_start(circ_buff_drain_ptr* drain_pointer, circ_buff_spsc_ptr ring,
+ *                                     int fd, const circ_buff_drain_config* config)
+ * -----------------------------------------------------------------------------
+ * Description:  Starts a worker thread that becomes the consumer of 'ring' and
+ *               appends to 'fd' from its current offset. No other thread may
+ *               read the ring until circ_buff_drain_stop. A NULL config, or a
+ *               zero field in it, takes the defaults above. flush_bytes is
+ *               rounded down to whole elements.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: A pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: fd is not a seekable file descriptor.
+ *
+ *               CIRC_BUFF_MALLOC_FAIL: An allocation or the thread creation
+ *               fails. Nothing is leaked.
+ *
+ *               CIRC_BUFF_SUCCESS: The worker is running.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_drain_start(circ_buff_drain_ptr* drain_pointer, circ_buff_spsc_ptr ring, int fd,
+                                     const circ_buff_drain_config* config);
+
+/*
+ * Function:     circ_buff_drain_stop(circ_buff_drain_ptr drain_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  Tells the worker to empty the ring, write everything out and
+ *               finish, waits for it and frees the drain. Neither the ring
+ *               nor fd is closed. The producer should stop writing first;
+ *               anything written after the worker found the ring empty stays
+ *               in the ring.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_WRITE_FAILED: A write failed while the drain ran.
+ *
+ *               CIRC_BUFF_SUCCESS: Everything pulled was written.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_drain_stop(circ_buff_drain_ptr drain_pointer);
+
+/*
+ * Function:     circ_buff_drain_status_get(circ_buff_drain_ptr drain_pointer,
+ *                                          circ_buff_drain_status* status)
+ * -----------------------------------------------------------------------------
+ * Description:  Fills in a snapshot of the drain. Safe to call from any thread
+ *               while the drain runs, for instance by a producer deciding to
+ *               shed load when status->behind is set.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_drain_status_get(circ_buff_drain_ptr drain_pointer, circ_buff_drain_status* status);
+
+#endif
@@ -0,0 +1,328 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_mpmc.c
+ *
+ * Description:  Contains a bounded multi-producer/multi-consumer circular
+ *               buffer that uses a sequence number per slot instead of a
+ *               lock. See circ_buff_mpmc.h for the slot states.
+ *
+ * */
+
+
+#include "circ_buff_mpmc.h"
+#include<stdint.h>
+#include<stdlib.h>
+#include<stdatomic.h>
+#include<string.h>
+#include<pthread.h>
+
+
+#ifdef CIRC_BUFF_STATS
+#if CIRC_BUFF_MPMC_STATS_THREADS>32
+#error "the block bitmap is a uint32_t"
+#endif
+#define CIRC_BUFF_MPMC_BLOCKS_ALL ((uint32_t)((1ull<<CIRC_BUFF_MPMC_STATS_THREADS)-1))
+
+/*bit n is set while a live thread owns counter block n of every mpmc buffer*/
+static _Atomic uint32_t circ_buff_mpmc_blocks_used;
+/*the calling thread's block number plus one, zero while it has none*/
+static _Thread_local uint32_t circ_buff_mpmc_block;
+/*counted into by a thread that finds every block taken; never merged*/
+static _Thread_local circ_buff_stats circ_buff_mpmc_uncounted;
+static pthread_key_t circ_buff_mpmc_block_key;
+static pthread_once_t circ_buff_mpmc_block_once=PTHREAD_ONCE_INIT;
+
+/*
+ * Function:     circ_buff_mpmc_block_release(void* block)
+ * -----------------------------------------------------------------------------
+ * Description:  Destructor of circ_buff_mpmc_block_key, run as a thread that
+ *               owns a block exits. Gives the block back. The release pairs
+ *               with the acquire of the next claim, so the exited thread's
+ *               last counts happen before the new owner's first.
+ * ----------------------------------------------------------------------------
+ */
+static void circ_buff_mpmc_block_release(void* block)
+{
+    uint32_t bit=(uint32_t)(uintptr_t)block-1;
+    atomic_fetch_and_explicit(&circ_buff_mpmc_blocks_used, ~(1u<<bit), memory_order_release);
+}
+
+static void circ_buff_mpmc_block_key_create(void)
+{
+    pthread_key_create(&circ_buff_mpmc_block_key, circ_buff_mpmc_block_release);
+}
+
+/*
+ * Function:     circ_buff_mpmc_block_claim(void)
+ * -----------------------------------------------------------------------------
+ * Description:  Claims the lowest free block for the calling thread with a
+ *               CAS on the bitmap and arranges for it to be given back when
+ *               the thread exits.
+ *
+ * Returns:      1 if the thread now owns a block, 0 if every block is taken.
+ * ----------------------------------------------------------------------------
+ */
+static int circ_buff_mpmc_block_claim(void)
+{
+    uint32_t used=atomic_load_explicit(&circ_buff_mpmc_blocks_used, memory_order_relaxed);
+
+    while(used!=CIRC_BUFF_MPMC_BLOCKS_ALL)
+    {
+         uint32_t bit=(uint32_t)__builtin_ctz(~used);
+         if(atomic_compare_exchange_weak_explicit(&circ_buff_mpmc_blocks_used, &used, used|(1u<<bit),
+                                                  memory_order_acquire, memory_order_relaxed))
+         {
+              pthread_once(&circ_buff_mpmc_block_once, circ_buff_mpmc_block_key_create);
+              pthread_setspecific(circ_buff_mpmc_block_key, (void*)(uintptr_t)(bit+1));
+              circ_buff_mpmc_block=bit+1;
+              return 1;
+         }
+    }
+    return 0;
+}
+
+/*
+ * Function:     circ_buff_mpmc_stats(circ_buff_mpmc_ptr mpmc)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the counter block of the calling thread, claiming one
+ *               on first use. A thread that finds every block taken counts
+ *               into a private block that is not reported, and tries again on
+ *               its next call.
+ * ----------------------------------------------------------------------------
+ */
+static inline circ_buff_stats* circ_buff_mpmc_stats(circ_buff_mpmc_ptr mpmc)
+{
+    if(circ_buff_mpmc_block==0&&!circ_buff_mpmc_block_claim())
+         return &circ_buff_mpmc_uncounted;
+    return &mpmc->thread_stats[circ_buff_mpmc_block-1].stats;
+}
+#endif
+
+
+/*
+ * Function:     circ_buff_mpmc_init(circ_buff_mpmc_ptr* mpmc_pointer, int32_t size)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates the buffer, rounds the capacity up to a power of two
+ *               and marks every slot free for lap zero.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_mpmc_init(circ_buff_mpmc_ptr* mpmc_pointer, int32_t size)
+{
+    /*basic pointer and size check*/
+    if(mpmc_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(size<=0||(uint32_t)size>CIRC_BUFF_MPMC_MAX_SIZE)
+         return CIRC_BUFF_BAD_DATA;
+
+    /*round the capacity up to a power of two*/
+    uint32_t capacity=1;
+    while(capacity<(uint32_t)size)
+         capacity<<=1;
+
+    circ_buff_mpmc_ptr mpmc=NULL;
+    if(posix_memalign((void**)&mpmc, CIRC_BUFF_CACHE_LINE, sizeof(circ_buff_mpmc))!=0)
+         return CIRC_BUFF_MALLOC_FAIL;
+
+    mpmc->slots=(circ_buff_mpmc_slot*)malloc(sizeof(circ_buff_mpmc_slot)*capacity);
+    if(mpmc->slots==NULL)
+    {
+         free(mpmc);
+         return CIRC_BUFF_MALLOC_FAIL;
+    }
+    mpmc->total_size=capacity;
+    mpmc->mask=capacity-1;
+
+#ifdef CIRC_BUFF_STATS
+    if(posix_memalign((void**)&mpmc->thread_stats, CIRC_BUFF_CACHE_LINE,
+                      sizeof(circ_buff_mpmc_thread_stats)*CIRC_BUFF_MPMC_STATS_THREADS)!=0)
+    {
+         free(mpmc->slots);
+         free(mpmc);
+         return CIRC_BUFF_MALLOC_FAIL;
+    }
+    memset(mpmc->thread_stats, 0, sizeof(circ_buff_mpmc_thread_stats)*CIRC_BUFF_MPMC_STATS_THREADS);
+#endif
+
+    /*slot i is free for the producer that claims position i*/
+    uint32_t index;
+    for(index=0; index<capacity; index++)
+         atomic_init(&mpmc->slots[index].sequence, index);
+
+    atomic_init(&mpmc->tail, 0);
+    atomic_init(&mpmc->head, 0);
+
+    *mpmc_pointer=mpmc;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_mpmc_destroy(circ_buff_mpmc_ptr mpmc_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  De-allocates the slots and the structure.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_mpmc_destroy(circ_buff_mpmc_ptr mpmc_pointer)
+{
+    /*basic pointer check*/
+    if(mpmc_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    free(mpmc_pointer->slots);
+    mpmc_pointer->slots=NULL;
+#ifdef CIRC_BUFF_STATS
+    free(mpmc_pointer->thread_stats);
+#endif
+    free(mpmc_pointer);
+
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_mpmc_write(circ_buff_mpmc_ptr mpmc_pointer, uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Looks at the slot for the current tail position. If its
+ *               sequence equals the position the slot is free and the producer
+ *               tries to claim it by advancing tail with one CAS. If the
+ *               sequence lags the position, the slot still holds data from the
+ *               previous lap and the buffer is full. If it leads, another
+ *               producer got there first and tail is re-read.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_FULL or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_mpmc_write(circ_buff_mpmc_ptr mpmc_pointer, uint32_t data)
+{
+    /*basic pointer check*/
+    if(mpmc_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    circ_buff_mpmc_slot *slot;
+    uint32_t pos=atomic_load_explicit(&mpmc_pointer->tail, memory_order_relaxed);
+
+    for(;;)
+    {
+         slot=&mpmc_pointer->slots[pos&mpmc_pointer->mask];
+         uint32_t sequence=atomic_load_explicit(&slot->sequence, memory_order_acquire);
+         int32_t diff=(int32_t)(sequence-pos);
+
+         if(diff==0)
+         {
+              /*on failure the CAS reloads pos for us*/
+              if(atomic_compare_exchange_weak_explicit(&mpmc_pointer->tail, &pos, pos+1,
+                                                       memory_order_relaxed, memory_order_relaxed))
+                   break;
+         }
+         else if(diff<0)
+         {
+              CIRC_BUFF_STAT(circ_buff_mpmc_stats(mpmc_pointer)->full++);
+              return CIRC_BUFF_FULL;
+         }
+         else
+              pos=atomic_load_explicit(&mpmc_pointer->tail, memory_order_relaxed);
+    }
+
+    /*the slot is ours; fill it and hand it to the consumers*/
+    slot->data=data;
+#ifdef CIRC_BUFF_STATS
+    circ_buff_stats* stats=circ_buff_mpmc_stats(mpmc_pointer);
+    slot->stamp=circ_buff_stats_now();
+    if((++stats->writes&(CIRC_BUFF_STATS_SAMPLE-1))==0)
+    {
+         /*head is the consumers' line; only look at it once in a while*/
+         int32_t occupied=(int32_t)(pos+1-atomic_load_explicit(&mpmc_pointer->head, memory_order_relaxed));
+         if(occupied>0)
+              circ_buff_stats_high_water(stats, (uint32_t)occupied);
+    }
+#endif
+    atomic_store_explicit(&slot->sequence, pos+1, memory_order_release);
+
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_mpmc_read(circ_buff_mpmc_ptr mpmc_pointer, uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  The mirror image of circ_buff_mpmc_write. A slot is readable
+ *               when its sequence is position+1. After reading, the sequence
+ *               is moved a full lap ahead so the slot is free for the producer
+ *               that claims position+total_size.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_mpmc_read(circ_buff_mpmc_ptr mpmc_pointer, uint32_t* data)
+{
+    /*basic pointer check*/
+    if(mpmc_pointer==NULL||data==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    circ_buff_mpmc_slot *slot;
+    uint32_t pos=atomic_load_explicit(&mpmc_pointer->head, memory_order_relaxed);
+
+    for(;;)
+    {
+         slot=&mpmc_pointer->slots[pos&mpmc_pointer->mask];
+         uint32_t sequence=atomic_load_explicit(&slot->sequence, memory_order_acquire);
+         int32_t diff=(int32_t)(sequence-(pos+1));
+
+         if(diff==0)
+         {
+              if(atomic_compare_exchange_weak_explicit(&mpmc_pointer->head, &pos, pos+1,
+                                                       memory_order_relaxed, memory_order_relaxed))
+                   break;
+         }
+         else if(diff<0)
+         {
+              CIRC_BUFF_STAT(circ_buff_mpmc_stats(mpmc_pointer)->empty++);
+              return CIRC_BUFF_EMPTY;
+         }
+         else
+              pos=atomic_load_explicit(&mpmc_pointer->head, memory_order_relaxed);
+    }
+
+    /*take the data and free the slot for the next lap*/
+    *data=slot->data;
+#ifdef CIRC_BUFF_STATS
+    circ_buff_stats* stats=circ_buff_mpmc_stats(mpmc_pointer);
+    circ_buff_stats_record(stats, circ_buff_stats_now()-slot->stamp);
+    stats->reads++;
+#endif
+    atomic_store_explicit(&slot->sequence, pos+mpmc_pointer->total_size, memory_order_release);
+
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+#ifdef CIRC_BUFF_STATS
+/*
+ * Function:     circ_buff_mpmc_stats_get(circ_buff_mpmc_ptr mpmc_pointer,
+ *                                        circ_buff_stats* stats)
+ * -----------------------------------------------------------------------------
+ * Description:  Sums the per-thread counters.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_mpmc_stats_get(circ_buff_mpmc_ptr mpmc_pointer, circ_buff_stats* stats)
+{
+    /*basic pointer check*/
+    if(mpmc_pointer==NULL||stats==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    uint32_t index;
+    memset(stats, 0, sizeof(circ_buff_stats));
+    for(index=0; index<CIRC_BUFF_MPMC_STATS_THREADS; index++)
+         circ_buff_stats_merge(stats, &mpmc_pointer->thread_stats[index].stats);
+
+    return CIRC_BUFF_SUCCESS;
+}
+#endif
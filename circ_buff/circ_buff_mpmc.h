@@ -0,0 +1,187 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_mpmc.h
+ *
+ * Description:  Declares a bounded multi-producer/multi-consumer(mpmc)
+ *               variant of the circular buffer defined in circ_buff.h. Any
+ *               number of threads may write and read concurrently; each
+ *               operation claims its slot with a single compare-and-swap.
+ *
+ * */
+
+#ifndef _CIRC_BUFF_MPMC_H
+#define _CIRC_BUFF_MPMC_H
+#include<stdint.h>
+#include<stdatomic.h>
+#include "circ_buff.h"
+
+/*largest capacity; positions are compared as signed 32 bit differences*/
+#define CIRC_BUFF_MPMC_MAX_SIZE (1u<<30)
+
+/*per-thread counter blocks kept by each buffer when built with CIRC_BUFF_STATS*/
+#define CIRC_BUFF_MPMC_STATS_THREADS 16
+
+
+/*
+ * Structure:    circ_buff_mpmc_slot
+ * -----------------------------------------------------------------------------
+ * Description:  One element of the mpmc buffer together with its sequence
+ *               number. For the slot at position 'pos' of lap 'n':
+ *               sequence==pos             - the slot is free for a producer,
+ *               sequence==pos+1           - the slot holds data for a consumer,
+ *               sequence==pos+total_size  - freed for the next lap.
+ *               'stamp' is the write time, with CIRC_BUFF_STATS only.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_mpmc_slot
+{
+    _Atomic uint32_t sequence;
+    uint32_t data;
+#ifdef CIRC_BUFF_STATS
+    uint64_t stamp;
+#endif
+}circ_buff_mpmc_slot;
+
+
+/*
+ * Structure:    circ_buff_mpmc_thread_stats
+ * -----------------------------------------------------------------------------
+ * Description:  The counters of one thread, padded to whole cache lines so 
+ *               that no two threads write the same line.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_mpmc_thread_stats
+{
+    _Alignas(CIRC_BUFF_CACHE_LINE) circ_buff_stats stats;
+}circ_buff_mpmc_thread_stats;
+
+
+/*
+ * Structure:    circ_buff_mpmc
+ * -----------------------------------------------------------------------------
+ * Description:  A bounded mpmc circular buffer. Producers claim positions by
+ *               advancing 'tail' with a CAS, consumers by advancing 'head'.
+ *               The slot's sequence number then tells the claimer whether the
+ *               other side has finished with it, so no lock is ever taken.
+ *               head and tail sit on separate cache lines.
+ *
+ *               The capacity is rounded up to a power of two so that a
+ *               position maps to its slot with a mask.
+ *
+ *               With CIRC_BUFF_STATS each thread counts into its own block of
+ *               thread_stats. A thread claims a block number the first time
+ *               it touches any mpmc buffer and gives it back when it exits,
+ *               so no two live threads ever share a block, however many have
+ *               come and gone. If more than CIRC_BUFF_MPMC_STATS_THREADS
+ *               threads are alive at once, the extra ones are not counted
+ *               until a block is given back.
+ *
+ * Usage:        Do not access the members directly; use the functions below.
+ * ----------------------------------------------------------------------------
+ */
+
+/*typedef a circ_buff_mpmc ptr type so that "*" does not have to be used always*/
+typedef struct circ_buff_mpmc *circ_buff_mpmc_ptr;
+
+typedef struct circ_buff_mpmc
+{
+    /*read-only after init*/
+    circ_buff_mpmc_slot *slots;
+    uint32_t  total_size;
+    uint32_t  mask;
+#ifdef CIRC_BUFF_STATS
+    circ_buff_mpmc_thread_stats *thread_stats;
+#endif
+
+    /*next position a producer will claim*/
+    _Alignas(CIRC_BUFF_CACHE_LINE) _Atomic uint32_t tail;
+
+    /*next position a consumer will claim*/
+    _Alignas(CIRC_BUFF_CACHE_LINE) _Atomic uint32_t head;
+}circ_buff_mpmc;
+
+
+/*
+ * Function:     circ_buff_mpmc_init(circ_buff_mpmc_ptr* mpmc_pointer, int32_t size)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates an mpmc buffer holding at least 'size' uint32_t
+ *               elements. The capacity is rounded up to the next power of two.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: The size is less than or equal to zero or
+ *               larger than CIRC_BUFF_MPMC_MAX_SIZE.
+ *
+ *               CIRC_BUFF_MALLOC_FAIL: An allocation fails. Nothing is leaked.
+ *
+ *               CIRC_BUFF_SUCCESS: The funcion returns successfully.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_mpmc_init(circ_buff_mpmc_ptr* mpmc_pointer, int32_t size);
+
+/*
+ * Function:     circ_buff_mpmc_destroy(circ_buff_mpmc_ptr mpmc_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  De-allocates the slots and the structure. No thread may use
+ *               the buffer during or after this call.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_SUCCESS: The function completes execution
+ *               completely.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_mpmc_destroy(circ_buff_mpmc_ptr mpmc_pointer);
+
+/*
+ * Function:     circ_buff_mpmc_write(circ_buff_mpmc_ptr mpmc_pointer, uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes data to the buffer. Safe to call from any number of
+ *               threads at once.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_FULL: The buffer is full; nothing is written.
+ *
+ *               CIRC_BUFF_SUCCESS: The data is written.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_mpmc_write(circ_buff_mpmc_ptr mpmc_pointer, uint32_t data);
+
+/*
+ * Function:     circ_buff_mpmc_read(circ_buff_mpmc_ptr mpmc_pointer, uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Reads the oldest element into *data. Safe to call from any
+ *               number of threads at once.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: Either of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_EMPTY: The buffer is empty; *data is untouched.
+ *
+ *               CIRC_BUFF_SUCCESS: The data is read.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_mpmc_read(circ_buff_mpmc_ptr mpmc_pointer, uint32_t* data);
+
+#ifdef CIRC_BUFF_STATS
+/*
+ * Function:     circ_buff_mpmc_stats_get(circ_buff_mpmc_ptr mpmc_pointer,
+ *                                        circ_buff_stats* stats)
+ * -----------------------------------------------------------------------------
+ * Description:  Sums the per-thread counters into *stats. Exact when no thread
+ *               is using the buffer, approximate otherwise. high_water is 
+ *               sampled by each producer once every CIRC_BUFF_STATS_SAMPLE of
+ *               its writes.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_mpmc_stats_get(circ_buff_mpmc_ptr mpmc_pointer, circ_buff_stats* stats);
+#endif
+
+#endif
@@ -0,0 +1,411 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_msg.c
+ *
+ * Description:  Contains the variable length record ring declared in 
+ *               circ_buff_msg.h. head and tail only ever move in steps of 8
+ *               bytes, so a header never straddles the end of the storage and
+ *               every payload starts 8 byte aligned.
+ *
+ * */
+
+
+#include "circ_buff_msg.h"
+#include<stdint.h>
+#include<stdlib.h>
+#include<string.h>
+
+
+/*
+ * Function:     circ_buff_msg_footprint(uint32_t length)
+ * -----------------------------------------------------------------------------
+ * Description:  Bytes a record of 'length' bytes takes: the header plus the 
+ *               payload rounded up to CIRC_BUFF_MSG_ALIGN.
+ * ----------------------------------------------------------------------------
+ */
+static inline uint32_t circ_buff_msg_footprint(uint32_t length)
+{
+    return (uint32_t)sizeof(circ_buff_msg_header)+((length+CIRC_BUFF_MSG_ALIGN-1)&~(uint32_t)(CIRC_BUFF_MSG_ALIGN-1));
+}
+
+/*
+ * Function:     circ_buff_msg_at(circ_buff_msg_ptr mb, uint32_t index)
+ * -----------------------------------------------------------------------------
+ * Description:  The header at the free-running byte offset 'index'.
+ * ----------------------------------------------------------------------------
+ */
+static inline circ_buff_msg_header* circ_buff_msg_at(circ_buff_msg_ptr mb, uint32_t index)
+{
+    return (circ_buff_msg_header*)(mb->base+(index&mb->mask));
+}
+
+/*
+ * Function:     circ_buff_msg_front(circ_buff_msg_ptr mb, uint32_t index)
+ * -----------------------------------------------------------------------------
+ * Description:  Steps 'index' over a skip marker, if there is one, and returns
+ *               the offset of the record header. Only called while a record 
+ *               is held, so a real header always follows a skip marker.
+ * ----------------------------------------------------------------------------
+ */
+static inline uint32_t circ_buff_msg_front(circ_buff_msg_ptr mb, uint32_t index)
+{
+    if(circ_buff_msg_at(mb, index)->length==CIRC_BUFF_MSG_SKIP)
+         index+=mb->mask+1-(index&mb->mask);
+    return index;
+}
+
+
+/*
+ * Function:     circ_buff_msg_init(circ_buff_msg_ptr* msg_pointer, int32_t bytes)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates the structure and a power of two bytes of storage.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_init(circ_buff_msg_ptr* msg_pointer, int32_t bytes)
+{
+    /*basic pointer and size check*/
+    if(msg_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(bytes<=0||(uint32_t)bytes>CIRC_BUFF_MAX_SIZE)
+         return CIRC_BUFF_BAD_DATA;
+
+    /*room for at least one header and one 8 byte payload*/
+    uint32_t storage=2*sizeof(circ_buff_msg_header);
+    while(storage<(uint32_t)bytes)
+         storage<<=1;
+
+    circ_buff_msg_ptr mb=(circ_buff_msg_ptr)malloc(sizeof(circ_buff_msg));
+    if(mb==NULL)
+         return CIRC_BUFF_MALLOC_FAIL;
+
+    if(posix_memalign((void**)&mb->base, CIRC_BUFF_CACHE_LINE, storage)!=0)
+    {
+         free(mb);
+         return CIRC_BUFF_MALLOC_FAIL;
+    }
+    mb->mask=storage-1;
+    mb->head=0;
+    mb->tail=0;
+    mb->records=0;
+
+    *msg_pointer=mb;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_msg_destroy(circ_buff_msg_ptr msg_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  De-allocates the storage and the structure.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_destroy(circ_buff_msg_ptr msg_pointer)
+{
+    /*basic pointer check*/
+    if(msg_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    free(msg_pointer->base);
+    msg_pointer->base=NULL;
+    free(msg_pointer);
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_msg_reserve(circ_buff_msg_ptr msg_pointer, uint32_t length,
+ *                                     void** data)
+ * -----------------------------------------------------------------------------
+ * Description:  Finds room for the record at the tail, or at offset zero 
+ *               behind a skip marker when the rest of the storage is too 
+ *               short. An empty ring just moves head and tail to offset zero
+ *               instead of spending the space on a skip marker.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_FULL or 
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_reserve(circ_buff_msg_ptr msg_pointer, uint32_t length, void** data)
+{
+    /*basic pointer check*/
+    if(msg_pointer==NULL||data==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    uint32_t storage=msg_pointer->mask+1;
+    if(length>storage-sizeof(circ_buff_msg_header))
+         return CIRC_BUFF_BAD_DATA;
+
+    /*with no records left, whatever is between head and tail is padding*/
+    if(msg_pointer->records==0)
+         msg_pointer->head=msg_pointer->tail;
+
+    uint32_t footprint=circ_buff_msg_footprint(length);
+    uint32_t to_end=storage-(msg_pointer->tail&msg_pointer->mask);
+    uint32_t free_bytes=storage-(msg_pointer->tail-msg_pointer->head);
+
+    if(footprint>to_end)
+    {
+         if(msg_pointer->records==0)
+         {
+              msg_pointer->tail+=to_end;
+              msg_pointer->head=msg_pointer->tail;
+         }
+         else
+         {
+              if(to_end+footprint>free_bytes)
+                   return CIRC_BUFF_FULL;
+              circ_buff_msg_at(msg_pointer, msg_pointer->tail)->length=CIRC_BUFF_MSG_SKIP;
+              msg_pointer->tail+=to_end;
+         }
+    }
+    else if(footprint>free_bytes)
+         return CIRC_BUFF_FULL;
+
+    *data=circ_buff_msg_at(msg_pointer, msg_pointer->tail)+1;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_msg_commit(circ_buff_msg_ptr msg_pointer, uint32_t length)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes the header in front of the reserved payload and moves
+ *               the tail past it.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_commit(circ_buff_msg_ptr msg_pointer, uint32_t length)
+{
+    /*basic pointer check*/
+    if(msg_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    uint32_t storage=msg_pointer->mask+1;
+    if(length>storage-sizeof(circ_buff_msg_header))
+         return CIRC_BUFF_BAD_DATA;
+
+    /*the record must still lie in front of the tail, without wrapping*/
+    uint32_t footprint=circ_buff_msg_footprint(length);
+    if(footprint>storage-(msg_pointer->tail&msg_pointer->mask)||
+       footprint>storage-(msg_pointer->tail-msg_pointer->head))
+         return CIRC_BUFF_BAD_DATA;
+
+    circ_buff_msg_header* header=circ_buff_msg_at(msg_pointer, msg_pointer->tail);
+    header->length=length;
+    header->reserved=0;
+    msg_pointer->tail+=footprint;
+    msg_pointer->records++;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_msg_write(circ_buff_msg_ptr msg_pointer, const void* data,
+ *                                   uint32_t length)
+ * -----------------------------------------------------------------------------
+ * Description:  reserve, copy and commit.
+ *
+ * Returns:      As circ_buff_msg_reserve.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_write(circ_buff_msg_ptr msg_pointer, const void* data, uint32_t length)
+{
+    if(data==NULL&&length>0)
+         return CIRC_BUFF_NULL_PTR;
+
+    void* slot;
+    circ_buff_code status=circ_buff_msg_reserve(msg_pointer, length, &slot);
+    if(status!=CIRC_BUFF_SUCCESS)
+         return status;
+
+    if(length>0)
+         memcpy(slot, data, length);
+    return circ_buff_msg_commit(msg_pointer, length);
+}
+
+
+/*
+ * Function:     circ_buff_msg_write_batch(circ_buff_msg_ptr msg_pointer,
+ *                                         const circ_buff_msg_record* records,
+ *                                         uint32_t count, uint32_t* written)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes records in order until one does not fit.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_FULL or 
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_write_batch(circ_buff_msg_ptr msg_pointer, const circ_buff_msg_record* records,
+                                         uint32_t count, uint32_t* written)
+{
+    /*basic pointer check*/
+    if(msg_pointer==NULL||written==NULL||(records==NULL&&count>0))
+         return CIRC_BUFF_NULL_PTR;
+
+    uint32_t index;
+    for(index=0; index<count; index++)
+    {
+         circ_buff_code status=circ_buff_msg_write(msg_pointer, records[index].data, records[index].length);
+         if(status!=CIRC_BUFF_SUCCESS)
+         {
+              *written=index;
+              return status;
+         }
+    }
+    *written=count;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_msg_peek(circ_buff_msg_ptr msg_pointer,
+ *                                  circ_buff_msg_record* record)
+ * -----------------------------------------------------------------------------
+ * Description:  Points record at the oldest payload in the storage.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_peek(circ_buff_msg_ptr msg_pointer, circ_buff_msg_record* record)
+{
+    /*basic pointer check*/
+    if(msg_pointer==NULL||record==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(msg_pointer->records==0)
+         return CIRC_BUFF_EMPTY;
+
+    msg_pointer->head=circ_buff_msg_front(msg_pointer, msg_pointer->head);
+    circ_buff_msg_header* header=circ_buff_msg_at(msg_pointer, msg_pointer->head);
+    record->data=header+1;
+    record->length=header->length;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_msg_read_batch(circ_buff_msg_ptr msg_pointer,
+ *                                        circ_buff_msg_record* records,
+ *                                        uint32_t count, uint32_t* read)
+ * -----------------------------------------------------------------------------
+ * Description:  Walks the headers from the head without consuming anything.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_read_batch(circ_buff_msg_ptr msg_pointer, circ_buff_msg_record* records,
+                                        uint32_t count, uint32_t* read)
+{
+    /*basic pointer check*/
+    if(msg_pointer==NULL||read==NULL||(records==NULL&&count>0))
+         return CIRC_BUFF_NULL_PTR;
+
+    *read=0;
+    if(msg_pointer->records==0)
+         return CIRC_BUFF_EMPTY;
+
+    if(count>msg_pointer->records)
+         count=msg_pointer->records;
+
+    uint32_t index=msg_pointer->head;
+    uint32_t taken;
+    for(taken=0; taken<count; taken++)
+    {
+         index=circ_buff_msg_front(msg_pointer, index);
+         circ_buff_msg_header* header=circ_buff_msg_at(msg_pointer, index);
+         records[taken].data=header+1;
+         records[taken].length=header->length;
+         index+=circ_buff_msg_footprint(header->length);
+    }
+    *read=count;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_msg_release(circ_buff_msg_ptr msg_pointer, uint32_t count)
+ * -----------------------------------------------------------------------------
+ * Description:  Moves the head past 'count' records and the skip markers in
+ *               between.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_release(circ_buff_msg_ptr msg_pointer, uint32_t count)
+{
+    /*basic pointer check*/
+    if(msg_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(count>msg_pointer->records)
+         return CIRC_BUFF_BAD_DATA;
+
+    uint32_t index=msg_pointer->head;
+    uint32_t released;
+    for(released=0; released<count; released++)
+    {
+         index=circ_buff_msg_front(msg_pointer, index);
+         index+=circ_buff_msg_footprint(circ_buff_msg_at(msg_pointer, index)->length);
+    }
+    msg_pointer->head=index;
+    msg_pointer->records-=count;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_msg_read(circ_buff_msg_ptr msg_pointer, void* data,
+ *                                  uint32_t capacity, uint32_t* length)
+ * -----------------------------------------------------------------------------
+ * Description:  peek, copy and release one record.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY, CIRC_BUFF_BAD_DATA or 
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_read(circ_buff_msg_ptr msg_pointer, void* data, uint32_t capacity, uint32_t* length)
+{
+    /*basic pointer check*/
+    if(length==NULL||(data==NULL&&capacity>0))
+         return CIRC_BUFF_NULL_PTR;
+
+    circ_buff_msg_record record;
+    circ_buff_code status=circ_buff_msg_peek(msg_pointer, &record);
+    if(status!=CIRC_BUFF_SUCCESS)
+         return status;
+
+    *length=record.length;
+    if(record.length>capacity)
+         return CIRC_BUFF_BAD_DATA;
+    if(record.length>0)
+         memcpy(data, record.data, record.length);
+    return circ_buff_msg_release(msg_pointer, 1);
+}
+
+
+/*
+ * Function:     circ_buff_msg_count(circ_buff_msg_ptr msg_pointer, uint32_t* records,
+ *                                   uint32_t* bytes)
+ * -----------------------------------------------------------------------------
+ * Description:  Reports the record count and the bytes between head and tail.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_count(circ_buff_msg_ptr msg_pointer, uint32_t* records, uint32_t* bytes)
+{
+    /*basic pointer check*/
+    if(msg_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    if(records!=NULL)
+         *records=msg_pointer->records;
+    if(bytes!=NULL)
+         *bytes=msg_pointer->records==0 ? 0 : msg_pointer->tail-msg_pointer->head;
+    return CIRC_BUFF_SUCCESS;
+}
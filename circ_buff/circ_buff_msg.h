@@ -0,0 +1,268 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_msg.h
+ *
+ * Description:  Declares a byte oriented circular buffer for variable length
+ *               records (log lines, packet headers, ...), kept alongside the
+ *               uint32_t circ_buff in circ_buff.h. Each record is stored as an
+ *               8 byte header followed by its payload, padded to a multiple of
+ *               8 bytes. A record never wraps: when it would not fit before the
+ *               end of the storage, the rest of the storage is marked with a 
+ *               skip header and the record starts again at offset zero. Every
+ *               record can therefore be used in place as one contiguous, 8 
+ *               byte aligned slice.
+ *
+ *               Like circ_buff, it is meant for one thread; hand records 
+ *               between threads with external locking.
+ *
+ * Usage:        circ_buff_msg_ptr mb;
+ *               circ_buff_msg_init(&mb, 1<<16);
+ *               circ_buff_msg_write(mb, line, strlen(line));
+ *               circ_buff_msg_peek(mb, &record);    //record.data, record.length
+ *               circ_buff_msg_release(mb, 1);
+ *
+ * */
+
+#ifndef _CIRC_BUFF_MSG_H
+#define _CIRC_BUFF_MSG_H
+#include<stdint.h>
+#include "circ_buff.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*record payloads start on this boundary*/
+#define CIRC_BUFF_MSG_ALIGN 8
+
+/*header length value that marks padding up to the end of the storage*/
+#define CIRC_BUFF_MSG_SKIP 0xffffffffu
+
+
+/*
+ * Structure:    circ_buff_msg_header
+ * -----------------------------------------------------------------------------
+ * Description:  Sits in front of every record. 'reserved' is always zero; it
+ *               keeps the payload 8 byte aligned.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_msg_header
+{
+    uint32_t  length;
+    uint32_t  reserved;
+}circ_buff_msg_header;
+
+
+/*
+ * Structure:    circ_buff_msg_record
+ * -----------------------------------------------------------------------------
+ * Description:  One record as a pointer and a length in bytes. Passed in to 
+ *               the batch write, and handed out (pointing into the storage)
+ *               by peek and the batch read.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_msg_record
+{
+    const void *data;
+    uint32_t    length;
+}circ_buff_msg_record;
+
+
+/*
+ * Structure:    circ_buff_msg
+ * -----------------------------------------------------------------------------
+ * Description:  head and tail are free-running byte offsets, as in circ_buff;
+ *               both are always multiples of 8. The storage holds mask+1 
+ *               bytes, a power of two. 'records' is the number of records 
+ *               held.
+ *
+ * Usage:        Do not access the members directly; use the functions below.
+ * ----------------------------------------------------------------------------
+ */
+
+/*typedef a circ_buff_msg ptr type so that "*" does not have to be used always*/
+typedef struct circ_buff_msg *circ_buff_msg_ptr;
+
+typedef struct circ_buff_msg
+{
+    uint8_t  *base;
+    uint32_t  head;
+    uint32_t  tail;
+    uint32_t  mask;
+    uint32_t  records;
+}circ_buff_msg;
+
+
+/*
+ * Function:     circ_buff_msg_init(circ_buff_msg_ptr* msg_pointer, int32_t bytes)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates a message ring with at least 'bytes' bytes of 
+ *               storage, rounded up to a power of two (and to at least 16). 
+ *               Headers and padding take space too: a record of n bytes uses
+ *               8+n rounded up to a multiple of 8.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: bytes is less than or equal to zero or 
+ *               larger than CIRC_BUFF_MAX_SIZE.
+ *
+ *               CIRC_BUFF_MALLOC_FAIL: An allocation fails. Nothing is leaked.
+ *
+ *               CIRC_BUFF_SUCCESS: The funcion returns successfully.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_init(circ_buff_msg_ptr* msg_pointer, int32_t bytes);
+
+/*
+ * Function:     circ_buff_msg_destroy(circ_buff_msg_ptr msg_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  De-allocates the storage and the structure.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_destroy(circ_buff_msg_ptr msg_pointer);
+
+/*
+ * Function:     circ_buff_msg_reserve(circ_buff_msg_ptr msg_pointer, uint32_t length,
+ *                                     void** data)
+ * -----------------------------------------------------------------------------
+ * Description:  Finds room for a record of up to 'length' bytes and returns
+ *               where its payload goes in *data, 8 byte aligned. The record 
+ *               is not visible until circ_buff_msg_commit. If the record has
+ *               to wrap, the skip marker is written here.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: A pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: The record can never fit in this ring.
+ *
+ *               CIRC_BUFF_FULL: Not enough free space right now.
+ *
+ *               CIRC_BUFF_SUCCESS: *data has room for 'length' bytes.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_reserve(circ_buff_msg_ptr msg_pointer, uint32_t length, void** data);
+
+/*
+ * Function:     circ_buff_msg_commit(circ_buff_msg_ptr msg_pointer, uint32_t length)
+ * -----------------------------------------------------------------------------
+ * Description:  Publishes the record filled in after circ_buff_msg_reserve.
+ *               'length' may be less than the length reserved.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA (length does not fit 
+ *               in front of the tail) or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_commit(circ_buff_msg_ptr msg_pointer, uint32_t length);
+
+/*
+ * Function:     circ_buff_msg_write(circ_buff_msg_ptr msg_pointer, const void* data,
+ *                                   uint32_t length)
+ * -----------------------------------------------------------------------------
+ * Description:  Copies one record of 'length' bytes in. A zero length record
+ *               is allowed.
+ *
+ * Returns:      As circ_buff_msg_reserve.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_write(circ_buff_msg_ptr msg_pointer, const void* data, uint32_t length);
+
+/*
+ * Function:     circ_buff_msg_write_batch(circ_buff_msg_ptr msg_pointer,
+ *                                         const circ_buff_msg_record* records,
+ *                                         uint32_t count, uint32_t* written)
+ * -----------------------------------------------------------------------------
+ * Description:  Copies in as many of the 'count' records as fit, in order,
+ *               and returns how many in *written.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: A pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: records[*written] can never fit.
+ *
+ *               CIRC_BUFF_FULL: Only *written records fit.
+ *
+ *               CIRC_BUFF_SUCCESS: All records are written.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_write_batch(circ_buff_msg_ptr msg_pointer, const circ_buff_msg_record* records,
+                                         uint32_t count, uint32_t* written);
+
+/*
+ * Function:     circ_buff_msg_peek(circ_buff_msg_ptr msg_pointer,
+ *                                  circ_buff_msg_record* record)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the oldest record in place. It stays valid until it
+ *               is released.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_peek(circ_buff_msg_ptr msg_pointer, circ_buff_msg_record* record);
+
+/*
+ * Function:     circ_buff_msg_read_batch(circ_buff_msg_ptr msg_pointer,
+ *                                        circ_buff_msg_record* records,
+ *                                        uint32_t count, uint32_t* read)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns up to 'count' of the oldest records in place, oldest
+ *               first, and how many in *read. Nothing is consumed; call
+ *               circ_buff_msg_release(msg_pointer, *read) when done with them.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_read_batch(circ_buff_msg_ptr msg_pointer, circ_buff_msg_record* records,
+                                        uint32_t count, uint32_t* read);
+
+/*
+ * Function:     circ_buff_msg_release(circ_buff_msg_ptr msg_pointer, uint32_t count)
+ * -----------------------------------------------------------------------------
+ * Description:  Drops the 'count' oldest records.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA (fewer records held)
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_release(circ_buff_msg_ptr msg_pointer, uint32_t count);
+
+/*
+ * Function:     circ_buff_msg_read(circ_buff_msg_ptr msg_pointer, void* data,
+ *                                  uint32_t capacity, uint32_t* length)
+ * -----------------------------------------------------------------------------
+ * Description:  Copies the oldest record into data and drops it. *length gets
+ *               the record's length.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: A pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_EMPTY: There is no record.
+ *
+ *               CIRC_BUFF_BAD_DATA: The record is longer than 'capacity'; it
+ *               is left in place and *length tells the size needed.
+ *
+ *               CIRC_BUFF_SUCCESS: The record is copied out.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_read(circ_buff_msg_ptr msg_pointer, void* data, uint32_t capacity, uint32_t* length);
+
+/*
+ * Function:     circ_buff_msg_count(circ_buff_msg_ptr msg_pointer, uint32_t* records,
+ *                                   uint32_t* bytes)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the number of records held and the bytes they use,
+ *               headers and padding included. Either pointer may be NULL.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_msg_count(circ_buff_msg_ptr msg_pointer, uint32_t* records, uint32_t* bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,436 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_scan.c
+ *
+ * Description:  Contains the read-only scans declared in circ_buff_scan.h and
+ *               their per-span kernels. The SIMD kernels are compiled with
+ *               per-function target attributes, so the rest of the library 
+ *               still runs on any x86-64, and they are only called after 
+ *               __builtin_cpu_supports says the CPU has the instructions.
+ *
+ * */
+
+
+#include "circ_buff_scan.h"
+#include<stdint.h>
+#include<stddef.h>
+#include<stdatomic.h>
+
+#if defined(__x86_64__)||defined(__i386__)
+#define CIRC_BUFF_SCAN_X86
+#include<immintrin.h>
+#endif
+
+
+/*
+ * Structure:    circ_buff_scan_kernels
+ * -----------------------------------------------------------------------------
+ * Description:  One flavour of the per-span kernels. find returns the index 
+ *               of the first match or 'count'; min_max folds the span into
+ *               *min and *max.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_scan_kernels
+{
+    circ_buff_scan_isa isa;
+    uint32_t (*find)(const uint32_t* data, uint32_t count, uint32_t value);
+    uint32_t (*count_equal)(const uint32_t* data, uint32_t count, uint32_t value);
+    void     (*min_max)(const uint32_t* data, uint32_t count, uint32_t* min, uint32_t* max);
+    uint64_t (*sum)(const uint32_t* data, uint32_t count);
+}circ_buff_scan_kernels;
+
+
+/*scalar kernels; also finish the tails of the SIMD ones*/
+static uint32_t circ_buff_find_scalar(const uint32_t* data, uint32_t count, uint32_t value)
+{
+    uint32_t index;
+    for(index=0; index<count; index++)
+    {
+         if(data[index]==value)
+              return index;
+    }
+    return count;
+}
+
+static uint32_t circ_buff_count_scalar(const uint32_t* data, uint32_t count, uint32_t value)
+{
+    uint32_t index, matches=0;
+    for(index=0; index<count; index++)
+         matches+=data[index]==value;
+    return matches;
+}
+
+static void circ_buff_min_max_scalar(const uint32_t* data, uint32_t count, uint32_t* min, uint32_t* max)
+{
+    uint32_t index, lo=*min, hi=*max;
+    for(index=0; index<count; index++)
+    {
+         lo=data[index]<lo ? data[index] : lo;
+         hi=data[index]>hi ? data[index] : hi;
+    }
+    *min=lo;
+    *max=hi;
+}
+
+static uint64_t circ_buff_sum_scalar(const uint32_t* data, uint32_t count)
+{
+    uint32_t index;
+    uint64_t sum=0;
+    for(index=0; index<count; index++)
+         sum+=data[index];
+    return sum;
+}
+
+static const circ_buff_scan_kernels circ_buff_scan_scalar=
+{
+    CIRC_BUFF_SCAN_SCALAR, circ_buff_find_scalar, circ_buff_count_scalar, circ_buff_min_max_scalar, circ_buff_sum_scalar
+};
+
+
+#ifdef CIRC_BUFF_SCAN_X86
+/*SSE4.1 kernels, four elements at a time*/
+__attribute__((target("sse4.1")))
+static uint32_t circ_buff_find_sse4(const uint32_t* data, uint32_t count, uint32_t value)
+{
+    __m128i needle=_mm_set1_epi32((int)value);
+    uint32_t index=0;
+
+    for(; index+4<=count; index+=4)
+    {
+         __m128i equal=_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(data+index)), needle);
+         int hits=_mm_movemask_ps(_mm_castsi128_ps(equal));
+         if(hits)
+              return index+(uint32_t)__builtin_ctz((unsigned)hits);
+    }
+    return index+circ_buff_find_scalar(data+index, count-index, value);
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t circ_buff_count_sse4(const uint32_t* data, uint32_t count, uint32_t value)
+{
+    __m128i needle=_mm_set1_epi32((int)value), matches=_mm_setzero_si128();
+    uint32_t index=0, lanes[4];
+
+    /*a match is all ones, so subtracting it counts one*/
+    for(; index+4<=count; index+=4)
+         matches=_mm_sub_epi32(matches, _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(data+index)), needle));
+    _mm_storeu_si128((__m128i*)lanes, matches);
+    return lanes[0]+lanes[1]+lanes[2]+lanes[3]+circ_buff_count_scalar(data+index, count-index, value);
+}
+
+__attribute__((target("sse4.1")))
+static void circ_buff_min_max_sse4(const uint32_t* data, uint32_t count, uint32_t* min, uint32_t* max)
+{
+    __m128i lo=_mm_set1_epi32((int)*min), hi=_mm_set1_epi32((int)*max);
+    uint32_t index=0, lanes[4];
+
+    for(; index+4<=count; index+=4)
+    {
+         __m128i values=_mm_loadu_si128((const __m128i*)(data+index));
+         lo=_mm_min_epu32(lo, values);
+         hi=_mm_max_epu32(hi, values);
+    }
+    _mm_storeu_si128((__m128i*)lanes, lo);
+    circ_buff_min_max_scalar(lanes, 4, min, max);
+    _mm_storeu_si128((__m128i*)lanes, hi);
+    circ_buff_min_max_scalar(lanes, 4, min, max);
+    circ_buff_min_max_scalar(data+index, count-index, min, max);
+}
+
+__attribute__((target("sse4.1")))
+static uint64_t circ_buff_sum_sse4(const uint32_t* data, uint32_t count)
+{
+    __m128i zero=_mm_setzero_si128(), sum=_mm_setzero_si128();
+    uint32_t index=0;
+    uint64_t lanes[2];
+
+    /*widen to 64 bits before adding so nothing overflows*/
+    for(; index+4<=count; index+=4)
+    {
+         __m128i values=_mm_loadu_si128((const __m128i*)(data+index));
+         sum=_mm_add_epi64(sum, _mm_unpacklo_epi32(values, zero));
+         sum=_mm_add_epi64(sum, _mm_unpackhi_epi32(values, zero));
+    }
+    _mm_storeu_si128((__m128i*)lanes, sum);
+    return lanes[0]+lanes[1]+circ_buff_sum_scalar(data+index, count-index);
+}
+
+static const circ_buff_scan_kernels circ_buff_scan_sse4=
+{
+    CIRC_BUFF_SCAN_SSE4, circ_buff_find_sse4, circ_buff_count_sse4, circ_buff_min_max_sse4, circ_buff_sum_sse4
+};
+
+
+/*AVX2 kernels, eight elements at a time*/
+__attribute__((target("avx2")))
+static uint32_t circ_buff_find_avx2(const uint32_t* data, uint32_t count, uint32_t value)
+{
+    __m256i needle=_mm256_set1_epi32((int)value);
+    uint32_t index=0;
+
+    for(; index+8<=count; index+=8)
+    {
+         __m256i equal=_mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(data+index)), needle);
+         int hits=_mm256_movemask_ps(_mm256_castsi256_ps(equal));
+         if(hits)
+              return index+(uint32_t)__builtin_ctz((unsigned)hits);
+    }
+    return index+circ_buff_find_scalar(data+index, count-index, value);
+}
+
+__attribute__((target("avx2")))
+static uint32_t circ_buff_count_avx2(const uint32_t* data, uint32_t count, uint32_t value)
+{
+    __m256i needle=_mm256_set1_epi32((int)value), matches=_mm256_setzero_si256();
+    uint32_t index=0, lanes[8], total=0, lane;
+
+    for(; index+8<=count; index+=8)
+         matches=_mm256_sub_epi32(matches, _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(data+index)), needle));
+    _mm256_storeu_si256((__m256i*)lanes, matches);
+    for(lane=0; lane<8; lane++)
+         total+=lanes[lane];
+    return total+circ_buff_count_scalar(data+index, count-index, value);
+}
+
+__attribute__((target("avx2")))
+static void circ_buff_min_max_avx2(const uint32_t* data, uint32_t count, uint32_t* min, uint32_t* max)
+{
+    __m256i lo=_mm256_set1_epi32((int)*min), hi=_mm256_set1_epi32((int)*max);
+    uint32_t index=0, lanes[8];
+
+    for(; index+8<=count; index+=8)
+    {
+         __m256i values=_mm256_loadu_si256((const __m256i*)(data+index));
+         lo=_mm256_min_epu32(lo, values);
+         hi=_mm256_max_epu32(hi, values);
+    }
+    _mm256_storeu_si256((__m256i*)lanes, lo);
+    circ_buff_min_max_scalar(lanes, 8, min, max);
+    _mm256_storeu_si256((__m256i*)lanes, hi);
+    circ_buff_min_max_scalar(lanes, 8, min, max);
+    circ_buff_min_max_scalar(data+index, count-index, min, max);
+}
+
+__attribute__((target("avx2")))
+static uint64_t circ_buff_sum_avx2(const uint32_t* data, uint32_t count)
+{
+    __m256i sum=_mm256_setzero_si256();
+    uint32_t index=0;
+    uint64_t lanes[4];
+
+    for(; index+8<=count; index+=8)
+    {
+         sum=_mm256_add_epi64(sum, _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)(data+index))));
+         sum=_mm256_add_epi64(sum, _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)(data+index+4))));
+    }
+    _mm256_storeu_si256((__m256i*)lanes, sum);
+    return lanes[0]+lanes[1]+lanes[2]+lanes[3]+circ_buff_sum_scalar(data+index, count-index);
+}
+
+static const circ_buff_scan_kernels circ_buff_scan_avx2=
+{
+    CIRC_BUFF_SCAN_AVX2, circ_buff_find_avx2, circ_buff_count_avx2, circ_buff_min_max_avx2, circ_buff_sum_avx2
+};
+#endif
+
+
+/*the kernels in use; NULL until the first scan picks them*/
+static const circ_buff_scan_kernels* _Atomic circ_buff_scan_active;
+
+/*
+ * Function:     circ_buff_scan_supported(circ_buff_scan_isa isa)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the kernels for 'isa' if this CPU can run them, the
+ *               best available ones for CIRC_BUFF_SCAN_AUTO, or NULL.
+ * ----------------------------------------------------------------------------
+ */
+static const circ_buff_scan_kernels* circ_buff_scan_supported(circ_buff_scan_isa isa)
+{
+#ifdef CIRC_BUFF_SCAN_X86
+    __builtin_cpu_init();
+    int avx2=__builtin_cpu_supports("avx2");
+    int sse4=__builtin_cpu_supports("sse4.1");
+
+    switch(isa)
+    {
+    case CIRC_BUFF_SCAN_AUTO:
+         return avx2 ? &circ_buff_scan_avx2 : sse4 ? &circ_buff_scan_sse4 : &circ_buff_scan_scalar;
+    case CIRC_BUFF_SCAN_AVX2:
+         return avx2 ? &circ_buff_scan_avx2 : NULL;
+    case CIRC_BUFF_SCAN_SSE4:
+         return sse4 ? &circ_buff_scan_sse4 : NULL;
+    case CIRC_BUFF_SCAN_SCALAR:
+         return &circ_buff_scan_scalar;
+    }
+    return NULL;
+#else
+    return (isa==CIRC_BUFF_SCAN_AUTO||isa==CIRC_BUFF_SCAN_SCALAR) ? &circ_buff_scan_scalar : NULL;
+#endif
+}
+
+/*the active kernels; the first caller picks them, a race only repeats the pick*/
+static inline const circ_buff_scan_kernels* circ_buff_scan_kernels_get(void)
+{
+    const circ_buff_scan_kernels* kernels=atomic_load_explicit(&circ_buff_scan_active, memory_order_relaxed);
+    if(kernels==NULL)
+    {
+         kernels=circ_buff_scan_supported(CIRC_BUFF_SCAN_AUTO);
+         atomic_store_explicit(&circ_buff_scan_active, kernels, memory_order_relaxed);
+    }
+    return kernels;
+}
+
+
+/*
+ * Function:     circ_buff_scan_select(circ_buff_scan_isa isa)
+ * -----------------------------------------------------------------------------
+ * Description:  Swaps in the kernels for 'isa' if the CPU supports them.
+ *
+ * Returns:      CIRC_BUFF_BAD_DATA or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_scan_select(circ_buff_scan_isa isa)
+{
+    const circ_buff_scan_kernels* kernels=circ_buff_scan_supported(isa);
+    if(kernels==NULL)
+         return CIRC_BUFF_BAD_DATA;
+
+    atomic_store_explicit(&circ_buff_scan_active, kernels, memory_order_relaxed);
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_scan_current(void)
+ * -----------------------------------------------------------------------------
+ * Description:  Reports the flavour in use, picking it if no scan has run.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_scan_isa circ_buff_scan_current(void)
+{
+    return circ_buff_scan_kernels_get()->isa;
+}
+
+
+/*
+ * Function:     circ_buff_find(circ_buff_ptr circ_buff_pointer, uint32_t value,
+ *                              uint32_t* position)
+ * -----------------------------------------------------------------------------
+ * Description:  Runs the find kernel over each span in turn and stops at the
+ *               first match.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_find(circ_buff_ptr circ_buff_pointer, uint32_t value, uint32_t* position)
+{
+    /*basic pointer check*/
+    if(circ_buff_pointer==NULL||position==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    const circ_buff_scan_kernels* kernels=circ_buff_scan_kernels_get();
+    circ_buff_iter iter;
+    circ_buff_span span;
+    uint32_t offset=0;
+
+    circ_buff_iter_begin(circ_buff_pointer, &iter);
+    while(circ_buff_iter_span(&iter, &span)==CIRC_BUFF_SUCCESS)
+    {
+         uint32_t found=kernels->find(span.data, span.count, value);
+         if(found<span.count)
+         {
+              *position=offset+found;
+              return CIRC_BUFF_SUCCESS;
+         }
+         offset+=span.count;
+    }
+    *position=offset;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_count_equal(circ_buff_ptr circ_buff_pointer, uint32_t value,
+ *                                     uint32_t* count)
+ * -----------------------------------------------------------------------------
+ * Description:  Adds up the count kernel over the spans.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_count_equal(circ_buff_ptr circ_buff_pointer, uint32_t value, uint32_t* count)
+{
+    /*basic pointer check*/
+    if(circ_buff_pointer==NULL||count==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    const circ_buff_scan_kernels* kernels=circ_buff_scan_kernels_get();
+    circ_buff_iter iter;
+    circ_buff_span span;
+
+    *count=0;
+    circ_buff_iter_begin(circ_buff_pointer, &iter);
+    while(circ_buff_iter_span(&iter, &span)==CIRC_BUFF_SUCCESS)
+         *count+=kernels->count_equal(span.data, span.count, value);
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_min_max(circ_buff_ptr circ_buff_pointer, uint32_t* min,
+ *                                 uint32_t* max)
+ * -----------------------------------------------------------------------------
+ * Description:  Folds the spans into one running min and max.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_min_max(circ_buff_ptr circ_buff_pointer, uint32_t* min, uint32_t* max)
+{
+    /*basic pointer check*/
+    if(circ_buff_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    const circ_buff_scan_kernels* kernels=circ_buff_scan_kernels_get();
+    circ_buff_iter iter;
+    circ_buff_span span;
+    uint32_t lo=UINT32_MAX, hi=0;
+
+    if(circ_buff_iter_begin(circ_buff_pointer, &iter)==CIRC_BUFF_EMPTY)
+         return CIRC_BUFF_EMPTY;
+    while(circ_buff_iter_span(&iter, &span)==CIRC_BUFF_SUCCESS)
+         kernels->min_max(span.data, span.count, &lo, &hi);
+
+    if(min!=NULL)
+         *min=lo;
+    if(max!=NULL)
+         *max=hi;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_sum(circ_buff_ptr circ_buff_pointer, uint64_t* sum)
+ * -----------------------------------------------------------------------------
+ * Description:  Adds up the sum kernel over the spans.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_sum(circ_buff_ptr circ_buff_pointer, uint64_t* sum)
+{
+    /*basic pointer check*/
+    if(circ_buff_pointer==NULL||sum==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    const circ_buff_scan_kernels* kernels=circ_buff_scan_kernels_get();
+    circ_buff_iter iter;
+    circ_buff_span span;
+
+    *sum=0;
+    circ_buff_iter_begin(circ_buff_pointer, &iter);
+    while(circ_buff_iter_span(&iter, &span)==CIRC_BUFF_SUCCESS)
+         *sum+=kernels->sum(span.data, span.count);
+    return CIRC_BUFF_SUCCESS;
+}
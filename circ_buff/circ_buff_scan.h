@@ -0,0 +1,101 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_scan.h
+ *
+ * Description:  Declares read-only scans over the elements held in a circ_buff:
+ *               find the first element equal to a value, count the elements 
+ *               equal to a value, min/max and sum. Nothing is consumed. Each
+ *               scan walks at most the two spans of a wrapped buffer.
+ *
+ *               The per-span kernels come in scalar, SSE4.1 and AVX2 flavours;
+ *               the best one the CPU supports is picked the first time a scan
+ *               runs. circ_buff_scan_select can force a flavour, e.g. to 
+ *               compare them in a test or a benchmark.
+ *
+ * Usage:        uint32_t position, min, max;
+ *               circ_buff_find(cb, 42, &position);   //position==size: absent
+ *               circ_buff_min_max(cb, &min, &max);
+ *
+ * */
+
+#ifndef _CIRC_BUFF_SCAN_H
+#define _CIRC_BUFF_SCAN_H
+#include<stdint.h>
+#include "circ_buff.h"
+
+/*kernel flavours for circ_buff_scan_select*/
+typedef enum {CIRC_BUFF_SCAN_AUTO, CIRC_BUFF_SCAN_SCALAR, CIRC_BUFF_SCAN_SSE4, CIRC_BUFF_SCAN_AVX2} circ_buff_scan_isa;
+
+
+/*
+ * Function:     circ_buff_scan_select(circ_buff_scan_isa isa)
+ * -----------------------------------------------------------------------------
+ * Description:  Makes every later scan use the given kernels. 
+ *               CIRC_BUFF_SCAN_AUTO goes back to the best supported ones.
+ *               Not meant to be called while other threads are scanning.
+ *
+ * Returns:      CIRC_BUFF_BAD_DATA if this CPU or build can not run 'isa',
+ *               otherwise CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_scan_select(circ_buff_scan_isa isa);
+
+/*
+ * Function:     circ_buff_scan_current(void)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the flavour the scans use now, never 
+ *               CIRC_BUFF_SCAN_AUTO.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_scan_isa circ_buff_scan_current(void);
+
+/*
+ * Function:     circ_buff_find(circ_buff_ptr circ_buff_pointer, uint32_t value,
+ *                              uint32_t* position)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns in *position how many elements from the head the 
+ *               oldest element equal to 'value' is, or the number of elements
+ *               held if there is none.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_find(circ_buff_ptr circ_buff_pointer, uint32_t value, uint32_t* position);
+
+/*
+ * Function:     circ_buff_count_equal(circ_buff_ptr circ_buff_pointer, uint32_t value,
+ *                                     uint32_t* count)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns in *count how many elements held equal 'value'.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_count_equal(circ_buff_ptr circ_buff_pointer, uint32_t value, uint32_t* count);
+
+/*
+ * Function:     circ_buff_min_max(circ_buff_ptr circ_buff_pointer, uint32_t* min,
+ *                                 uint32_t* max)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the smallest and largest element held. Either pointer
+ *               may be NULL.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY (*min and *max untouched)
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_min_max(circ_buff_ptr circ_buff_pointer, uint32_t* min, uint32_t* max);
+
+/*
+ * Function:     circ_buff_sum(circ_buff_ptr circ_buff_pointer, uint64_t* sum)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the sum of the elements held; 64 bits can not 
+ *               overflow for any buffer size.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_sum(circ_buff_ptr circ_buff_pointer, uint64_t* sum);
+
+#endif
@@ -0,0 +1,350 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_shard.c
+ *
+ * Description:  Contains the sharded buffer with work stealing consumers. See
+ *               circ_buff_shard.h for how a batch is claimed.
+ *
+ * */
+
+
+#include "circ_buff_shard.h"
+#include<stdint.h>
+#include<stddef.h>
+#include<stdlib.h>
+#include<stdatomic.h>
+#include<string.h>
+
+
+/*
+ * Function:     circ_buff_shard_take(circ_buff_shard_ptr sh, uint32_t shard, uint32_t* data,
+ *                                    uint32_t count, int half)
+ * -----------------------------------------------------------------------------
+ * Description:  Copies up to 'count' of the shard's oldest elements, or up to
+ *               half of them when stealing, and claims them with a CAS on
+ *               head. A failed CAS reloads head and copies again. Returns how
+ *               many were taken.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t circ_buff_shard_take(circ_buff_shard_ptr sh, uint32_t shard, uint32_t* data, uint32_t count, int half)
+{
+    circ_buff_shard_ring* ring=&sh->rings[shard];
+    _Atomic uint32_t* base=sh->base+(size_t)shard*sh->total_size;
+    uint32_t head=atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t index;
+
+    for(;;)
+    {
+         uint32_t tail=atomic_load_explicit(&ring->tail, memory_order_acquire);
+         uint32_t occupied=tail-head;
+         if(occupied==0)
+              return 0;
+
+         /*head went stale while tail was loaded; look again*/
+         if(occupied>sh->total_size)
+         {
+              head=atomic_load_explicit(&ring->head, memory_order_acquire);
+              continue;
+         }
+
+         uint32_t take=half ? (occupied+1)/2 : occupied;
+         if(take>count)
+              take=count;
+         for(index=0; index<take; index++)
+              data[index]=atomic_load_explicit(&base[(head+index)&sh->mask], memory_order_relaxed);
+
+         /*release: the copy is done before the producer may refill the slots*/
+         if(atomic_compare_exchange_weak_explicit(&ring->head, &head, head+take,
+                                                  memory_order_release, memory_order_acquire))
+              return take;
+    }
+}
+
+/*
+ * Function:     circ_buff_shard_victim(circ_buff_shard_ptr sh, uint32_t consumer)
+ * -----------------------------------------------------------------------------
+ * Description:  Finds the fullest shard that is not one of the consumer's home
+ *               shards. The counts are a snapshot and may be stale by the time
+ *               the steal happens; take copes with that.
+ *
+ * Returns:      The shard number, or sh->shards if they are all empty.
+ * ----------------------------------------------------------------------------
+ */
+static uint32_t circ_buff_shard_victim(circ_buff_shard_ptr sh, uint32_t consumer)
+{
+    uint32_t shard, victim=sh->shards, fullest=0;
+
+    for(shard=0; shard<sh->shards; shard++)
+    {
+         if(shard%sh->consumer_count==consumer)
+              continue;
+         circ_buff_shard_ring* ring=&sh->rings[shard];
+         uint32_t occupied=atomic_load_explicit(&ring->tail, memory_order_relaxed)
+                          -atomic_load_explicit(&ring->head, memory_order_relaxed);
+         if(occupied>fullest&&occupied<=sh->total_size)
+         {
+              fullest=occupied;
+              victim=shard;
+         }
+    }
+    return victim;
+}
+
+
+/*
+ * Function:     circ_buff_shard_init(circ_buff_shard_ptr* shard_pointer, uint32_t shards,
+ *                                    int32_t size, uint32_t consumers)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates the storage of every shard in one block, the ring
+ *               indices and the consumer states, each on its own cache lines.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_init(circ_buff_shard_ptr* shard_pointer, uint32_t shards, int32_t size, uint32_t consumers)
+{
+    /*basic pointer and size check*/
+    if(shard_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(size<=0||(uint32_t)size>CIRC_BUFF_SHARD_MAX_SIZE)
+         return CIRC_BUFF_BAD_DATA;
+    if(shards==0||shards>CIRC_BUFF_SHARD_MAX_SHARDS||consumers==0||consumers>CIRC_BUFF_SHARD_MAX_SHARDS)
+         return CIRC_BUFF_BAD_DATA;
+
+    /*round the capacity up to a power of two*/
+    uint32_t capacity=1;
+    while(capacity<(uint32_t)size)
+         capacity<<=1;
+
+    circ_buff_shard_ptr sh=(circ_buff_shard_ptr)calloc(1, sizeof(circ_buff_shard));
+    if(sh==NULL)
+         return CIRC_BUFF_MALLOC_FAIL;
+
+    /*each shard's storage starts on a cache line once it is a line or more*/
+    if(posix_memalign((void**)&sh->base, CIRC_BUFF_CACHE_LINE, sizeof(uint32_t)*(size_t)capacity*shards)!=0
+       ||posix_memalign((void**)&sh->rings, CIRC_BUFF_CACHE_LINE, sizeof(circ_buff_shard_ring)*shards)!=0
+       ||posix_memalign((void**)&sh->consumers, CIRC_BUFF_CACHE_LINE, sizeof(circ_buff_shard_consumer)*consumers)!=0)
+    {
+         circ_buff_shard_destroy(sh);
+         return CIRC_BUFF_MALLOC_FAIL;
+    }
+    memset(sh->rings, 0, sizeof(circ_buff_shard_ring)*shards);
+    memset(sh->consumers, 0, sizeof(circ_buff_shard_consumer)*consumers);
+
+    sh->total_size=capacity;
+    sh->mask=capacity-1;
+    sh->shards=shards;
+    sh->consumer_count=consumers;
+
+    *shard_pointer=sh;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_shard_destroy(circ_buff_shard_ptr shard_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  De-allocates the storage, the rings, the consumer states and
+ *               the structure.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_destroy(circ_buff_shard_ptr shard_pointer)
+{
+    /*basic pointer check*/
+    if(shard_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    free((void*)shard_pointer->base);
+    free(shard_pointer->rings);
+    free(shard_pointer->consumers);
+    free(shard_pointer);
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_shard_write_n(circ_buff_shard_ptr shard_pointer, uint32_t shard,
+ *                                       const uint32_t* data, uint32_t count,
+ *                                       uint32_t* written)
+ * -----------------------------------------------------------------------------
+ * Description:  The producer only reads the shared head when its cached copy
+ *               says there is not enough room, then fills the slots and
+ *               publishes them with one release store of tail.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_FULL or
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_write_n(circ_buff_shard_ptr shard_pointer, uint32_t shard, const uint32_t* data,
+                                       uint32_t count, uint32_t* written)
+{
+    /*basic pointer and shard check*/
+    if(shard_pointer==NULL||written==NULL||(data==NULL&&count>0))
+         return CIRC_BUFF_NULL_PTR;
+    if(shard>=shard_pointer->shards)
+         return CIRC_BUFF_BAD_DATA;
+
+    circ_buff_shard_ptr sh=shard_pointer;
+    circ_buff_shard_ring* ring=&sh->rings[shard];
+    _Atomic uint32_t* base=sh->base+(size_t)shard*sh->total_size;
+    uint32_t tail=atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t index, room=sh->total_size-(tail-ring->head_cache);
+
+    if(room<count)
+    {
+         ring->head_cache=atomic_load_explicit(&ring->head, memory_order_acquire);
+         room=sh->total_size-(tail-ring->head_cache);
+    }
+    if(room>count)
+         room=count;
+
+    for(index=0; index<room; index++)
+         atomic_store_explicit(&base[(tail+index)&sh->mask], data[index], memory_order_relaxed);
+    if(room>0)
+         atomic_store_explicit(&ring->tail, tail+room, memory_order_release);
+
+    *written=room;
+    return room==count ? CIRC_BUFF_SUCCESS : CIRC_BUFF_FULL;
+}
+
+
+/*
+ * Function:     circ_buff_shard_write(circ_buff_shard_ptr shard_pointer, uint32_t shard,
+ *                                     uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  circ_buff_shard_write_n for one element.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_FULL or
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_write(circ_buff_shard_ptr shard_pointer, uint32_t shard, uint32_t data)
+{
+    uint32_t written;
+
+    return circ_buff_shard_write_n(shard_pointer, shard, &data, 1, &written);
+}
+
+
+/*
+ * Function:     circ_buff_shard_steal(circ_buff_shard_ptr shard_pointer, uint32_t consumer,
+ *                                     uint32_t* data, uint32_t count, uint32_t* stolen)
+ * -----------------------------------------------------------------------------
+ * Description:  Picks the fullest other shard and takes up to half of it. If
+ *               that shard was drained in the meantime, picks again.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_EMPTY or
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_steal(circ_buff_shard_ptr shard_pointer, uint32_t consumer, uint32_t* data,
+                                     uint32_t count, uint32_t* stolen)
+{
+    /*basic pointer and consumer check*/
+    if(shard_pointer==NULL||stolen==NULL||(data==NULL&&count>0))
+         return CIRC_BUFF_NULL_PTR;
+    if(consumer>=shard_pointer->consumer_count)
+         return CIRC_BUFF_BAD_DATA;
+
+    uint32_t victim, taken=0;
+    while(count>0&&taken==0)
+    {
+         victim=circ_buff_shard_victim(shard_pointer, consumer);
+         if(victim==shard_pointer->shards)
+              break;
+         taken=circ_buff_shard_take(shard_pointer, victim, data, count, 1);
+    }
+
+    shard_pointer->consumers[consumer].stolen+=taken;
+    *stolen=taken;
+    return taken>0 ? CIRC_BUFF_SUCCESS : CIRC_BUFF_EMPTY;
+}
+
+
+/*
+ * Function:     circ_buff_shard_read_n(circ_buff_shard_ptr shard_pointer, uint32_t consumer,
+ *                                      uint32_t* data, uint32_t count, uint32_t* read)
+ * -----------------------------------------------------------------------------
+ * Description:  Visits the consumer's home shards once, starting from the one
+ *               after the one it started from last time, and fills 'data'
+ *               from them. Steals only if they gave nothing.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_EMPTY or
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_read_n(circ_buff_shard_ptr shard_pointer, uint32_t consumer, uint32_t* data,
+                                      uint32_t count, uint32_t* read)
+{
+    /*basic pointer and consumer check*/
+    if(shard_pointer==NULL||read==NULL||(data==NULL&&count>0))
+         return CIRC_BUFF_NULL_PTR;
+    if(consumer>=shard_pointer->consumer_count)
+         return CIRC_BUFF_BAD_DATA;
+
+    circ_buff_shard_ptr sh=shard_pointer;
+    circ_buff_shard_consumer* self=&sh->consumers[consumer];
+    uint32_t homes=0, visited, taken=0;
+
+    /*home shards are consumer, consumer+consumer_count, ...*/
+    if(consumer<sh->shards)
+         homes=(sh->shards-consumer-1)/sh->consumer_count+1;
+
+    for(visited=0; visited<homes&&taken<count; visited++)
+    {
+         uint32_t home=self->next;
+         taken+=circ_buff_shard_take(sh, consumer+home*sh->consumer_count, data+taken, count-taken, 0);
+         self->next=(home+1)%homes;
+    }
+    if(taken==0&&count>0)
+         return circ_buff_shard_steal(sh, consumer, data, count, read);
+
+    *read=taken;
+    return taken>0 ? CIRC_BUFF_SUCCESS : CIRC_BUFF_EMPTY;
+}
+
+
+/*
+ * Function:     circ_buff_shard_read(circ_buff_shard_ptr shard_pointer, uint32_t consumer,
+ *                                    uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  circ_buff_shard_read_n for one element.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_EMPTY or
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_read(circ_buff_shard_ptr shard_pointer, uint32_t consumer, uint32_t* data)
+{
+    uint32_t read;
+
+    if(data==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    return circ_buff_shard_read_n(shard_pointer, consumer, data, 1, &read);
+}
+
+
+/*
+ * Function:     circ_buff_shard_stolen(circ_buff_shard_ptr shard_pointer, uint32_t consumer,
+ *                                      uint64_t* stolen)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the consumer's steal counter.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_stolen(circ_buff_shard_ptr shard_pointer, uint32_t consumer, uint64_t* stolen)
+{
+    /*basic pointer and consumer check*/
+    if(shard_pointer==NULL||stolen==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(consumer>=shard_pointer->consumer_count)
+         return CIRC_BUFF_BAD_DATA;
+
+    *stolen=shard_pointer->consumers[consumer].stolen;
+    return CIRC_BUFF_SUCCESS;
+}
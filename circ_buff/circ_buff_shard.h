@@ -0,0 +1,244 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_shard.h
+ *
+ * Description:  Declares a sharded variant of the circular buffer defined in
+ *               circ_buff.h: one ring per producer, so that producers never
+ *               share a cache line, and a pool of consumers that each drain
+ *               their own home shards first. A consumer whose home shards
+ *               are empty steals a batch from the fullest shard of another
+ *               consumer.
+ *
+ *               Elements of one shard are handed out in the order they were
+ *               written; there is no order between shards.
+ *
+ * Usage:        circ_buff_shard_init(&sh, producers, 4096, consumers);
+ *               circ_buff_shard_write(sh, producer, sample);    //producer 'producer' only
+ *               circ_buff_shard_read(sh, consumer, &sample);    //consumer 'consumer' only
+ *
+ * */
+
+#ifndef _CIRC_BUFF_SHARD_H
+#define _CIRC_BUFF_SHARD_H
+#include<stdint.h>
+#include<stdatomic.h>
+#include "circ_buff.h"
+
+/*largest capacity of one shard; positions are compared as 32 bit differences*/
+#define CIRC_BUFF_SHARD_MAX_SIZE (1u<<30)
+
+/*largest number of shards, and of consumers, one buffer can have*/
+#define CIRC_BUFF_SHARD_MAX_SHARDS 1024
+
+
+/*
+ * Structure:    circ_buff_shard_ring
+ * -----------------------------------------------------------------------------
+ * Description:  The indices of one shard. 'tail' is only written by the
+ *               shard's producer, which also keeps a private copy of head in
+ *               'head_cache'. 'head' is advanced with a CAS by whichever
+ *               consumer takes the next batch, so the home consumer and a
+ *               thief never hand out the same element. Each sits on its own
+ *               cache line.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_shard_ring
+{
+    /*the producer's line*/
+    _Alignas(CIRC_BUFF_CACHE_LINE) _Atomic uint32_t tail;
+    uint32_t  head_cache;
+
+    /*the consumers' line*/
+    _Alignas(CIRC_BUFF_CACHE_LINE) _Atomic uint32_t head;
+}circ_buff_shard_ring;
+
+
+/*
+ * Structure:    circ_buff_shard_consumer
+ * -----------------------------------------------------------------------------
+ * Description:  The private state of one consumer, on its own cache line.
+ *               'next' is the home shard it looks at first, so that home
+ *               shards are drained round robin. 'stolen' counts elements it
+ *               took from other consumers' shards.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_shard_consumer
+{
+    _Alignas(CIRC_BUFF_CACHE_LINE) uint32_t next;
+    uint64_t  stolen;
+}circ_buff_shard_consumer;
+
+
+/*
+ * Structure:    circ_buff_shard
+ * -----------------------------------------------------------------------------
+ * Description:  'shards' rings of total_size elements each, stored back to
+ *               back in one array. Shard s belongs to consumer
+ *               s%consumer_count; a consumer numbered shards or higher has
+ *               no home shards and only steals.
+ *
+ *               A consumer copies a batch out of the shard and then claims it
+ *               by moving head with a CAS. If another consumer moved head
+ *               first the copy is thrown away and taken again. The producer
+ *               only refills a slot once head has passed it, so a batch that
+ *               wins the CAS was copied intact. Slots are atomics only so
+ *               that the thrown away copies are a race the language allows;
+ *               the loads and stores are relaxed and compile to plain moves.
+ *
+ *               The capacity of each shard is rounded up to a power of two so
+ *               that a position maps to its slot with a mask.
+ *
+ * Usage:        Do not access the members directly; use the functions below.
+ * ----------------------------------------------------------------------------
+ */
+
+/*typedef a circ_buff_shard ptr type so that "*" does not have to be used always*/
+typedef struct circ_buff_shard *circ_buff_shard_ptr;
+
+typedef struct circ_buff_shard
+{
+    /*read-only after init*/
+    _Atomic uint32_t *base;
+    circ_buff_shard_ring *rings;
+    circ_buff_shard_consumer *consumers;
+    uint32_t  total_size;
+    uint32_t  mask;
+    uint32_t  shards;
+    uint32_t  consumer_count;
+}circ_buff_shard;
+
+
+/*
+ * Function:     circ_buff_shard_init(circ_buff_shard_ptr* shard_pointer, uint32_t shards,
+ *                                    int32_t size, uint32_t consumers)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates 'shards' rings, each holding at least 'size'
+ *               uint32_t elements rounded up to a power of two, shared by
+ *               'consumers' consumers.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: The size is less than or equal to zero or
+ *               larger than CIRC_BUFF_SHARD_MAX_SIZE, or shards or consumers
+ *               is zero or larger than CIRC_BUFF_SHARD_MAX_SHARDS.
+ *
+ *               CIRC_BUFF_MALLOC_FAIL: An allocation fails. Nothing is leaked.
+ *
+ *               CIRC_BUFF_SUCCESS: The funcion returns successfully.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_init(circ_buff_shard_ptr* shard_pointer, uint32_t shards, int32_t size, uint32_t consumers);
+
+/*
+ * Function:     circ_buff_shard_destroy(circ_buff_shard_ptr shard_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  De-allocates the storage, the rings and the structure. No
+ *               thread may use the buffer during or after this call.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_destroy(circ_buff_shard_ptr shard_pointer);
+
+/*
+ * Function:     circ_buff_shard_write(circ_buff_shard_ptr shard_pointer, uint32_t shard,
+ *                                     uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes data to the given shard. Each shard must be written by
+ *               one thread at a time.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: shard is out of range.
+ *
+ *               CIRC_BUFF_FULL: The shard is full; nothing is written.
+ *
+ *               CIRC_BUFF_SUCCESS: The data is written.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_write(circ_buff_shard_ptr shard_pointer, uint32_t shard, uint32_t data);
+
+/*
+ * Function:     circ_buff_shard_write_n(circ_buff_shard_ptr shard_pointer, uint32_t shard,
+ *                                       const uint32_t* data, uint32_t count,
+ *                                       uint32_t* written)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes as many of the 'count' elements as the shard has room
+ *               for and publishes them at once.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_FULL (fewer
+ *               than count written) or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_write_n(circ_buff_shard_ptr shard_pointer, uint32_t shard, const uint32_t* data,
+                                       uint32_t count, uint32_t* written);
+
+/*
+ * Function:     circ_buff_shard_read(circ_buff_shard_ptr shard_pointer, uint32_t consumer,
+ *                                    uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Reads one element for the given consumer: from its home
+ *               shards if any of them holds data, otherwise stolen from the
+ *               fullest other shard. Each consumer number must be used by
+ *               one thread at a time.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: A pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: consumer is out of range.
+ *
+ *               CIRC_BUFF_EMPTY: Every shard is empty.
+ *
+ *               CIRC_BUFF_SUCCESS: The data is read.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_read(circ_buff_shard_ptr shard_pointer, uint32_t consumer, uint32_t* data);
+
+/*
+ * Function:     circ_buff_shard_read_n(circ_buff_shard_ptr shard_pointer, uint32_t consumer,
+ *                                      uint32_t* data, uint32_t count, uint32_t* read)
+ * -----------------------------------------------------------------------------
+ * Description:  Reads up to 'count' elements for the given consumer, taking
+ *               from its home shards in turn. Only when they are all empty
+ *               does it steal, as circ_buff_shard_steal does.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_EMPTY
+ *               (nothing read) or CIRC_BUFF_SUCCESS with *read set.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_read_n(circ_buff_shard_ptr shard_pointer, uint32_t consumer, uint32_t* data,
+                                      uint32_t count, uint32_t* read);
+
+/*
+ * Function:     circ_buff_shard_steal(circ_buff_shard_ptr shard_pointer, uint32_t consumer,
+ *                                     uint32_t* data, uint32_t count, uint32_t* stolen)
+ * -----------------------------------------------------------------------------
+ * Description:  Takes a batch from the fullest shard that is not one of the
+ *               consumer's home shards: up to 'count' elements, and never
+ *               more than half of what the shard holds (rounded up), so the
+ *               owner is not left idle in turn. The batch is in the shard's
+ *               order.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_EMPTY
+ *               (every other shard is empty) or CIRC_BUFF_SUCCESS with
+ *               *stolen set.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_steal(circ_buff_shard_ptr shard_pointer, uint32_t consumer, uint32_t* data,
+                                     uint32_t count, uint32_t* stolen);
+
+/*
+ * Function:     circ_buff_shard_stolen(circ_buff_shard_ptr shard_pointer, uint32_t consumer,
+ *                                      uint64_t* stolen)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns how many elements the consumer has stolen so far.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_shard_stolen(circ_buff_shard_ptr shard_pointer, uint32_t consumer, uint64_t* stolen);
+
+#endif
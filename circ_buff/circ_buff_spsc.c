@@ -0,0 +1,758 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_spsc.c
+ *
+ * Description:  Contains a lock-free single-producer/single-consumer
+ *               circular buffer, on the heap or in shared memory. See 
+ *               circ_buff_spsc.h for the layout.
+ *
+ * */
+
+
+#include "circ_buff_spsc.h"
+#include<stdint.h>
+#include<stdlib.h>
+#include<stdatomic.h>
+#include<string.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<limits.h>
+#include<time.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<sys/syscall.h>
+#include<linux/futex.h>
+
+
+/*
+ * Function:     circ_buff_spsc_relax(void)
+ * -----------------------------------------------------------------------------
+ * Description:  Tells the cpu that this is a spin loop.
+ * ----------------------------------------------------------------------------
+ */
+static inline void circ_buff_spsc_relax(void)
+{
+#if defined(__x86_64__)||defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/*
+ * Function:     circ_buff_spsc_futex_wait(_Atomic uint32_t* word, uint32_t expected,
+ *                                         const struct timespec* deadline)
+ * -----------------------------------------------------------------------------
+ * Description:  Sleeps while *word==expected, until woken or until the
+ *               absolute CLOCK_MONOTONIC deadline (NULL for none). The futex is
+ *               not private so that it works in shared memory.
+ *
+ * Returns:      0 when woken or *word changed, ETIMEDOUT when the deadline
+ *               passed.
+ * ----------------------------------------------------------------------------
+ */
+static int circ_buff_spsc_futex_wait(_Atomic uint32_t* word, uint32_t expected, const struct timespec* deadline)
+{
+    if(syscall(SYS_futex, word, FUTEX_WAIT_BITSET, expected, deadline, NULL, FUTEX_BITSET_MATCH_ANY)!=0
+       &&errno==ETIMEDOUT)
+         return ETIMEDOUT;
+    return 0;
+}
+
+/*
+ * Function:     circ_buff_spsc_notify(_Atomic uint32_t* index, _Atomic uint32_t* waiting)
+ * -----------------------------------------------------------------------------
+ * Description:  Called right after a side publishes 'index'. Wakes the other
+ *               side only if it has said it is parked on 'index'. The fence
+ *               pairs with the one in circ_buff_spsc_park: either this side
+ *               sees the flag, or the parked side sees the new index.
+ * ----------------------------------------------------------------------------
+ */
+static inline void circ_buff_spsc_notify(_Atomic uint32_t* index, _Atomic uint32_t* waiting)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_load_explicit(waiting, memory_order_relaxed))
+         syscall(SYS_futex, index, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/*
+ * Function:     circ_buff_spsc_park(_Atomic uint32_t* index, uint32_t blocked,
+ *                                   _Atomic uint32_t* waiting,
+ *                                   const struct timespec* deadline)
+ * -----------------------------------------------------------------------------
+ * Description:  Sleeps until the other side moves 'index' away from 'blocked'
+ *               (the value that made this side full/empty).
+ *
+ * Returns:      0 or ETIMEDOUT.
+ * ----------------------------------------------------------------------------
+ */
+static int circ_buff_spsc_park(_Atomic uint32_t* index, uint32_t blocked, _Atomic uint32_t* waiting,
+                               const struct timespec* deadline)
+{
+    int rc=0;
+
+    atomic_store_explicit(waiting, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    /*the futex re-checks the value, so a publish after this load is not lost*/
+    if(atomic_load_explicit(index, memory_order_relaxed)==blocked)
+         rc=circ_buff_spsc_futex_wait(index, blocked, deadline);
+
+    atomic_store_explicit(waiting, 0, memory_order_relaxed);
+    return rc;
+}
+
+/*
+ * Function:     circ_buff_spsc_deadline(struct timespec* deadline, int32_t timeout_ms)
+ * -----------------------------------------------------------------------------
+ * Description:  Converts a relative timeout to an absolute CLOCK_MONOTONIC
+ *               time. Returns NULL for a negative timeout, i.e. no deadline.
+ * ----------------------------------------------------------------------------
+ */
+static const struct timespec* circ_buff_spsc_deadline(struct timespec* deadline, int32_t timeout_ms)
+{
+    if(timeout_ms<0)
+         return NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec+=timeout_ms/1000;
+    deadline->tv_nsec+=(long)(timeout_ms%1000)*1000000L;
+    if(deadline->tv_nsec>=1000000000L)
+    {
+         deadline->tv_sec++;
+         deadline->tv_nsec-=1000000000L;
+    }
+    return deadline;
+}
+
+/*
+ * Function:     circ_buff_spsc_adapt(uint32_t* spin, int spun)
+ * -----------------------------------------------------------------------------
+ * Description:  Doubles the spin limit when spinning was enough and halves it
+ *               when the side had to park anyway.
+ * ----------------------------------------------------------------------------
+ */
+static inline void circ_buff_spsc_adapt(uint32_t* spin, int spun)
+{
+    if(spun&&*spin<CIRC_BUFF_SPSC_SPIN_MAX)
+         *spin<<=1;
+    else if(!spun&&*spin>CIRC_BUFF_SPSC_SPIN_MIN)
+         *spin>>=1;
+}
+
+
+/*
+ * Function:     circ_buff_spsc_bytes(uint32_t size)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the size of the block holding the structure and the
+ *               storage for 'size' elements.
+ * ----------------------------------------------------------------------------
+ */
+static size_t circ_buff_spsc_bytes(uint32_t size)
+{
+    size_t bytes=sizeof(circ_buff_spsc)+sizeof(uint32_t)*((size_t)size+1);
+#ifdef CIRC_BUFF_STATS
+    /*8 byte aligned stamps after the storage*/
+    bytes=((bytes+7)&~(size_t)7)+sizeof(uint64_t)*((size_t)size+1);
+#endif
+    return bytes;
+}
+
+#ifdef CIRC_BUFF_STATS
+/*write times of the slots in the caller's address space*/
+static inline uint64_t* circ_buff_spsc_stamps(circ_buff_spsc_ptr spsc)
+{
+    return (uint64_t*)((uint8_t*)spsc+spsc->stamps_offset);
+}
+#endif
+
+/*
+ * Function:     circ_buff_spsc_format(circ_buff_spsc_ptr spsc, uint32_t size,
+ *                                     size_t bytes)
+ * -----------------------------------------------------------------------------
+ * Description:  Initialises an spsc buffer in a block of 'bytes' bytes. The
+ *               magic number is published last so that an attacher never sees
+ *               a half initialised buffer.
+ * ----------------------------------------------------------------------------
+ */
+static void circ_buff_spsc_format(circ_buff_spsc_ptr spsc, uint32_t size, size_t bytes)
+{
+    /*one extra slot is kept empty to tell full from empty*/
+    spsc->slots=size+1;
+    spsc->total_size=size;
+    spsc->base_offset=sizeof(circ_buff_spsc);
+    spsc->segment_bytes=bytes;
+#ifdef CIRC_BUFF_STATS
+    spsc->stamps_offset=(sizeof(circ_buff_spsc)+sizeof(uint32_t)*(size_t)spsc->slots+7)&~(size_t)7;
+    memset(&spsc->producer_stats, 0, sizeof(circ_buff_stats));
+    memset(&spsc->consumer_stats, 0, sizeof(circ_buff_stats));
+#endif
+
+    /*both sides start at slot zero*/
+    atomic_init(&spsc->tail, 0);
+    atomic_init(&spsc->head, 0);
+    spsc->head_cache=0;
+    spsc->tail_cache=0;
+
+    /*nobody is parked; start in the middle of the spin range*/
+    spsc->producer_spin=CIRC_BUFF_SPSC_SPIN_MIN*16;
+    spsc->consumer_spin=CIRC_BUFF_SPSC_SPIN_MIN*16;
+    atomic_init(&spsc->producer_waiting, 0);
+    atomic_init(&spsc->consumer_waiting, 0);
+
+    atomic_store_explicit(&spsc->magic, CIRC_BUFF_SPSC_MAGIC, memory_order_release);
+}
+
+
+/*
+ * Function:     circ_buff_spsc_init(circ_buff_spsc_ptr* spsc_pointer, int32_t size)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates a cache line aligned spsc buffer able to hold 'size'
+ *               uint32_t elements and initialises head and tail to zero.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_init(circ_buff_spsc_ptr* spsc_pointer, int32_t size)
+{
+    /*basic pointer and size check*/
+    if(spsc_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(size<=0||(uint32_t)size>CIRC_BUFF_MAX_SIZE)
+         return CIRC_BUFF_BAD_DATA;
+
+    /*the block must be aligned so that head and tail get a line each*/
+    circ_buff_spsc_ptr spsc=NULL;
+    size_t bytes=circ_buff_spsc_bytes((uint32_t)size);
+    if(posix_memalign((void**)&spsc, CIRC_BUFF_CACHE_LINE, bytes)!=0)
+         return CIRC_BUFF_MALLOC_FAIL;
+
+    circ_buff_spsc_format(spsc, (uint32_t)size, bytes);
+
+    *spsc_pointer=spsc;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_spsc_destroy(circ_buff_spsc_ptr spsc_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  De-allocates the storage and the structure of the spsc buffer.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_destroy(circ_buff_spsc_ptr spsc_pointer)
+{
+    /*basic pointer check*/
+    if(spsc_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    /*structure and storage are one block*/
+    atomic_store(&spsc_pointer->magic, 0);
+    free(spsc_pointer);
+
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_spsc_push(circ_buff_spsc_ptr spsc_pointer, uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Producer side. The tail is only ever written by this thread,
+ *               so it is read relaxed. The head is only re-read (acquire) when
+ *               the cached copy says the buffer is full. A full buffer is not
+ *               counted here, so that the blocking calls can retry freely.
+ *
+ * Returns:      CIRC_BUFF_FULL or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+static inline circ_buff_code circ_buff_spsc_push(circ_buff_spsc_ptr spsc_pointer, uint32_t data)
+{
+    uint32_t tail=atomic_load_explicit(&spsc_pointer->tail, memory_order_relaxed);
+
+    /*find the slot after tail circularly*/
+    uint32_t next=tail+1;
+    if(next==spsc_pointer->slots)
+         next=0;
+
+    /*only touch the consumer's cache line when the cached head says full*/
+    if(next==spsc_pointer->head_cache)
+    {
+         spsc_pointer->head_cache=atomic_load_explicit(&spsc_pointer->head, memory_order_acquire);
+         if(next==spsc_pointer->head_cache)
+              return CIRC_BUFF_FULL;
+    }
+
+    /*write the element, then publish it to the consumer*/
+    circ_buff_spsc_base(spsc_pointer)[tail]=data;
+#ifdef CIRC_BUFF_STATS
+    circ_buff_spsc_stamps(spsc_pointer)[tail]=circ_buff_stats_now();
+    if((++spsc_pointer->producer_stats.writes&(CIRC_BUFF_STATS_SAMPLE-1))==0)
+    {
+         /*an occasional look at the real head; the cached one may be stale*/
+         uint32_t head=atomic_load_explicit(&spsc_pointer->head, memory_order_relaxed);
+         uint32_t occupied=next>=head ? next-head : next+spsc_pointer->slots-head;
+         circ_buff_stats_high_water(&spsc_pointer->producer_stats, occupied);
+    }
+#endif
+    atomic_store_explicit(&spsc_pointer->tail, next, memory_order_release);
+    circ_buff_spsc_notify(&spsc_pointer->tail, &spsc_pointer->consumer_waiting);
+
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_spsc_pop(circ_buff_spsc_ptr spsc_pointer, uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Consumer side; the mirror image of circ_buff_spsc_push.
+ *
+ * Returns:      CIRC_BUFF_EMPTY or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+static inline circ_buff_code circ_buff_spsc_pop(circ_buff_spsc_ptr spsc_pointer, uint32_t* data)
+{
+    uint32_t head=atomic_load_explicit(&spsc_pointer->head, memory_order_relaxed);
+
+    /*only touch the producer's cache line when the cached tail says empty*/
+    if(head==spsc_pointer->tail_cache)
+    {
+         spsc_pointer->tail_cache=atomic_load_explicit(&spsc_pointer->tail, memory_order_acquire);
+         if(head==spsc_pointer->tail_cache)
+              return CIRC_BUFF_EMPTY;
+    }
+
+    /*read the element, then hand the slot back to the producer*/
+    *data=circ_buff_spsc_base(spsc_pointer)[head];
+#ifdef CIRC_BUFF_STATS
+    circ_buff_stats_record(&spsc_pointer->consumer_stats,
+                           circ_buff_stats_now()-circ_buff_spsc_stamps(spsc_pointer)[head]);
+    spsc_pointer->consumer_stats.reads++;
+#endif
+
+    head++;
+    if(head==spsc_pointer->slots)
+         head=0;
+    atomic_store_explicit(&spsc_pointer->head, head, memory_order_release);
+    circ_buff_spsc_notify(&spsc_pointer->head, &spsc_pointer->producer_waiting);
+
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_spsc_write(circ_buff_spsc_ptr spsc_pointer, uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Producer side; see circ_buff_spsc_push.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_FULL or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_write(circ_buff_spsc_ptr spsc_pointer, uint32_t data)
+{
+    /*basic pointer check*/
+    if(spsc_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    circ_buff_code rc=circ_buff_spsc_push(spsc_pointer, data);
+    CIRC_BUFF_STAT(if(rc==CIRC_BUFF_FULL) spsc_pointer->producer_stats.full++);
+    return rc;
+}
+
+
+/*
+ * Function:     circ_buff_spsc_read(circ_buff_spsc_ptr spsc_pointer, uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Consumer side; see circ_buff_spsc_pop.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_read(circ_buff_spsc_ptr spsc_pointer, uint32_t* data)
+{
+    /*basic pointer check*/
+    if(spsc_pointer==NULL||data==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    circ_buff_code rc=circ_buff_spsc_pop(spsc_pointer, data);
+    CIRC_BUFF_STAT(if(rc==CIRC_BUFF_EMPTY) spsc_pointer->consumer_stats.empty++);
+    return rc;
+}
+
+
+/*
+ * Function:     circ_buff_spsc_read_n(circ_buff_spsc_ptr spsc_pointer, uint32_t* data,
+ *                                     uint32_t count, uint32_t* read)
+ * -----------------------------------------------------------------------------
+ * Description:  Consumer side. Refreshes the cached tail once, copies what is
+ *               there in at most two pieces (the second after the wrap) and 
+ *               hands all the slots back with one release store.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_read_n(circ_buff_spsc_ptr spsc_pointer, uint32_t* data, uint32_t count, uint32_t* read)
+{
+    /*basic pointer check*/
+    if(spsc_pointer==NULL||read==NULL||(data==NULL&&count>0))
+         return CIRC_BUFF_NULL_PTR;
+
+    uint32_t head=atomic_load_explicit(&spsc_pointer->head, memory_order_relaxed);
+    uint32_t slots=spsc_pointer->slots;
+
+    spsc_pointer->tail_cache=atomic_load_explicit(&spsc_pointer->tail, memory_order_acquire);
+    uint32_t tail=spsc_pointer->tail_cache;
+    uint32_t occupied=tail>=head ? tail-head : slots-head+tail;
+    if(occupied==0)
+    {
+         *read=0;
+         CIRC_BUFF_STAT(spsc_pointer->consumer_stats.empty++);
+         return CIRC_BUFF_EMPTY;
+    }
+    if(count>occupied)
+         count=occupied;
+
+    /*up to the end of the storage, then from slot zero*/
+    uint32_t first=slots-head<count ? slots-head : count;
+    memcpy(data, circ_buff_spsc_base(spsc_pointer)+head, sizeof(uint32_t)*first);
+    memcpy(data+first, circ_buff_spsc_base(spsc_pointer), sizeof(uint32_t)*(count-first));
+#ifdef CIRC_BUFF_STATS
+    uint64_t now=circ_buff_stats_now();
+    uint32_t index;
+    for(index=0; index<count; index++)
+         circ_buff_stats_record(&spsc_pointer->consumer_stats, now-circ_buff_spsc_stamps(spsc_pointer)[(head+index)%slots]);
+    spsc_pointer->consumer_stats.reads+=count;
+#endif
+
+    head+=count;
+    if(head>=slots)
+         head-=slots;
+    atomic_store_explicit(&spsc_pointer->head, head, memory_order_release);
+    circ_buff_spsc_notify(&spsc_pointer->head, &spsc_pointer->producer_waiting);
+
+    *read=count;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_spsc_size(circ_buff_spsc_ptr spsc_pointer, uint32_t* size)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns a snapshot of the number of elements held in *size.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_size(circ_buff_spsc_ptr spsc_pointer, uint32_t* size)
+{
+    /*basic pointer check*/
+    if(spsc_pointer==NULL||size==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    uint32_t head=atomic_load_explicit(&spsc_pointer->head, memory_order_acquire);
+    uint32_t tail=atomic_load_explicit(&spsc_pointer->tail, memory_order_acquire);
+
+    /*tail may have wrapped behind head*/
+    if(tail>=head)
+         *size=tail-head;
+    else
+         *size=spsc_pointer->slots-head+tail;
+
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_spsc_write_wait(circ_buff_spsc_ptr spsc_pointer,
+ *                                         uint32_t data, int32_t timeout_ms)
+ * -----------------------------------------------------------------------------
+ * Description:  Producer side. Tries, spins up to producer_spin times, then
+ *               parks on the head index until the consumer frees a slot.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_FULL or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_write_wait(circ_buff_spsc_ptr spsc_pointer, uint32_t data, int32_t timeout_ms)
+{
+    if(timeout_ms==0||spsc_pointer==NULL)
+         return circ_buff_spsc_write(spsc_pointer, data);
+    if(circ_buff_spsc_push(spsc_pointer, data)==CIRC_BUFF_SUCCESS)
+         return CIRC_BUFF_SUCCESS;
+
+    struct timespec deadline_storage;
+    const struct timespec* deadline=circ_buff_spsc_deadline(&deadline_storage, timeout_ms);
+    uint32_t spin;
+
+    for(spin=0; spin<spsc_pointer->producer_spin; spin++)
+    {
+         circ_buff_spsc_relax();
+         if(circ_buff_spsc_push(spsc_pointer, data)==CIRC_BUFF_SUCCESS)
+         {
+              circ_buff_spsc_adapt(&spsc_pointer->producer_spin, 1);
+              return CIRC_BUFF_SUCCESS;
+         }
+    }
+    circ_buff_spsc_adapt(&spsc_pointer->producer_spin, 0);
+
+    while(1)
+    {
+         /*full means head is the slot after tail; sleep until it moves*/
+         uint32_t tail=atomic_load_explicit(&spsc_pointer->tail, memory_order_relaxed);
+         uint32_t blocked=(tail+1==spsc_pointer->slots) ? 0 : tail+1;
+         int timed_out=circ_buff_spsc_park(&spsc_pointer->head, blocked,
+                                           &spsc_pointer->producer_waiting, deadline);
+
+         if(circ_buff_spsc_push(spsc_pointer, data)==CIRC_BUFF_SUCCESS)
+              return CIRC_BUFF_SUCCESS;
+         if(timed_out)
+         {
+              CIRC_BUFF_STAT(spsc_pointer->producer_stats.full++);
+              return CIRC_BUFF_FULL;
+         }
+    }
+}
+
+
+/*
+ * Function:     circ_buff_spsc_read_wait(circ_buff_spsc_ptr spsc_pointer,
+ *                                        uint32_t* data, int32_t timeout_ms)
+ * -----------------------------------------------------------------------------
+ * Description:  Consumer side; the mirror image of circ_buff_spsc_write_wait,
+ *               parking on the tail index.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_read_wait(circ_buff_spsc_ptr spsc_pointer, uint32_t* data, int32_t timeout_ms)
+{
+    if(timeout_ms==0||spsc_pointer==NULL||data==NULL)
+         return circ_buff_spsc_read(spsc_pointer, data);
+    if(circ_buff_spsc_pop(spsc_pointer, data)==CIRC_BUFF_SUCCESS)
+         return CIRC_BUFF_SUCCESS;
+
+    struct timespec deadline_storage;
+    const struct timespec* deadline=circ_buff_spsc_deadline(&deadline_storage, timeout_ms);
+    uint32_t spin;
+
+    for(spin=0; spin<spsc_pointer->consumer_spin; spin++)
+    {
+         circ_buff_spsc_relax();
+         if(circ_buff_spsc_pop(spsc_pointer, data)==CIRC_BUFF_SUCCESS)
+         {
+              circ_buff_spsc_adapt(&spsc_pointer->consumer_spin, 1);
+              return CIRC_BUFF_SUCCESS;
+         }
+    }
+    circ_buff_spsc_adapt(&spsc_pointer->consumer_spin, 0);
+
+    while(1)
+    {
+         /*empty means tail equals head; sleep until it moves*/
+         uint32_t head=atomic_load_explicit(&spsc_pointer->head, memory_order_relaxed);
+         int timed_out=circ_buff_spsc_park(&spsc_pointer->tail, head,
+                                           &spsc_pointer->consumer_waiting, deadline);
+
+         if(circ_buff_spsc_pop(spsc_pointer, data)==CIRC_BUFF_SUCCESS)
+              return CIRC_BUFF_SUCCESS;
+         if(timed_out)
+         {
+              CIRC_BUFF_STAT(spsc_pointer->consumer_stats.empty++);
+              return CIRC_BUFF_EMPTY;
+         }
+    }
+}
+
+
+#ifdef CIRC_BUFF_STATS
+/*
+ * Function:     circ_buff_spsc_stats_get(circ_buff_spsc_ptr spsc_pointer,
+ *                                        circ_buff_stats* stats)
+ * -----------------------------------------------------------------------------
+ * Description:  Merges the producer's and the consumer's counters.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_stats_get(circ_buff_spsc_ptr spsc_pointer, circ_buff_stats* stats)
+{
+    /*basic pointer check*/
+    if(spsc_pointer==NULL||stats==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    *stats=spsc_pointer->producer_stats;
+    circ_buff_stats_merge(stats, &spsc_pointer->consumer_stats);
+    return CIRC_BUFF_SUCCESS;
+}
+#endif
+
+
+/*
+ * Function:     circ_buff_spsc_create_fd(circ_buff_spsc_ptr* spsc_pointer, int fd,
+ *                                        int32_t size)
+ * -----------------------------------------------------------------------------
+ * Description:  Sizes the shared memory object, maps it and formats an spsc
+ *               buffer in it.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_create_fd(circ_buff_spsc_ptr* spsc_pointer, int fd, int32_t size)
+{
+    /*basic pointer and size check*/
+    if(spsc_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(fd<0||size<=0||(uint32_t)size>CIRC_BUFF_MAX_SIZE)
+         return CIRC_BUFF_BAD_DATA;
+
+    size_t bytes=circ_buff_spsc_bytes((uint32_t)size);
+    if(ftruncate(fd, bytes)!=0)
+         return CIRC_BUFF_MALLOC_FAIL;
+
+    /*mmap returns page aligned memory, which is cache line aligned too*/
+    void* segment=mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if(segment==MAP_FAILED)
+         return CIRC_BUFF_MALLOC_FAIL;
+
+    circ_buff_spsc_format((circ_buff_spsc_ptr)segment, (uint32_t)size, bytes);
+
+    *spsc_pointer=(circ_buff_spsc_ptr)segment;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_spsc_attach_fd(circ_buff_spsc_ptr* spsc_pointer, int fd)
+ * -----------------------------------------------------------------------------
+ * Description:  Maps an existing spsc buffer and checks that it is one: the
+ *               magic number must be set and the recorded geometry must fit
+ *               in the object.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_attach_fd(circ_buff_spsc_ptr* spsc_pointer, int fd)
+{
+    /*basic pointer check*/
+    if(spsc_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    struct stat st;
+    if(fd<0||fstat(fd, &st)!=0||(size_t)st.st_size<sizeof(circ_buff_spsc))
+         return CIRC_BUFF_BAD_DATA;
+
+    void* segment=mmap(NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    if(segment==MAP_FAILED)
+         return CIRC_BUFF_MALLOC_FAIL;
+
+    /*the magic is published last, so everything else is valid once it is seen*/
+    circ_buff_spsc_ptr spsc=(circ_buff_spsc_ptr)segment;
+    if(atomic_load_explicit(&spsc->magic, memory_order_acquire)!=CIRC_BUFF_SPSC_MAGIC
+       ||spsc->segment_bytes!=(uint64_t)st.st_size
+       ||spsc->segment_bytes!=circ_buff_spsc_bytes(spsc->total_size))
+    {
+         munmap(segment, st.st_size);
+         return CIRC_BUFF_BAD_DATA;
+    }
+
+    *spsc_pointer=spsc;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_spsc_shm_create(circ_buff_spsc_ptr* spsc_pointer,
+ *                                         const char* name, int32_t size)
+ * -----------------------------------------------------------------------------
+ * Description:  shm_open with O_EXCL, then circ_buff_spsc_create_fd. The name
+ *               is removed again if the buffer can not be created.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL,
+ *               CIRC_BUFF_FILE_OPEN_FAILED or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_shm_create(circ_buff_spsc_ptr* spsc_pointer, const char* name, int32_t size)
+{
+    /*basic pointer check*/
+    if(spsc_pointer==NULL||name==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    int fd=shm_open(name, O_CREAT|O_EXCL|O_RDWR, 0600);
+    if(fd<0)
+         return CIRC_BUFF_FILE_OPEN_FAILED;
+
+    circ_buff_code rc=circ_buff_spsc_create_fd(spsc_pointer, fd, size);
+    close(fd);
+
+    if(rc!=CIRC_BUFF_SUCCESS)
+         shm_unlink(name);
+    return rc;
+}
+
+
+/*
+ * Function:     circ_buff_spsc_shm_attach(circ_buff_spsc_ptr* spsc_pointer,
+ *                                         const char* name)
+ * -----------------------------------------------------------------------------
+ * Description:  shm_open, then circ_buff_spsc_attach_fd.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL,
+ *               CIRC_BUFF_FILE_OPEN_FAILED or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_shm_attach(circ_buff_spsc_ptr* spsc_pointer, const char* name)
+{
+    /*basic pointer check*/
+    if(spsc_pointer==NULL||name==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    int fd=shm_open(name, O_RDWR, 0);
+    if(fd<0)
+         return CIRC_BUFF_FILE_OPEN_FAILED;
+
+    circ_buff_code rc=circ_buff_spsc_attach_fd(spsc_pointer, fd);
+    close(fd);
+    return rc;
+}
+
+
+/*
+ * Function:     circ_buff_spsc_detach(circ_buff_spsc_ptr spsc_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  Unmaps the shared memory spsc buffer from this process.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_detach(circ_buff_spsc_ptr spsc_pointer)
+{
+    /*basic pointer check*/
+    if(spsc_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    munmap(spsc_pointer, spsc_pointer->segment_bytes);
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_spsc_shm_unlink(const char* name)
+ * -----------------------------------------------------------------------------
+ * Description:  Removes the name of a shared memory object.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_FILE_OPEN_FAILED or
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_shm_unlink(const char* name)
+{
+    if(name==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    return shm_unlink(name)==0 ? CIRC_BUFF_SUCCESS : CIRC_BUFF_FILE_OPEN_FAILED;
+}
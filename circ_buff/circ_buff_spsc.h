@@ -0,0 +1,362 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_spsc.h
+ *
+ * Description:  Declares a lock-free single-producer/single-consumer(spsc)
+ *               variant of the circular buffer defined in circ_buff.h. One
+ *               thread may write while another thread reads, without any
+ *               locks, as long as there is only ever one of each. The buffer
+ *               can also live in shared memory so that the producer and the
+ *               consumer are separate processes.
+ *
+ * */
+
+#ifndef _CIRC_BUFF_SPSC_H
+#define _CIRC_BUFF_SPSC_H
+#include<stdint.h>
+#include<stddef.h>
+#include<stdatomic.h>
+#include "circ_buff.h"
+
+/*written last by the creator; attach refuses a segment without it*/
+#define CIRC_BUFF_SPSC_MAGIC 0x43425332u
+
+/*bounds on how many times a blocking call retries before it parks*/
+#define CIRC_BUFF_SPSC_SPIN_MIN 16
+#define CIRC_BUFF_SPSC_SPIN_MAX 4096
+
+
+/*
+ * Structure:    circ_buff_spsc
+ * -----------------------------------------------------------------------------
+ * Description:  A circular buffer in which the producer owns only the tail
+ *               index and the consumer owns only the head index. Each side
+ *               publishes its index with a release store and reads the other
+ *               side's index with an acquire load, so there is no counter
+ *               that both sides modify.
+ *
+ *               The two indices live on separate cache lines so that the
+ *               producer and the consumer do not false-share. Each side also
+ *               keeps a private copy of the other side's index and only
+ *               re-reads the shared one when the copy says full/empty.
+ *
+ *               One slot is always kept empty to tell full from empty, so
+ *               'slots' is total_size+1.
+ *
+ *               The structure and its storage are one block: the storage
+ *               starts base_offset bytes after the structure. There are no
+ *               pointers inside, only offsets and indices, so the same block
+ *               works when mapped at a different address in each process.
+ *
+ *               A side that blocks in circ_buff_spsc_write_wait/read_wait
+ *               first spins, then sets its 'waiting' flag and sleeps on a
+ *               futex on the other side's index. The other side only makes
+ *               the wake syscall when that flag is set. Each side adapts its
+ *               own spin limit: it grows when spinning paid off and shrinks
+ *               when the side had to park anyway.
+ *
+ *               With CIRC_BUFF_STATS defined each side keeps its own counters
+ *               on its own lines (the producer: writes, full, high_water; the
+ *               consumer: reads, empty, residency), and the write times live
+ *               in a stamp array stamps_offset bytes into the block.
+ *
+ * Usage:        Do not access the members directly; use the functions below.
+ * ----------------------------------------------------------------------------
+ */
+
+/*typedef a circ_buff_spsc ptr type so that "*" does not have to be used always*/
+typedef struct circ_buff_spsc *circ_buff_spsc_ptr;
+
+typedef struct circ_buff_spsc
+{
+    /*read-only after init; shared by both sides*/
+    _Atomic uint32_t magic;
+    uint32_t  total_size;
+    uint32_t  slots;
+    uint64_t  base_offset;
+    uint64_t  segment_bytes;
+#ifdef CIRC_BUFF_STATS
+    uint64_t  stamps_offset;
+#endif
+
+    /*producer's cache line*/
+    _Alignas(CIRC_BUFF_CACHE_LINE) _Atomic uint32_t tail;
+    uint32_t  head_cache;
+    uint32_t  producer_spin;
+
+    /*consumer's cache line*/
+    _Alignas(CIRC_BUFF_CACHE_LINE) _Atomic uint32_t head;
+    uint32_t  tail_cache;
+    uint32_t  consumer_spin;
+
+    /*only written around a futex wait, so it stays shared in both caches*/
+    _Alignas(CIRC_BUFF_CACHE_LINE) _Atomic uint32_t producer_waiting;
+    _Atomic uint32_t consumer_waiting;
+
+#ifdef CIRC_BUFF_STATS
+    /*each side only ever writes its own*/
+    _Alignas(CIRC_BUFF_CACHE_LINE) circ_buff_stats producer_stats;
+    _Alignas(CIRC_BUFF_CACHE_LINE) circ_buff_stats consumer_stats;
+#endif
+}circ_buff_spsc;
+
+/*storage of the spsc buffer in the caller's address space*/
+static inline uint32_t* circ_buff_spsc_base(circ_buff_spsc_ptr spsc)
+{
+    return (uint32_t*)((uint8_t*)spsc+spsc->base_offset);
+}
+
+
+/*
+ * Function:     circ_buff_spsc_init(circ_buff_spsc_ptr* spsc_pointer, int32_t size)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates a cache line aligned spsc buffer able to hold 'size'
+ *               uint32_t elements and initialises head and tail to zero.
+ *
+ * Usage:        Pass a pointer to the ptr of the spsc buffer and the number of
+ *               elements it must hold. Call this before any thread uses it.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: The size parameter is less than or equal
+ *               to zero.
+ *
+ *               CIRC_BUFF_MALLOC_FAIL: An allocation fails. Nothing is leaked.
+ *
+ *               CIRC_BUFF_SUCCESS: The funcion returns successfully.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_init(circ_buff_spsc_ptr* spsc_pointer, int32_t size);
+
+/*
+ * Function:     circ_buff_spsc_destroy(circ_buff_spsc_ptr spsc_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  De-allocates the storage and the structure of the spsc buffer.
+ *               Neither side may use the buffer during or after this call.
+ *               Only for buffers made by circ_buff_spsc_init; shared memory
+ *               buffers are released with circ_buff_spsc_detach.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_SUCCESS: The function completes execution
+ *               completely.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_destroy(circ_buff_spsc_ptr spsc_pointer);
+
+/*
+ * Function:     circ_buff_spsc_write(circ_buff_spsc_ptr spsc_pointer, uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Writes data at the tail and publishes the new tail. Must only
+ *               be called from the producer thread.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_FULL: The buffer is full; nothing is written.
+ *
+ *               CIRC_BUFF_SUCCESS: The data is written.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_write(circ_buff_spsc_ptr spsc_pointer, uint32_t data);
+
+/*
+ * Function:     circ_buff_spsc_read(circ_buff_spsc_ptr spsc_pointer, uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Reads the element at the head into *data and publishes the new
+ *               head. Must only be called from the consumer thread.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: Either of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_EMPTY: The buffer is empty; *data is untouched.
+ *
+ *               CIRC_BUFF_SUCCESS: The data is read.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_read(circ_buff_spsc_ptr spsc_pointer, uint32_t* data);
+
+/*
+ * Function:     circ_buff_spsc_read_n(circ_buff_spsc_ptr spsc_pointer, uint32_t* data,
+ *                                     uint32_t count, uint32_t* read)
+ * -----------------------------------------------------------------------------
+ * Description:  Reads up to 'count' elements into data with one look at the
+ *               producer's tail and one store of the new head. Must only be
+ *               called from the consumer thread.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: A pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_EMPTY: The buffer is empty; *read is zero.
+ *
+ *               CIRC_BUFF_SUCCESS: *read elements are read.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_read_n(circ_buff_spsc_ptr spsc_pointer, uint32_t* data, uint32_t count, uint32_t* read);
+
+/*
+ * Function:     circ_buff_spsc_size(circ_buff_spsc_ptr spsc_pointer, uint32_t* size)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the number of elements currently held in *size. When
+ *               both sides are running this is only a snapshot.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: Either of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_SUCCESS: *size is valid.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_size(circ_buff_spsc_ptr spsc_pointer, uint32_t* size);
+
+/*
+ * Function:     circ_buff_spsc_write_wait(circ_buff_spsc_ptr spsc_pointer,
+ *                                         uint32_t data, int32_t timeout_ms)
+ * -----------------------------------------------------------------------------
+ * Description:  As circ_buff_spsc_write, but waits for space when the buffer
+ *               is full: first by spinning, then by sleeping on a futex until
+ *               the consumer frees a slot. Works across processes for buffers
+ *               in shared memory.
+ *
+ * Usage:        timeout_ms<0 waits forever, timeout_ms==0 does not wait.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_FULL: Still full when the timeout expired.
+ *
+ *               CIRC_BUFF_SUCCESS: The data is written.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_write_wait(circ_buff_spsc_ptr spsc_pointer, uint32_t data, int32_t timeout_ms);
+
+/*
+ * Function:     circ_buff_spsc_read_wait(circ_buff_spsc_ptr spsc_pointer,
+ *                                        uint32_t* data, int32_t timeout_ms)
+ * -----------------------------------------------------------------------------
+ * Description:  As circ_buff_spsc_read, but waits for data when the buffer is
+ *               empty, the same way circ_buff_spsc_write_wait waits for space.
+ *
+ * Usage:        timeout_ms<0 waits forever, timeout_ms==0 does not wait.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: Either of the pointers passed is a NULL.
+ *
+ *               CIRC_BUFF_EMPTY: Still empty when the timeout expired.
+ *
+ *               CIRC_BUFF_SUCCESS: The data is read.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_read_wait(circ_buff_spsc_ptr spsc_pointer, uint32_t* data, int32_t timeout_ms);
+
+#ifdef CIRC_BUFF_STATS
+/*
+ * Function:     circ_buff_spsc_stats_get(circ_buff_spsc_ptr spsc_pointer,
+ *                                        circ_buff_stats* stats)
+ * -----------------------------------------------------------------------------
+ * Description:  Combines the producer's and the consumer's counters into 
+ *               *stats. Exact when both sides are idle, approximate while they
+ *               run. high_water is sampled by the producer once every 
+ *               CIRC_BUFF_STATS_SAMPLE writes. A blocking call that waits and
+ *               then succeeds is not counted as full/empty.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_stats_get(circ_buff_spsc_ptr spsc_pointer, circ_buff_stats* stats);
+#endif
+
+/*
+ * Function:     circ_buff_spsc_create_fd(circ_buff_spsc_ptr* spsc_pointer, int fd,
+ *                                        int32_t size)
+ * -----------------------------------------------------------------------------
+ * Description:  Sizes the shared memory object 'fd' (from shm_open or
+ *               memfd_create) to hold an spsc buffer of 'size' elements, maps
+ *               it and initialises the buffer in it. The fd may be closed
+ *               afterwards; pass it (or its name) to the other process, which
+ *               calls circ_buff_spsc_attach_fd/circ_buff_spsc_shm_attach.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: size is out of range or fd is invalid.
+ *
+ *               CIRC_BUFF_MALLOC_FAIL: ftruncate or mmap fails.
+ *
+ *               CIRC_BUFF_SUCCESS: *spsc_pointer is mapped and ready.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_create_fd(circ_buff_spsc_ptr* spsc_pointer, int fd, int32_t size);
+
+/*
+ * Function:     circ_buff_spsc_attach_fd(circ_buff_spsc_ptr* spsc_pointer, int fd)
+ * -----------------------------------------------------------------------------
+ * Description:  Maps an spsc buffer created by circ_buff_spsc_create_fd in
+ *               another process (or earlier in this one). The mapping may be
+ *               at a different address than the creator's.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: The object is too small or was not
+ *               initialised as an spsc buffer.
+ *
+ *               CIRC_BUFF_MALLOC_FAIL: mmap fails.
+ *
+ *               CIRC_BUFF_SUCCESS: *spsc_pointer is mapped and ready.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_attach_fd(circ_buff_spsc_ptr* spsc_pointer, int fd);
+
+/*
+ * Function:     circ_buff_spsc_shm_create(circ_buff_spsc_ptr* spsc_pointer,
+ *                                         const char* name, int32_t size)
+ * -----------------------------------------------------------------------------
+ * Description:  Creates the named POSIX shared memory object 'name' (which
+ *               must not exist yet) and an spsc buffer of 'size' elements in
+ *               it. Remove the name with circ_buff_spsc_shm_unlink when done.
+ *
+ * Returns:      As circ_buff_spsc_create_fd, plus
+ *               CIRC_BUFF_FILE_OPEN_FAILED: shm_open fails.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_shm_create(circ_buff_spsc_ptr* spsc_pointer, const char* name, int32_t size);
+
+/*
+ * Function:     circ_buff_spsc_shm_attach(circ_buff_spsc_ptr* spsc_pointer,
+ *                                         const char* name)
+ * -----------------------------------------------------------------------------
+ * Description:  Maps the spsc buffer in the named shared memory object 'name'.
+ *
+ * Returns:      As circ_buff_spsc_attach_fd, plus
+ *               CIRC_BUFF_FILE_OPEN_FAILED: shm_open fails.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_shm_attach(circ_buff_spsc_ptr* spsc_pointer, const char* name);
+
+/*
+ * Function:     circ_buff_spsc_detach(circ_buff_spsc_ptr spsc_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  Unmaps a shared memory spsc buffer from this process. The
+ *               other process keeps its own mapping.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_detach(circ_buff_spsc_ptr spsc_pointer);
+
+/*
+ * Function:     circ_buff_spsc_shm_unlink(const char* name)
+ * -----------------------------------------------------------------------------
+ * Description:  Removes the name of a shared memory object. Existing mappings
+ *               stay valid until they are detached.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_FILE_OPEN_FAILED or
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_spsc_shm_unlink(const char* name);
+
+#endif
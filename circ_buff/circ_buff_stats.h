@@ -0,0 +1,148 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_stats.h
+ *
+ * Description:  Optional hot path counters for the circular buffers. They are
+ *               only compiled in when CIRC_BUFF_STATS is defined; otherwise
+ *               every CIRC_BUFF_STAT() statement disappears and the buffer
+ *               structures do not grow.
+ *
+ *               Residency (time from write to read) is kept in a log-linear
+ *               histogram in the style of HdrHistogram: values below
+ *               2^CIRC_BUFF_STATS_SUB_BITS are exact, and every power of two
+ *               above that is split into 2^CIRC_BUFF_STATS_SUB_BITS equal
+ *               sub-buckets, so any value is known to within 12.5%.
+ *
+ * Usage:        Build everything with -DCIRC_BUFF_STATS, then call
+ *               circ_buff_stats_get/circ_buff_spsc_stats_get/
+ *               circ_buff_mpmc_stats_get for a snapshot.
+ *
+ * */
+
+#ifndef _CIRC_BUFF_STATS_H
+#define _CIRC_BUFF_STATS_H
+#include<stdint.h>
+#include<string.h>
+#include<time.h>
+
+/*sub-buckets per power of two, as a power of two*/
+#define CIRC_BUFF_STATS_SUB_BITS 3
+#define CIRC_BUFF_STATS_BUCKETS ((64-CIRC_BUFF_STATS_SUB_BITS+1)<<CIRC_BUFF_STATS_SUB_BITS)
+
+/*the concurrent buffers look at the other side's index once per this many writes*/
+#define CIRC_BUFF_STATS_SAMPLE 64
+
+#ifdef CIRC_BUFF_STATS
+#define CIRC_BUFF_STAT(statement) do{ statement; }while(0)
+#else
+#define CIRC_BUFF_STAT(statement) do{ }while(0)
+#endif
+
+
+/*
+ * Structure:    circ_buff_stats
+ * -----------------------------------------------------------------------------
+ * Description:  Counters of one buffer, one side of a buffer or one thread.
+ *
+ *               writes/reads     - elements written/read successfully.
+ *               full/empty       - write/read calls turned away.
+ *               high_water       - most elements ever held at once.
+ *               residency        - histogram of write to read times in ns;
+ *                                  residency_count is its total.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_stats
+{
+    uint64_t  writes;
+    uint64_t  reads;
+    uint64_t  full;
+    uint64_t  empty;
+    uint32_t  high_water;
+    uint64_t  residency_count;
+    uint64_t  residency[CIRC_BUFF_STATS_BUCKETS];
+}circ_buff_stats;
+
+
+/*monotonic time in ns; the same clock in every process*/
+static inline uint64_t circ_buff_stats_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec*1000000000u+(uint64_t)now.tv_nsec;
+}
+
+/*histogram bucket of a value*/
+static inline uint32_t circ_buff_stats_bucket(uint64_t value)
+{
+    if(value<(1u<<CIRC_BUFF_STATS_SUB_BITS))
+         return (uint32_t)value;
+
+    uint32_t exponent=63-__builtin_clzll(value);
+    uint32_t sub=(uint32_t)(value>>(exponent-CIRC_BUFF_STATS_SUB_BITS))&((1u<<CIRC_BUFF_STATS_SUB_BITS)-1);
+    return ((exponent-CIRC_BUFF_STATS_SUB_BITS+1)<<CIRC_BUFF_STATS_SUB_BITS)+sub;
+}
+
+/*smallest value that lands in a bucket*/
+static inline uint64_t circ_buff_stats_bucket_floor(uint32_t bucket)
+{
+    if(bucket<(1u<<CIRC_BUFF_STATS_SUB_BITS))
+         return bucket;
+
+    uint32_t exponent=(bucket>>CIRC_BUFF_STATS_SUB_BITS)+CIRC_BUFF_STATS_SUB_BITS-1;
+    uint64_t sub=bucket&((1u<<CIRC_BUFF_STATS_SUB_BITS)-1);
+    return (1ull<<exponent)|(sub<<(exponent-CIRC_BUFF_STATS_SUB_BITS));
+}
+
+static inline void circ_buff_stats_record(circ_buff_stats* stats, uint64_t residency)
+{
+    stats->residency[circ_buff_stats_bucket(residency)]++;
+    stats->residency_count++;
+}
+
+static inline void circ_buff_stats_high_water(circ_buff_stats* stats, uint32_t occupied)
+{
+    if(occupied>stats->high_water)
+         stats->high_water=occupied;
+}
+
+/*adds 'from' into 'into'; high_water becomes the larger of the two*/
+static inline void circ_buff_stats_merge(circ_buff_stats* into, const circ_buff_stats* from)
+{
+    uint32_t bucket;
+
+    into->writes+=from->writes;
+    into->reads+=from->reads;
+    into->full+=from->full;
+    into->empty+=from->empty;
+    circ_buff_stats_high_water(into, from->high_water);
+    into->residency_count+=from->residency_count;
+    for(bucket=0; bucket<CIRC_BUFF_STATS_BUCKETS; bucket++)
+         into->residency[bucket]+=from->residency[bucket];
+}
+
+/*
+ * Function:     circ_buff_stats_percentile(const circ_buff_stats* stats, double percent)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the residency in ns that 'percent' (0-100) of the 
+ *               recorded elements did not exceed, as the floor of its bucket.
+ *               Returns 0 when nothing is recorded.
+ * ----------------------------------------------------------------------------
+ */
+static inline uint64_t circ_buff_stats_percentile(const circ_buff_stats* stats, double percent)
+{
+    uint64_t target=(uint64_t)(percent/100.0*(double)stats->residency_count+0.5), seen=0;
+    uint32_t bucket;
+
+    if(target==0)
+         target=1;
+    for(bucket=0; bucket<CIRC_BUFF_STATS_BUCKETS; bucket++)
+    {
+         seen+=stats->residency[bucket];
+         if(seen>=target)
+              return circ_buff_stats_bucket_floor(bucket);
+    }
+    return 0;
+}
+
+#endif
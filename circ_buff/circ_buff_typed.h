@@ -0,0 +1,125 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_typed.h
+ *
+ * Description:  Macro-generated family of circular buffers with the element
+ *               type and the capacity fixed at compile time. Each family has
+ *               the same semantics as circ_buff.h: free-running head/tail
+ *               indices, power of two storage, the capacity kept exactly, and
+ *               the same circ_buff_code return values. The storage lives
+ *               inline in the structure, so no heap allocation is needed and
+ *               the compiler sees every constant on the hot path.
+ *
+ * Usage:        At file scope:
+ *                    CIRC_BUFF_DEFINE(ts_ring, uint64_t, 1000)
+ *               then:
+ *                    ts_ring ring;
+ *                    ts_ring_init(&ring);
+ *                    ts_ring_write(&ring, stamp);
+ *                    ts_ring_read(&ring, &stamp);
+ *               To build an element in place instead of copying it:
+ *                    uint64_t* slot=ts_ring_emplace(&ring);
+ *                    if(slot!=NULL) { *slot=...; ts_ring_commit(&ring); }
+ *
+ * */
+
+#ifndef _CIRC_BUFF_TYPED_H
+#define _CIRC_BUFF_TYPED_H
+#include<stdint.h>
+#include<stddef.h>
+#include "circ_buff.h"
+
+/*smallest power of two >= n, as a constant expression; 1 <= n <= 2^31*/
+#define CIRC_BUFF_SMEAR1_(x) ((x)|((x)>>1))
+#define CIRC_BUFF_SMEAR2_(x) (CIRC_BUFF_SMEAR1_(x)|(CIRC_BUFF_SMEAR1_(x)>>2))
+#define CIRC_BUFF_SMEAR4_(x) (CIRC_BUFF_SMEAR2_(x)|(CIRC_BUFF_SMEAR2_(x)>>4))
+#define CIRC_BUFF_SMEAR8_(x) (CIRC_BUFF_SMEAR4_(x)|(CIRC_BUFF_SMEAR4_(x)>>8))
+#define CIRC_BUFF_SMEAR16_(x) (CIRC_BUFF_SMEAR8_(x)|(CIRC_BUFF_SMEAR8_(x)>>16))
+#define CIRC_BUFF_POW2_CEIL(n) (CIRC_BUFF_SMEAR16_((uint32_t)(n)-1u)+1u)
+
+
+/*
+ * Macro:        CIRC_BUFF_DEFINE(name, type, capacity)
+ * -----------------------------------------------------------------------------
+ * Description:  Defines the structure 'name' and the static inline functions
+ *               name_init, name_size, name_write, name_read, name_emplace,
+ *               name_commit and name_front. 'type' may be any complete type
+ *               that can be assigned; 'capacity' must be a constant between 1
+ *               and CIRC_BUFF_MAX_SIZE.
+ *
+ *               name_write(cb, data)   - copies data in; CIRC_BUFF_FULL when
+ *                                        full.
+ *               name_read(cb, &data)   - copies the oldest element out;
+ *                                        CIRC_BUFF_EMPTY when empty.
+ *               name_emplace(cb)       - returns the tail slot to build the
+ *                                        next element in, or NULL when full.
+ *               name_commit(cb)        - publishes the slot from name_emplace.
+ *               name_front(cb)         - returns the oldest element in place,
+ *                                        or NULL when empty; name_read with a
+ *                                        NULL data pointer then drops it.
+ * ----------------------------------------------------------------------------
+ */
+#define CIRC_BUFF_DEFINE(name, type, capacity)                                      \
+_Static_assert((capacity)>0&&(uint32_t)(capacity)<=CIRC_BUFF_MAX_SIZE,              \
+               #name ": capacity out of range");                                     \
+enum { name##_capacity=(capacity), name##_mask=CIRC_BUFF_POW2_CEIL(capacity)-1 };   \
+                                                                                     \
+typedef struct name                                                                  \
+{                                                                                    \
+    uint32_t head;                                                                   \
+    uint32_t tail;                                                                   \
+    _Alignas(CIRC_BUFF_CACHE_LINE) type base[CIRC_BUFF_POW2_CEIL(capacity)];         \
+}name;                                                                               \
+                                                                                     \
+static inline void name##_init(name* cb)                                             \
+{                                                                                    \
+    cb->head=0;                                                                      \
+    cb->tail=0;                                                                      \
+}                                                                                    \
+                                                                                     \
+static inline uint32_t name##_size(const name* cb)                                   \
+{                                                                                    \
+    return cb->tail-cb->head;                                                        \
+}                                                                                    \
+                                                                                     \
+static inline type* name##_emplace(name* cb)                                         \
+{                                                                                    \
+    if(cb->tail-cb->head==(uint32_t)name##_capacity)                                 \
+         return NULL;                                                                \
+    return &cb->base[cb->tail&name##_mask];                                          \
+}                                                                                    \
+                                                                                     \
+static inline void name##_commit(name* cb)                                           \
+{                                                                                    \
+    cb->tail++;                                                                      \
+}                                                                                    \
+                                                                                     \
+static inline circ_buff_code name##_write(name* cb, type data)                       \
+{                                                                                    \
+    type* slot=name##_emplace(cb);                                                   \
+    if(slot==NULL)                                                                   \
+         return CIRC_BUFF_FULL;                                                      \
+    *slot=data;                                                                      \
+    cb->tail++;                                                                      \
+    return CIRC_BUFF_SUCCESS;                                                        \
+}                                                                                    \
+                                                                                     \
+static inline type* name##_front(name* cb)                                           \
+{                                                                                    \
+    if(cb->head==cb->tail)                                                           \
+         return NULL;                                                                \
+    return &cb->base[cb->head&name##_mask];                                          \
+}                                                                                    \
+                                                                                     \
+static inline circ_buff_code name##_read(name* cb, type* data)                       \
+{                                                                                    \
+    if(cb->head==cb->tail)                                                           \
+         return CIRC_BUFF_EMPTY;                                                     \
+    if(data!=NULL)                                                                   \
+         *data=cb->base[cb->head&name##_mask];                                       \
+    cb->head++;                                                                      \
+    return CIRC_BUFF_SUCCESS;                                                        \
+}
+
+#endif
@@ -0,0 +1,207 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_window.c
+ *
+ * Description:  Contains the sliding time window. See circ_buff_window.h for
+ *               the monotonic queues behind min and max.
+ *
+ * */
+
+
+#include "circ_buff_window.h"
+#include<stdint.h>
+#include<stdlib.h>
+#include<string.h>
+
+
+/*
+ * Function:     circ_buff_window_evict(circ_buff_window_ptr win)
+ * -----------------------------------------------------------------------------
+ * Description:  Removes the oldest element and takes it out of the sum and,
+ *               if it is at the front of either queue, out of that queue.
+ *               The window must not be empty.
+ * ----------------------------------------------------------------------------
+ */
+static inline void circ_buff_window_evict(circ_buff_window_ptr win)
+{
+    uint32_t head=win->head;
+
+    win->sum-=win->values[head&win->mask];
+    if(win->min_queue[win->min_head&win->mask]==head)
+         win->min_head++;
+    if(win->max_queue[win->max_head&win->mask]==head)
+         win->max_head++;
+    win->head=head+1;
+}
+
+/*
+ * Function:     circ_buff_window_expire(circ_buff_window_ptr win, uint64_t now)
+ * -----------------------------------------------------------------------------
+ * Description:  Evicts elements from the oldest on while they have expired at
+ *               'now'. Stops at the first one that has not; stamps only grow,
+ *               so nothing behind it has either.
+ * ----------------------------------------------------------------------------
+ */
+static void circ_buff_window_expire(circ_buff_window_ptr win, uint64_t now)
+{
+    while(win->head!=win->tail)
+    {
+         uint64_t stamp=win->stamps[win->head&win->mask];
+         if(stamp>now||now-stamp<win->span)
+              break;
+         circ_buff_window_evict(win);
+    }
+}
+
+
+/*
+ * Function:     circ_buff_window_init(circ_buff_window_ptr* window_pointer, int32_t size,
+ *                                     uint64_t span, uint32_t mode)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates the value and stamp rings and the two queues, all
+ *               of the same power of two length.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_MALLOC_FAIL
+ *               or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_window_init(circ_buff_window_ptr* window_pointer, int32_t size, uint64_t span, uint32_t mode)
+{
+    /*basic pointer and size check*/
+    if(window_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+    if(size<=0||(uint32_t)size>CIRC_BUFF_MAX_SIZE||span==0)
+         return CIRC_BUFF_BAD_DATA;
+
+    /*round the capacity up to a power of two*/
+    uint32_t capacity=1;
+    while(capacity<(uint32_t)size)
+         capacity<<=1;
+
+    circ_buff_window_ptr win=(circ_buff_window_ptr)calloc(1, sizeof(circ_buff_window));
+    if(win==NULL)
+         return CIRC_BUFF_MALLOC_FAIL;
+
+    win->values=(uint32_t*)malloc(sizeof(uint32_t)*capacity);
+    win->stamps=(uint64_t*)malloc(sizeof(uint64_t)*capacity);
+    win->min_queue=(uint32_t*)malloc(sizeof(uint32_t)*capacity);
+    win->max_queue=(uint32_t*)malloc(sizeof(uint32_t)*capacity);
+    if(win->values==NULL||win->stamps==NULL||win->min_queue==NULL||win->max_queue==NULL)
+    {
+         circ_buff_window_destroy(win);
+         return CIRC_BUFF_MALLOC_FAIL;
+    }
+
+    win->span=span;
+    win->total_size=capacity;
+    win->mask=capacity-1;
+    win->mode=mode&CIRC_BUFF_MODE_OVERWRITE;
+
+    *window_pointer=win;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_window_destroy(circ_buff_window_ptr window_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  De-allocates the rings, the queues and the structure.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_window_destroy(circ_buff_window_ptr window_pointer)
+{
+    /*basic pointer check*/
+    if(window_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    free(window_pointer->values);
+    free(window_pointer->stamps);
+    free(window_pointer->min_queue);
+    free(window_pointer->max_queue);
+    free(window_pointer);
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_window_write(circ_buff_window_ptr window_pointer, uint64_t stamp,
+ *                                      uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Expires, makes room if the mode allows it, stores the element
+ *               and its stamp, adds it to the sum and pushes its position on
+ *               both queues.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_BAD_DATA, CIRC_BUFF_FULL or
+ *               CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_window_write(circ_buff_window_ptr window_pointer, uint64_t stamp, uint32_t data)
+{
+    /*basic pointer check*/
+    if(window_pointer==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    circ_buff_window_ptr win=window_pointer;
+    if(win->head!=win->tail&&stamp<win->stamps[(win->tail-1)&win->mask])
+         return CIRC_BUFF_BAD_DATA;
+
+    circ_buff_window_expire(win, stamp);
+    if(win->tail-win->head==win->total_size)
+    {
+         if(!(win->mode&CIRC_BUFF_MODE_OVERWRITE))
+              return CIRC_BUFF_FULL;
+         circ_buff_window_evict(win);
+         win->dropped++;
+    }
+
+    uint32_t tail=win->tail;
+    win->values[tail&win->mask]=data;
+    win->stamps[tail&win->mask]=stamp;
+    win->sum+=data;
+
+    /*drop the queue entries this element outlives and beats*/
+    while(win->min_tail!=win->min_head&&win->values[win->min_queue[(win->min_tail-1)&win->mask]&win->mask]>=data)
+         win->min_tail--;
+    win->min_queue[win->min_tail++&win->mask]=tail;
+    while(win->max_tail!=win->max_head&&win->values[win->max_queue[(win->max_tail-1)&win->mask]&win->mask]<=data)
+         win->max_tail--;
+    win->max_queue[win->max_tail++&win->mask]=tail;
+
+    win->tail=tail+1;
+    return CIRC_BUFF_SUCCESS;
+}
+
+
+/*
+ * Function:     circ_buff_window_query(circ_buff_window_ptr window_pointer, uint64_t now,
+ *                                      circ_buff_window_summary* summary)
+ * -----------------------------------------------------------------------------
+ * Description:  Expires, then reads the aggregates straight off the structure
+ *               and the fronts of the two queues.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR, CIRC_BUFF_EMPTY or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_window_query(circ_buff_window_ptr window_pointer, uint64_t now, circ_buff_window_summary* summary)
+{
+    /*basic pointer check*/
+    if(window_pointer==NULL||summary==NULL)
+         return CIRC_BUFF_NULL_PTR;
+
+    circ_buff_window_ptr win=window_pointer;
+    circ_buff_window_expire(win, now);
+
+    memset(summary, 0, sizeof(circ_buff_window_summary));
+    summary->dropped=win->dropped;
+    if(win->head==win->tail)
+         return CIRC_BUFF_EMPTY;
+
+    summary->count=win->tail-win->head;
+    summary->sum=win->sum;
+    summary->min=win->values[win->min_queue[win->min_head&win->mask]&win->mask];
+    summary->max=win->values[win->max_queue[win->max_head&win->mask]&win->mask];
+    return CIRC_BUFF_SUCCESS;
+}
@@ -0,0 +1,168 @@
+/*
+ * Author:       Ashwath Gundepally, CU ECEE
+ *
+ * File:         circ_buff_window.h
+ *
+ * Description:  Declares a sliding time window on top of the circular buffer
+ *               layout of circ_buff.h. Every element is stored with a time
+ *               stamp; elements older than the window span are evicted as
+ *               new ones are written. The count, sum, minimum and maximum of
+ *               what is left are kept up to date on every write and evict, so
+ *               a query does not walk the buffer.
+ *
+ *               Stamps are whatever unit the caller picks, as long as the
+ *               span is given in the same unit; circ_buff_stats_now() gives
+ *               CLOCK_MONOTONIC nanoseconds.
+ *
+ * Usage:        circ_buff_window_init(&win, 4096, 1000000000ull, CIRC_BUFF_MODE_DEFAULT);
+ *               circ_buff_window_write(win, circ_buff_stats_now(), sample);
+ *               circ_buff_window_query(win, circ_buff_stats_now(), &summary);
+ *
+ * */
+
+#ifndef _CIRC_BUFF_WINDOW_H
+#define _CIRC_BUFF_WINDOW_H
+#include<stdint.h>
+#include "circ_buff.h"
+
+
+/*
+ * Structure:    circ_buff_window_summary
+ * -----------------------------------------------------------------------------
+ * Description:  The aggregates of the elements in the window. min and max are
+ *               zero when count is. 'dropped' counts elements evicted before
+ *               they expired because the buffer was full, in
+ *               CIRC_BUFF_MODE_OVERWRITE.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct circ_buff_window_summary
+{
+    uint32_t  count;
+    uint32_t  min;
+    uint32_t  max;
+    uint64_t  sum;
+    uint64_t  dropped;
+}circ_buff_window_summary;
+
+
+/*
+ * Structure:    circ_buff_window
+ * -----------------------------------------------------------------------------
+ * Description:  'values' and 'stamps' are parallel rings indexed by the
+ *               free-running positions head and tail, as in circ_buff.
+ *
+ *               The minimum and maximum are kept in two monotonic queues of
+ *               positions. min_queue holds the positions, oldest first, of
+ *               the elements that are smaller than everything written after
+ *               them; its front is the minimum of the window. A write pops
+ *               the back while the back's value is not smaller, then pushes
+ *               its own position. An evict pops the front if it is the
+ *               evicted position. max_queue is the same with the comparison
+ *               reversed. Every position is pushed and popped at most once,
+ *               so both cost O(1) amortised per element, and neither queue
+ *               can hold more than the buffer does.
+ *
+ * Usage:        Do not access the members directly; use the functions below.
+ * ----------------------------------------------------------------------------
+ */
+
+/*typedef a circ_buff_window ptr type so that "*" does not have to be used always*/
+typedef struct circ_buff_window *circ_buff_window_ptr;
+
+typedef struct circ_buff_window
+{
+    uint32_t *values;
+    uint64_t *stamps;
+    uint32_t *min_queue;
+    uint32_t *max_queue;
+    uint64_t  span;
+    uint64_t  sum;
+    uint64_t  dropped;
+    uint32_t  total_size;
+    uint32_t  mask;
+    uint32_t  mode;
+    uint32_t  head;
+    uint32_t  tail;
+    uint32_t  min_head;
+    uint32_t  min_tail;
+    uint32_t  max_head;
+    uint32_t  max_tail;
+}circ_buff_window;
+
+
+/*
+ * Function:     circ_buff_window_init(circ_buff_window_ptr* window_pointer, int32_t size,
+ *                                     uint64_t span, uint32_t mode)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates a window holding at most 'size' elements, rounded
+ *               up to a power of two, that keeps elements for 'span' stamp
+ *               units. The only mode flag used is CIRC_BUFF_MODE_OVERWRITE:
+ *               a write to a full window then evicts the oldest element even
+ *               though it has not expired.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: The size is less than or equal to zero or
+ *               larger than CIRC_BUFF_MAX_SIZE, or span is zero.
+ *
+ *               CIRC_BUFF_MALLOC_FAIL: An allocation fails. Nothing is leaked.
+ *
+ *               CIRC_BUFF_SUCCESS: The funcion returns successfully.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_window_init(circ_buff_window_ptr* window_pointer, int32_t size, uint64_t span, uint32_t mode);
+
+/*
+ * Function:     circ_buff_window_destroy(circ_buff_window_ptr window_pointer)
+ * -----------------------------------------------------------------------------
+ * Description:  De-allocates the rings, the queues and the structure.
+ *
+ * Returns:      CIRC_BUFF_NULL_PTR or CIRC_BUFF_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_window_destroy(circ_buff_window_ptr window_pointer);
+
+/*
+ * Function:     circ_buff_window_write(circ_buff_window_ptr window_pointer, uint64_t stamp,
+ *                                      uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Evicts the elements that have expired at 'stamp', then writes
+ *               data with that stamp. Stamps must not go backwards.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_BAD_DATA: stamp is older than the last one written;
+ *               nothing is written.
+ *
+ *               CIRC_BUFF_FULL: Every element is still inside the window and
+ *               the buffer is full; nothing is written. Never returned in
+ *               CIRC_BUFF_MODE_OVERWRITE.
+ *
+ *               CIRC_BUFF_SUCCESS: The data is written.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_window_write(circ_buff_window_ptr window_pointer, uint64_t stamp, uint32_t data);
+
+/*
+ * Function:     circ_buff_window_query(circ_buff_window_ptr window_pointer, uint64_t now,
+ *                                      circ_buff_window_summary* summary)
+ * -----------------------------------------------------------------------------
+ * Description:  Evicts the elements that have expired at 'now' and fills in
+ *               the aggregates of the rest. An element written at stamp s
+ *               expires once now-s reaches the span. O(1) apart from the
+ *               evictions, which every element pays for once.
+ *
+ * Returns:      Error codes:
+ *               CIRC_BUFF_NULL_PTR: A pointer passed is a NULL.
+ *
+ *               CIRC_BUFF_EMPTY: The window is empty; *summary is still
+ *               filled in, with count zero.
+ *
+ *               CIRC_BUFF_SUCCESS: *summary holds the aggregates.
+ * ----------------------------------------------------------------------------
+ */
+circ_buff_code circ_buff_window_query(circ_buff_window_ptr window_pointer, uint64_t now, circ_buff_window_summary* summary);
+
+#endif
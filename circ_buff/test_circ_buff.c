@@ -0,0 +1,1759 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<pthread.h>
+#include<sched.h>
+#include<time.h>
+#include<unistd.h>
+#include<sys/wait.h>
+#include "circ_buff.h"
+#include "circ_buff_spsc.h"
+#include "circ_buff_mpmc.h"
+#include "circ_buff_msg.h"
+#include "circ_buff_bcast.h"
+#include "circ_buff_scan.h"
+#include "circ_buff_shard.h"
+#include "circ_buff_window.h"
+#include "circ_buff_drain.h"
+#include "circ_buff_typed.h"
+#include "Unity/src/unity.h"
+
+#define RESULTS_FILE "results.txt"
+#define BUFF_SIZE 16
+#define SPSC_SIZE 64
+#define STRESS_COUNT 2000000
+#define SHM_NAME "/test_circ_buff_spsc"
+#define SHM_SIZE 4096
+#define SHM_COUNT 4000000
+#define WAIT_SIZE 8
+#define WAIT_COUNT 200000
+#define WAIT_TIMEOUT_MS 20
+#define DUMP_SIZE 1000000
+#define SNAPSHOT_SIZE 1000000
+#define MPMC_SIZE 100
+#define MPMC_THREADS 4
+#define MPMC_PER_THREAD 250000
+#define MPMC_CHURN_COUNT 1000
+#define BCAST_SIZE 8
+#define SCAN_SIZE 1000
+#define STORAGE_SIZE 100
+#define HUGE_SIZE (1<<20)
+#define BCAST_READERS 3
+#define BCAST_COUNT 1000000
+#define SHARD_SIZE 8
+#define SHARD_PRODUCERS 4
+#define SHARD_CONSUMERS 2
+#define SHARD_COUNT 500000
+#define WINDOW_SIZE 256
+#define WINDOW_SPAN 100
+#define WINDOW_SAMPLES 20000
+#define DRAIN_FLUSH_BYTES 4096
+#define DRAIN_COUNT 500000
+
+
+FILE *fp;
+
+/*typed rings for the macro-generated family*/
+typedef struct sample16 { uint64_t stamp; uint32_t channel; uint32_t value; } sample16;
+CIRC_BUFF_DEFINE(stamp_ring, uint64_t, 1000)
+CIRC_BUFF_DEFINE(sample_ring, sample16, 3)
+CIRC_BUFF_DEFINE(byte_ring, uint8_t, 5)
+
+
+void test_write_read(void)
+{
+    circ_buff_ptr cb=NULL;
+    uint32_t index, data;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_NULL_PTR, circ_buff_init(NULL, BUFF_SIZE), "rc!=CIRC_BUFF_NULL_PTR for a NULL pointer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init(&cb, BUFF_SIZE), "Fails to create the buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_read(cb, &data), "rc!=CIRC_BUFF_EMPTY on an empty buffer");
+
+    /*go around the buffer a few times, filling it each time*/
+    uint32_t lap;
+    for(lap=0; lap<3; lap++)
+    {
+         for(index=0; index<BUFF_SIZE; index++)
+              TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_write(cb, lap*BUFF_SIZE+index), "Fails to write to a buffer with space");
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_write(cb, 0), "rc!=CIRC_BUFF_FULL on a full buffer");
+
+         for(index=0; index<BUFF_SIZE; index++)
+         {
+              TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_read(cb, &data), "Fails to read from a buffer with data");
+              TEST_ASSERT_EQUAL_INT_MESSAGE(lap*BUFF_SIZE+index, data, "data read out of order");
+         }
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_read(cb, &data), "rc!=CIRC_BUFF_EMPTY after draining");
+
+         /*offset the next lap so that it wraps in the middle*/
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_write(cb, 0), "Fails to write to an empty buffer");
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_read(cb, &data), "Fails to read from a buffer with data");
+    }
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_destroy(cb), "Destroy func does not return properly");
+}
+
+void test_bulk_write_read(void)
+{
+    circ_buff_ptr cb=NULL;
+    uint32_t in[BUFF_SIZE*2], out[BUFF_SIZE*2], index, moved, data;
+
+    for(index=0; index<BUFF_SIZE*2; index++)
+         in[index]=1000+index;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init(&cb, BUFF_SIZE), "Fails to create the buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_NULL_PTR, circ_buff_write_n(cb, NULL, 1, &moved), "rc!=CIRC_BUFF_NULL_PTR for a NULL array");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_read_n(cb, out, 4, &moved), "rc!=CIRC_BUFF_EMPTY on an empty buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, moved, "elements read from an empty buffer");
+
+    /*move head and tail to the middle so that the batches below wrap*/
+    for(index=0; index<BUFF_SIZE/2+3; index++)
+    {
+         circ_buff_write(cb, 0);
+         circ_buff_read(cb, &data);
+    }
+
+    /*a batch larger than the buffer is clipped to the free space*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_write_n(cb, in, BUFF_SIZE*2, &moved), "Fails to write a batch");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(BUFF_SIZE, moved, "batch is not clipped to the free space");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_write_n(cb, in, 1, &moved), "rc!=CIRC_BUFF_FULL on a full buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, moved, "elements written to a full buffer");
+
+    /*partial read, then single reads agree with the bulk path*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_read_n(cb, out, 5, &moved), "Fails to read a batch");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(5, moved, "batch read has the wrong length");
+    TEST_ASSERT_EQUAL_UINT32_ARRAY_MESSAGE(in, out, 5, "batch read returns the wrong data");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_read(cb, &data), "Fails to read after a batch");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(in[5], data, "single read after a batch returns the wrong data");
+
+    /*drain the rest across the wrap*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_read_n(cb, out, BUFF_SIZE*2, &moved), "Fails to read a batch");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(BUFF_SIZE-6, moved, "batch is not clipped to the data stored");
+    TEST_ASSERT_EQUAL_UINT32_ARRAY_MESSAGE(in+6, out, BUFF_SIZE-6, "batch read across the wrap returns the wrong data");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, if_circ_buff_empty(cb), "buffer is not empty after draining");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_destroy(cb), "Destroy func does not return properly");
+}
+
+void test_reserve_commit(void)
+{
+    circ_buff_ptr cb=NULL;
+    circ_buff_span spans[2];
+    uint32_t index, count, data;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init(&cb, BUFF_SIZE), "Fails to create the buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_NULL_PTR, circ_buff_reserve(cb, 1, NULL, &count), "rc!=CIRC_BUFF_NULL_PTR for NULL spans");
+
+    /*move the tail close to the end so the reservation wraps*/
+    for(index=0; index<BUFF_SIZE-3; index++)
+    {
+         circ_buff_write(cb, 0);
+         circ_buff_read(cb, &data);
+    }
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_reserve(cb, 10, spans, &count), "Fails to reserve space");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(10, count, "reserved the wrong amount");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(3, spans[0].count, "first span does not stop at the end of the storage");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(7, spans[1].count, "second span does not hold the rest");
+    TEST_ASSERT_TRUE_MESSAGE(spans[1].data==cb->base, "second span does not start at base");
+
+    /*fill in place, then nothing is visible until commit*/
+    for(index=0; index<spans[0].count; index++)
+         spans[0].data[index]=index;
+    for(index=0; index<spans[1].count; index++)
+         spans[1].data[index]=spans[0].count+index;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, if_circ_buff_empty(cb), "reserved space is visible before commit");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_commit(cb, BUFF_SIZE+1), "rc!=CIRC_BUFF_BAD_DATA when committing too much");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_commit(cb, count), "Fails to commit");
+
+    /*peek sees the same two spans without consuming them*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_peek(cb, BUFF_SIZE, spans, &count), "Fails to peek");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(10, count, "peeked the wrong amount");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(3, spans[0].count, "first peek span does not stop at the end of the storage");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(9, spans[1].data[6], "peeked data is wrong");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_release(cb, 11), "rc!=CIRC_BUFF_BAD_DATA when releasing too much");
+
+    /*release part of it; the rest is still read in order*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_release(cb, 4), "Fails to release");
+    for(index=4; index<10; index++)
+    {
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_read(cb, &data), "Fails to read after a release");
+         TEST_ASSERT_EQUAL_INT_MESSAGE(index, data, "data read out of order");
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_peek(cb, 1, spans, &count), "rc!=CIRC_BUFF_EMPTY on an empty buffer");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_destroy(cb), "Destroy func does not return properly");
+}
+
+void test_pow2_mode(void)
+{
+    circ_buff_ptr cb=NULL;
+    uint32_t index, data, size;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_init_mode(&cb, 0, CIRC_BUFF_MODE_POW2), "rc!=CIRC_BUFF_BAD_DATA for a zero size");
+
+    /*the default mode keeps the requested capacity exactly*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init(&cb, 100), "Fails to create the buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(100, cb->total_size, "default mode changes the capacity");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(127, cb->mask, "storage is not a power of two");
+    for(index=0; index<100; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_write(cb, index), "Fails to write to a buffer with space");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_write(cb, index), "rc!=CIRC_BUFF_FULL at the requested capacity");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_destroy(cb), "Destroy func does not return properly");
+
+    /*the pow2 mode rounds the capacity up*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init_mode(&cb, 100, CIRC_BUFF_MODE_POW2), "Fails to create the buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(128, cb->total_size, "capacity is not rounded up to a power of two");
+
+    /*start the free-running indices just short of the 32 bit wrap*/
+    cb->head=cb->tail=UINT32_MAX-40;
+    for(index=0; index<cb->total_size; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_write(cb, index), "Fails to write across the index wrap");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_write(cb, index), "rc!=CIRC_BUFF_FULL across the index wrap");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_size(cb, &size), "Something's wrong with the size function");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(128, size, "the size returned is incorrect across the index wrap");
+
+    for(index=0; index<cb->total_size; index++)
+    {
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_read(cb, &data), "Fails to read across the index wrap");
+         TEST_ASSERT_EQUAL_INT_MESSAGE(index, data, "data read out of order");
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_read(cb, &data), "rc!=CIRC_BUFF_EMPTY after draining");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_destroy(cb), "Destroy func does not return properly");
+}
+
+void test_overwrite_mode(void)
+{
+    circ_buff_ptr cb=NULL;
+    uint32_t in[BUFF_SIZE*2], out[BUFF_SIZE], index, data, moved;
+    uint64_t dropped;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init_mode(&cb, 10, CIRC_BUFF_MODE_OVERWRITE), "Fails to create the buffer");
+
+    /*writes never fail; the oldest elements are dropped*/
+    for(index=0; index<25; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_write(cb, index), "write fails in overwrite mode");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_dropped(cb, &dropped), "Fails to return the dropped count");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(15, dropped, "dropped count is wrong");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, if_circ_buff_full(cb), "buffer is not full");
+
+    /*the newest ten are kept, oldest first*/
+    for(index=15; index<25; index++)
+    {
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_read(cb, &data), "Fails to read in overwrite mode");
+         TEST_ASSERT_EQUAL_INT_MESSAGE(index, data, "wrong element kept");
+    }
+
+    /*bulk writes: 4 fit, then a batch larger than the buffer keeps its newest ten*/
+    for(index=0; index<BUFF_SIZE*2; index++)
+         in[index]=100+index;
+    circ_buff_write_n(cb, in, 4, &moved);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_write_n(cb, in+4, 12, &moved), "bulk write fails in overwrite mode");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(12, moved, "bulk write does not accept the whole batch");
+    circ_buff_dropped(cb, &dropped);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(15+6, dropped, "dropped count is wrong after a bulk write");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_read_n(cb, out, BUFF_SIZE, &moved), "Fails to read a batch");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(10, moved, "wrong number kept after a bulk write");
+    TEST_ASSERT_EQUAL_UINT32_ARRAY_MESSAGE(in+6, out, 10, "wrong elements kept after a bulk write");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_write_n(cb, in, BUFF_SIZE*2, &moved), "bulk write fails in overwrite mode");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_read_n(cb, out, BUFF_SIZE, &moved), "Fails to read a batch");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(10, moved, "wrong number kept after an oversized batch");
+    TEST_ASSERT_EQUAL_UINT32_ARRAY_MESSAGE(in+BUFF_SIZE*2-10, out, 10, "wrong elements kept after an oversized batch");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_destroy(cb), "Destroy func does not return properly");
+}
+
+void test_mirror_mode(void)
+{
+    circ_buff_ptr cb=NULL;
+    circ_buff_span spans[2];
+    uint32_t index, data, count, storage;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init_mode(&cb, 3000, CIRC_BUFF_MODE_MIRROR), "Fails to create the buffer");
+    TEST_ASSERT_TRUE_MESSAGE(cb->mode&CIRC_BUFF_MODE_MIRROR, "mirrored storage is not available");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(3000, cb->total_size, "mirror mode changes the capacity");
+    storage=cb->mask+1;
+
+    /*both halves are the same memory*/
+    cb->base[5]=0xabcd;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0xabcd, cb->base[storage+5], "second half does not mirror the first");
+
+    /*park head near the end of the storage so the data wraps*/
+    for(index=0; index<storage-10; index++)
+    {
+         circ_buff_write(cb, 0);
+         circ_buff_read(cb, &data);
+    }
+    for(index=0; index<3000; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_write(cb, index), "Fails to write to mirrored storage");
+
+    /*the whole wrapped window is one span*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_peek(cb, 3000, spans, &count), "Fails to peek mirrored storage");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(3000, spans[0].count, "mirrored peek is split");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, spans[1].count, "mirrored peek has a second span");
+    for(index=0; index<3000; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(index, spans[0].data[index], "mirrored span holds the wrong data");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_destroy(cb), "Destroy func does not return properly");
+}
+
+void test_dump(void)
+{
+    circ_buff_ptr cb=NULL;
+    uint32_t index, data, values[6]={0, 7, 42, 100, 65535, 4294967295u};
+    char text[128];
+    struct timespec start, end;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init(&cb, 6), "Fails to create the buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_NULL_PTR, circ_buff_dump_fd(NULL, 1, CIRC_BUFF_DUMP_TEXT), "rc!=CIRC_BUFF_NULL_PTR for a NULL pointer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_dump_file(cb, fp, CIRC_BUFF_DUMP_TEXT), "rc!=CIRC_BUFF_EMPTY on an empty buffer");
+
+    /*wrap the contents so that both spans are walked*/
+    for(index=0; index<5; index++)
+         circ_buff_write(cb, 9);
+    for(index=0; index<5; index++)
+         circ_buff_read(cb, &data);
+    for(index=0; index<6; index++)
+         circ_buff_write(cb, values[index]);
+
+    FILE* file=tmpfile();
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, "tmpfile fails");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_dump_file(cb, file, CIRC_BUFF_DUMP_TEXT), "Fails to dump as text");
+    rewind(file);
+    size_t length=fread(text, 1, sizeof(text)-1, file);
+    text[length]='\0';
+    TEST_ASSERT_EQUAL_STRING_MESSAGE("Buffer Data:\n0\t7\t42\t100\t65535\t4294967295\t\n", text, "text dump is wrong");
+
+    /*binary through the fd reads back as the same elements*/
+    rewind(file);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, ftruncate(fileno(file), 0), "ftruncate fails");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_dump_fd(cb, fileno(file), CIRC_BUFF_DUMP_BINARY), "Fails to dump as binary");
+    uint32_t raw[6]={0};
+    TEST_ASSERT_EQUAL_INT_MESSAGE(sizeof(raw), pread(fileno(file), raw, sizeof(raw), 0), "binary dump has the wrong length");
+    TEST_ASSERT_EQUAL_UINT32_ARRAY_MESSAGE(values, raw, 6, "binary dump is wrong");
+    fclose(file);
+
+    /*dumping does not consume anything*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(6, circ_buff_occupied(cb), "dump changed the buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_dump_fd(cb, -1, CIRC_BUFF_DUMP_TEXT), "rc!=CIRC_BUFF_BAD_DATA for a bad fd");
+    circ_buff_destroy(cb);
+
+    /*a large ring goes out in staging buffer sized writes*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init(&cb, DUMP_SIZE), "Fails to create the buffer");
+    for(index=0; index<DUMP_SIZE; index++)
+         circ_buff_write(cb, index*2654435761u);
+    file=tmpfile();
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, "tmpfile fails");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_dump_fd(cb, fileno(file), CIRC_BUFF_DUMP_TEXT), "Fails to dump a large buffer");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fprintf(fp, "text dump: %u elements in %.3f s\n", DUMP_SIZE,
+            (end.tv_sec-start.tv_sec)+(end.tv_nsec-start.tv_nsec)*1e-9);
+
+    /*spot check the end of the text*/
+    off_t bytes=lseek(fileno(file), 0, SEEK_END);
+    TEST_ASSERT_TRUE_MESSAGE(bytes>0&&pread(fileno(file), text, 32, bytes-32)==32, "large dump is too short");
+    text[32]='\0';
+    snprintf(text+64, 32, "%u\t\n", (DUMP_SIZE-1)*2654435761u);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(text+64, text+32-strlen(text+64), "large dump ends wrong");
+    fclose(file);
+
+    circ_buff_destroy(cb);
+
+    /*end a dump with the longest element at every offset around the end of the staging buffer*/
+    uint32_t zeros, lead;
+    for(lead=0; lead<2; lead++)
+    {
+         for(zeros=CIRC_BUFF_DUMP_STAGING/2-20; zeros<CIRC_BUFF_DUMP_STAGING/2-4; zeros++)
+         {
+              TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init_mode(&cb, 1<<16, CIRC_BUFF_MODE_POW2), "Fails to create the buffer");
+              if(lead)
+                   circ_buff_write(cb, 10);
+              for(index=0; index<zeros; index++)
+                   circ_buff_write(cb, 0);
+              circ_buff_write(cb, 4000000000u);
+
+              file=tmpfile();
+              TEST_ASSERT_NOT_NULL_MESSAGE(file, "tmpfile fails");
+              TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_dump_fd(cb, fileno(file), CIRC_BUFF_DUMP_TEXT), "Fails to dump at the staging boundary");
+              bytes=lseek(fileno(file), 0, SEEK_END);
+              TEST_ASSERT_EQUAL_INT_MESSAGE(13+3*lead+2*zeros+12, bytes, "dump at the staging boundary has the wrong length");
+              TEST_ASSERT_EQUAL_INT_MESSAGE(12, pread(fileno(file), text, 12, bytes-12), "dump at the staging boundary is too short");
+              text[12]='\0';
+              TEST_ASSERT_EQUAL_STRING_MESSAGE("4000000000\t\n", text, "dump at the staging boundary ends wrong");
+              fclose(file);
+              circ_buff_destroy(cb);
+         }
+    }
+}
+
+void test_snapshot(void)
+{
+    circ_buff_ptr cb=NULL, restored=NULL;
+    uint32_t index, data, mismatches=0;
+    struct timespec start, end;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init_mode(&cb, SNAPSHOT_SIZE, CIRC_BUFF_MODE_OVERWRITE), "Fails to create the buffer");
+
+    /*wrap and overwrite so that head, tail and dropped are all non-trivial*/
+    for(index=0; index<SNAPSHOT_SIZE+12345; index++)
+         circ_buff_write(cb, index);
+
+    FILE* file=tmpfile();
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, "tmpfile fails");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_NULL_PTR, circ_buff_snapshot_save(NULL, fileno(file)), "rc!=CIRC_BUFF_NULL_PTR for a NULL pointer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_snapshot_save(cb, fileno(file)), "Fails to save a snapshot");
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_snapshot_load(&restored, fileno(file)), "Fails to load a snapshot");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fprintf(fp, "snapshot reload: %u elements in %.3f ms\n", SNAPSHOT_SIZE,
+            (end.tv_sec-start.tv_sec)*1e3+(end.tv_nsec-start.tv_nsec)*1e-6);
+
+    /*same contents, same counters, and it keeps working as a ring*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(circ_buff_occupied(cb), circ_buff_occupied(restored), "size differs after reload");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(12345, restored->dropped, "dropped differs after reload");
+    TEST_ASSERT_TRUE_MESSAGE(restored->mode&CIRC_BUFF_MODE_OVERWRITE, "mode lost in the snapshot");
+    for(index=0; index<100; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_write(restored, 0xfeed0000u+index), "Fails to write to a loaded buffer");
+    for(index=12345+100; index<SNAPSHOT_SIZE+12345; index++)
+    {
+         circ_buff_read(restored, &data);
+         if(data!=index)
+              mismatches++;
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, mismatches, "elements differ after reload");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_read(restored, &data), "new writes are lost");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0xfeed0000u, data, "new writes are out of order");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_destroy(restored), "Fails to destroy a loaded buffer");
+
+    /*writes went to a private copy, so the file still loads; a flipped bit does not*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_snapshot_load(&restored, fileno(file)), "file changed by the loaded buffer");
+    circ_buff_destroy(restored);
+    uint32_t word;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(sizeof(word), pread(fileno(file), &word, sizeof(word), 4096), "pread fails");
+    word^=1u<<7;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(sizeof(word), pwrite(fileno(file), &word, sizeof(word), 4096), "pwrite fails");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_snapshot_load(&restored, fileno(file)), "corrupt snapshot accepted");
+
+    /*and neither does a truncated one*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, ftruncate(fileno(file), 1000), "ftruncate fails");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_snapshot_load(&restored, fileno(file)), "truncated snapshot accepted");
+    fclose(file);
+
+    circ_buff_destroy(cb);
+}
+
+void test_resize(void)
+{
+    circ_buff_ptr cb=NULL;
+    circ_buff_span spans[2];
+    uint32_t index, data, count, written, values[200];
+    uint64_t dropped;
+
+    /*grow a wrapped buffer where the wrapped part is the short one*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init(&cb, 8), "Fails to create the buffer");
+    for(index=0; index<6; index++)
+         circ_buff_write(cb, index);
+    for(index=0; index<3; index++)
+         circ_buff_read(cb, &data);
+    for(index=6; index<9; index++)
+         circ_buff_write(cb, index);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_resize(cb, 100), "Fails to grow");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(100, cb->total_size, "grown capacity is wrong");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(127, cb->mask, "grown storage is wrong");
+    for(index=9; index<100+3; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_write(cb, index), "Fails to fill the grown buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_write(cb, 0), "grown buffer holds too much");
+    for(index=3; index<100+3; index++)
+    {
+         circ_buff_read(cb, &data);
+         TEST_ASSERT_EQUAL_INT_MESSAGE(index, data, "grow loses the order");
+    }
+    circ_buff_destroy(cb);
+
+    /*grow where the first part is the short one, then shrink it back*/
+    circ_buff_init(&cb, 8);
+    for(index=0; index<8; index++)
+         circ_buff_write(cb, index);
+    for(index=0; index<6; index++)
+         circ_buff_read(cb, &data);
+    for(index=8; index<14; index++)
+         circ_buff_write(cb, index);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_resize(cb, 16), "Fails to grow");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_peek(cb, 8, spans, &count), "Fails to peek");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(8, count, "grow loses elements");
+    for(index=14; index<20; index++)
+         circ_buff_write(cb, index);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_resize(cb, 13), "shrinking below the data is not refused");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_resize(cb, 14), "Fails to shrink");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_write(cb, 0), "shrunk buffer holds too much");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_read_n(cb, values, 200, &count), "Fails to read");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(14, count, "shrink loses elements");
+    for(index=0; index<14; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(6+index, values[index], "shrink loses the order");
+
+    /*a flight recorder drops its oldest elements to shrink*/
+    circ_buff_destroy(cb);
+    circ_buff_init_mode(&cb, 16, CIRC_BUFF_MODE_OVERWRITE);
+    for(index=0; index<16; index++)
+         circ_buff_write(cb, index);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_resize(cb, 4), "Fails to shrink a flight recorder");
+    circ_buff_dropped(cb, &dropped);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(12, dropped, "shrink drops miscounted");
+    circ_buff_read(cb, &data);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(12, data, "shrink keeps the wrong elements");
+    circ_buff_destroy(cb);
+
+    /*mirrored storage is copied and stays mirrored*/
+    circ_buff_init_mode(&cb, 1000, CIRC_BUFF_MODE_MIRROR);
+    for(index=0; index<900; index++)
+    {
+         circ_buff_write(cb, index);
+         circ_buff_read(cb, &data);
+    }
+    for(index=0; index<1000; index++)
+         circ_buff_write(cb, index);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_resize(cb, 5000), "Fails to grow mirrored storage");
+    TEST_ASSERT_TRUE_MESSAGE(cb->mode&CIRC_BUFF_MODE_MIRROR, "grow loses the mirror");
+    for(index=1000; index<5000; index++)
+         circ_buff_write(cb, index);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_peek(cb, 5000, spans, &count), "Fails to peek");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(5000, spans[0].count, "grown mirror is split");
+    for(index=0; index<5000; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(index, spans[0].data[index], "mirrored grow loses the order");
+    circ_buff_destroy(cb);
+
+    /*auto-grow doubles on a full write until the limit*/
+    circ_buff_init(&cb, 4);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_autogrow(cb, -1), "negative limit is not refused");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_autogrow(cb, 100), "Fails to set the limit");
+    for(index=0; index<60; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_write(cb, index), "auto-grow does not grow");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(64, cb->total_size, "auto-grow does not double");
+    for(index=0; index<50; index++)
+         values[index]=60+index;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_write_n(cb, values, 50, &written), "Fails to grow for a batch");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(40, written, "batch does not fill up to the limit");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(100, cb->total_size, "auto-grow passes the limit");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_write(cb, 0), "buffer at its limit takes more");
+    circ_buff_read_n(cb, values, 200, &count);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(100, count, "auto-grow loses elements");
+    for(index=0; index<100; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(index, values[index], "auto-grow loses the order");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_destroy(cb), "Destroy func does not return properly");
+
+    /*in pow2 mode a limit that is not a power of two stops at the one below it*/
+    circ_buff_init_mode(&cb, 4, CIRC_BUFF_MODE_POW2);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_autogrow(cb, 100), "Fails to set the limit");
+    for(index=0; index<64; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_write(cb, index), "auto-grow does not grow");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_write(cb, 64), "pow2 auto-grow passes the limit");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(64, cb->total_size, "pow2 auto-grow stops at the wrong size");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_write_n(cb, values, 10, &written), "pow2 auto-grow passes the limit for a batch");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, written, "pow2 auto-grow passes the limit for a batch");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(64, cb->total_size, "pow2 auto-grow passes the limit for a batch");
+    circ_buff_destroy(cb);
+}
+
+void test_iter_scan(void)
+{
+    circ_buff_ptr cb=NULL;
+    circ_buff_iter iter;
+    circ_buff_span span;
+    uint32_t index, data, position, count, min, max, spans, expect_count, isa;
+    uint32_t values[SCAN_SIZE];
+    uint64_t sum, expect_sum;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init(&cb, SCAN_SIZE), "Fails to create the buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_iter_begin(cb, &iter), "empty buffer has elements to visit");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_min_max(cb, &min, &max), "empty buffer has a min");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_find(cb, 0, &position), "Fails to search an empty buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, position, "empty buffer finds something");
+
+    /*park the head near the end so the contents wrap*/
+    for(index=0; index<SCAN_SIZE-37; index++)
+    {
+         circ_buff_write(cb, 0);
+         circ_buff_read(cb, &data);
+    }
+    expect_sum=0;
+    for(index=0; index<SCAN_SIZE; index++)
+    {
+         values[index]=(index*2654435761u)%100000+1000;
+         expect_sum+=values[index];
+         circ_buff_write(cb, values[index]);
+    }
+
+    /*the walk sees everything in order and consumes nothing*/
+    circ_buff_iter_begin(cb, &iter);
+    for(index=0; circ_buff_iter_next(&iter, &data)==CIRC_BUFF_SUCCESS; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(values[index], data, "iterator order is wrong");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(SCAN_SIZE, index, "iterator misses elements");
+    circ_buff_iter_begin(cb, &iter);
+    for(spans=0, count=0; circ_buff_iter_span(&iter, &span)==CIRC_BUFF_SUCCESS; spans++)
+         count+=span.count;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(2, spans, "wrapped contents are not two spans");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(SCAN_SIZE, count, "spans miss elements");
+    circ_buff_size(cb, &count);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(SCAN_SIZE, count, "iterating consumed elements");
+
+    /*every kernel flavour the CPU has gives the same answers*/
+    for(isa=CIRC_BUFF_SCAN_SCALAR; isa<=CIRC_BUFF_SCAN_AVX2; isa++)
+    {
+         if(circ_buff_scan_select((circ_buff_scan_isa)isa)!=CIRC_BUFF_SUCCESS)
+              continue;
+         TEST_ASSERT_EQUAL_INT_MESSAGE(isa, circ_buff_scan_current(), "kernel flavour not selected");
+
+         /*matches in the first span, in its vector tail, and in the second span*/
+         uint32_t probes[4]={3, 36, 37, SCAN_SIZE-2};
+         for(index=0; index<4; index++)
+         {
+              circ_buff_find(cb, values[probes[index]], &position);
+              TEST_ASSERT_TRUE_MESSAGE(position<=probes[index], "find goes past the first match");
+              TEST_ASSERT_EQUAL_INT_MESSAGE(values[probes[index]], values[position], "find returns a non-match");
+         }
+         circ_buff_find(cb, 7, &position);
+         TEST_ASSERT_EQUAL_INT_MESSAGE(SCAN_SIZE, position, "find matches an absent value");
+
+         circ_buff_count_equal(cb, values[5], &count);
+         for(index=0, expect_count=0; index<SCAN_SIZE; index++)
+              expect_count+=values[index]==values[5];
+         TEST_ASSERT_EQUAL_INT_MESSAGE(expect_count, count, "count is wrong");
+
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_min_max(cb, &min, &max), "Fails to get min/max");
+         uint32_t expect_min=UINT32_MAX, expect_max=0;
+         for(index=0; index<SCAN_SIZE; index++)
+         {
+              expect_min=values[index]<expect_min ? values[index] : expect_min;
+              expect_max=values[index]>expect_max ? values[index] : expect_max;
+         }
+         TEST_ASSERT_EQUAL_INT_MESSAGE(expect_min, min, "min is wrong");
+         TEST_ASSERT_EQUAL_INT_MESSAGE(expect_max, max, "max is wrong");
+
+         circ_buff_sum(cb, &sum);
+         TEST_ASSERT_EQUAL_UINT64_MESSAGE(expect_sum, sum, "sum is wrong");
+    }
+    circ_buff_scan_select(CIRC_BUFF_SCAN_AUTO);
+    fprintf(fp, "scan kernels: flavour %d picked at run time\n", (int)circ_buff_scan_current());
+
+    /*sums do not overflow 32 bits*/
+    circ_buff_destroy(cb);
+    circ_buff_init(&cb, 16);
+    for(index=0; index<16; index++)
+         circ_buff_write(cb, UINT32_MAX);
+    circ_buff_sum(cb, &sum);
+    TEST_ASSERT_EQUAL_UINT64_MESSAGE(16ull*UINT32_MAX, sum, "sum overflows");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_destroy(cb), "Destroy func does not return properly");
+}
+
+/*Unit test for caller provided, single allocation and huge page storage*/
+void test_storage(void)
+{
+    static uint32_t storage[STORAGE_SIZE];
+    circ_buff_ptr cb=NULL;
+    uint32_t index, data;
+
+    /*a static array; the capacity is the largest power of two that fits*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_init_storage(&cb, storage, 0, CIRC_BUFF_MODE_DEFAULT), "empty storage is accepted");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init_storage(&cb, storage, STORAGE_SIZE, CIRC_BUFF_MODE_DEFAULT), "Fails to wrap caller storage");
+    TEST_ASSERT_EQUAL_PTR_MESSAGE(storage, cb->base, "caller storage is not used");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(64, cb->total_size, "caller storage capacity is wrong");
+    for(index=0; index<64; index++)
+         circ_buff_write(cb, index);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_write(cb, 0), "caller storage holds too much");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(63, storage[63], "data is not in the caller storage");
+
+    /*resizing moves the data off the caller storage*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_resize(cb, 200), "Fails to grow caller storage");
+    TEST_ASSERT_TRUE_MESSAGE(cb->base!=storage, "grow writes past the caller storage");
+    TEST_ASSERT_FALSE_MESSAGE(cb->mode&CIRC_BUFF_MODE_EXTERNAL, "grown storage is still marked external");
+    for(index=0; index<64; index++)
+    {
+         circ_buff_read(cb, &data);
+         TEST_ASSERT_EQUAL_INT_MESSAGE(index, data, "grow loses the order");
+    }
+    circ_buff_destroy(cb);
+
+    /*header and storage in one cache line aligned block*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init_single(&cb, 100, CIRC_BUFF_MODE_OVERWRITE), "Fails to create a single allocation");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, (uintptr_t)cb%CIRC_BUFF_CACHE_LINE, "structure is not aligned");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, (uintptr_t)cb->base%CIRC_BUFF_CACHE_LINE, "storage is not aligned");
+    TEST_ASSERT_TRUE_MESSAGE((uint8_t*)cb->base>=(uint8_t*)cb+sizeof(circ_buff), "storage overlaps the structure");
+    TEST_ASSERT_TRUE_MESSAGE((uint8_t*)cb->base<(uint8_t*)cb+sizeof(circ_buff)+CIRC_BUFF_CACHE_LINE, "storage is not right behind the structure");
+    for(index=0; index<150; index++)
+         circ_buff_write(cb, index);
+    circ_buff_read(cb, &data);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(50, data, "single allocation overwrites wrongly");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_resize(cb, 1000), "Fails to grow a single allocation");
+    circ_buff_read(cb, &data);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(51, data, "grow loses the order");
+    circ_buff_destroy(cb);
+
+    /*a huge page backed ring is huge page aligned, small ones quietly are not*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init_mode(&cb, 100, CIRC_BUFF_MODE_HUGEPAGE), "Fails to create a small huge page ring");
+    TEST_ASSERT_FALSE_MESSAGE(cb->mode&CIRC_BUFF_MODE_HUGEPAGE, "small ring claims huge pages");
+    circ_buff_destroy(cb);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init_mode(&cb, HUGE_SIZE, CIRC_BUFF_MODE_HUGEPAGE), "Fails to create a huge page ring");
+    TEST_ASSERT_TRUE_MESSAGE(cb->mode&CIRC_BUFF_MODE_HUGEPAGE, "large ring is not huge page backed");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, (uintptr_t)cb->base%CIRC_BUFF_HUGE_PAGE, "huge page storage is not aligned");
+    for(index=0; index<HUGE_SIZE; index++)
+         circ_buff_write(cb, index);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_resize(cb, 2*HUGE_SIZE), "Fails to grow a huge page ring");
+    TEST_ASSERT_TRUE_MESSAGE(cb->mode&CIRC_BUFF_MODE_HUGEPAGE, "grow loses the huge pages");
+    for(index=0; index<HUGE_SIZE; index++)
+    {
+         circ_buff_read(cb, &data);
+         if(data!=index)
+              TEST_ASSERT_EQUAL_INT_MESSAGE(index, data, "huge page ring loses the order");
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_destroy(cb), "Destroy func does not return properly");
+}
+
+#ifdef CIRC_BUFF_STATS
+void test_stats(void)
+{
+    circ_buff_ptr cb=NULL;
+    circ_buff_stats stats;
+    uint32_t index, data, batch[3]={1, 2, 3}, moved;
+
+    /*the histogram is exact below 8 and within 1/8 above*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(7, circ_buff_stats_bucket(7), "small values are not exact");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(8, circ_buff_stats_bucket_floor(circ_buff_stats_bucket(8)), "bucket floor is wrong");
+    TEST_ASSERT_TRUE_MESSAGE(circ_buff_stats_bucket_floor(circ_buff_stats_bucket(1000003))<=1000003
+                             &&circ_buff_stats_bucket_floor(circ_buff_stats_bucket(1000003))>1000003/8*7, "bucket is too coarse");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_STATS_BUCKETS-1, circ_buff_stats_bucket(UINT64_MAX), "largest value out of range");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_init(&cb, 4), "Fails to create the buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_NULL_PTR, circ_buff_stats_get(cb, NULL), "rc!=CIRC_BUFF_NULL_PTR for a NULL pointer");
+
+    for(index=0; index<5; index++)
+         circ_buff_write(cb, index);
+    for(index=0; index<5; index++)
+         circ_buff_read(cb, &data);
+    circ_buff_write_n(cb, batch, 3, &moved);
+    circ_buff_read_n(cb, batch, 3, &moved);
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_stats_get(cb, &stats), "Fails to get the stats");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(7, stats.writes, "writes miscounted");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(7, stats.reads, "reads miscounted");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1, stats.full, "full rejections miscounted");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1, stats.empty, "empty rejections miscounted");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(4, stats.high_water, "high water mark is wrong");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(7, stats.residency_count, "residency not recorded for every read");
+
+    circ_buff_destroy(cb);
+}
+#endif
+
+void test_typed_rings(void)
+{
+    static stamp_ring stamps;
+    sample_ring samples;
+    byte_ring bytes;
+    uint64_t stamp;
+    sample16 sample, *slot;
+    uint8_t byte;
+    uint32_t index;
+
+    /*storage is a power of two, capacity is kept exactly*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1024, sizeof(stamps.base)/sizeof(stamps.base[0]), "storage is not rounded up to a power of two");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, (uintptr_t)stamps.base%CIRC_BUFF_CACHE_LINE, "storage is not cache line aligned");
+
+    stamp_ring_init(&stamps);
+    for(index=0; index<1000; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, stamp_ring_write(&stamps, (uint64_t)index<<40), "Fails to write to a typed ring with space");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, stamp_ring_write(&stamps, 0), "rc!=CIRC_BUFF_FULL on a full typed ring");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1000, stamp_ring_size(&stamps), "typed ring size is wrong");
+    for(index=0; index<1000; index++)
+    {
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, stamp_ring_read(&stamps, &stamp), "Fails to read from a typed ring");
+         TEST_ASSERT_TRUE_MESSAGE(stamp==((uint64_t)index<<40), "typed ring returns the wrong data");
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, stamp_ring_read(&stamps, &stamp), "rc!=CIRC_BUFF_EMPTY on an empty typed ring");
+
+    /*build structs in place, across several wraps*/
+    sample_ring_init(&samples);
+    for(index=0; index<10; index++)
+    {
+         slot=sample_ring_emplace(&samples);
+         TEST_ASSERT_NOT_NULL(slot);
+         slot->stamp=index;
+         slot->channel=index*2;
+         slot->value=index*3;
+         sample_ring_commit(&samples);
+
+         TEST_ASSERT_NOT_NULL(sample_ring_front(&samples));
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, sample_ring_read(&samples, &sample), "Fails to read a struct");
+         TEST_ASSERT_EQUAL_INT_MESSAGE(index*3, sample.value, "struct read back is wrong");
+    }
+    TEST_ASSERT_NULL(sample_ring_front(&samples));
+
+    /*byte ring with a non power of two capacity*/
+    byte_ring_init(&bytes);
+    for(index=0; index<5; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, byte_ring_write(&bytes, (uint8_t)index), "Fails to write a byte");
+    TEST_ASSERT_NULL(byte_ring_emplace(&bytes));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, byte_ring_read(&bytes, NULL), "Fails to drop a byte");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, byte_ring_read(&bytes, &byte), "Fails to read a byte");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1, byte, "byte read back is wrong");
+}
+
+void test_spsc_write_read(void)
+{
+    circ_buff_spsc_ptr spsc=NULL;
+    uint32_t index, data, size;
+
+    /*invalid arguments*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_NULL_PTR, circ_buff_spsc_init(NULL, SPSC_SIZE), "rc!=CIRC_BUFF_NULL_PTR for a NULL pointer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_spsc_init(&spsc, 0), "rc!=CIRC_BUFF_BAD_DATA for a zero size");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_init(&spsc, SPSC_SIZE), "Fails to create the spsc buffer");
+
+    /*an empty buffer can not be read*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_spsc_read(spsc, &data), "rc!=CIRC_BUFF_EMPTY on an empty buffer");
+
+    /*fill it up; exactly SPSC_SIZE elements fit*/
+    for(index=0; index<SPSC_SIZE; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_write(spsc, index), "Fails to write to a buffer with space");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_spsc_write(spsc, index), "rc!=CIRC_BUFF_FULL on a full buffer");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_size(spsc, &size), "Something's wrong with the size function");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(SPSC_SIZE, size, "the size returned is incorrect");
+
+    /*drain half, refill half so that the tail wraps around*/
+    for(index=0; index<SPSC_SIZE/2; index++)
+    {
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_read(spsc, &data), "Fails to read from a buffer with data");
+         TEST_ASSERT_EQUAL_INT_MESSAGE(index, data, "data read out of order");
+    }
+    for(index=SPSC_SIZE; index<SPSC_SIZE+SPSC_SIZE/2; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_write(spsc, index), "Fails to write after a wrap");
+
+    /*everything comes back out in order*/
+    for(index=SPSC_SIZE/2; index<SPSC_SIZE+SPSC_SIZE/2; index++)
+    {
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_read(spsc, &data), "Fails to read after a wrap");
+         TEST_ASSERT_EQUAL_INT_MESSAGE(index, data, "data read out of order");
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_spsc_read(spsc, &data), "rc!=CIRC_BUFF_EMPTY after draining");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_destroy(spsc), "Destroy func does not return properly");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_NULL_PTR, circ_buff_spsc_destroy(NULL), "rc!=CIRC_BUFF_NULL_PTR for a NULL pointer");
+}
+
+
+/*producer thread of the stress test: writes 0..STRESS_COUNT-1 in order*/
+static void* spsc_producer(void* arg)
+{
+    circ_buff_spsc_ptr spsc=(circ_buff_spsc_ptr)arg;
+    uint32_t index;
+
+    for(index=0; index<STRESS_COUNT; index++)
+    {
+         while(circ_buff_spsc_write(spsc, index)==CIRC_BUFF_FULL)
+              sched_yield();
+    }
+    return NULL;
+}
+
+void test_spsc_two_thread_stress(void)
+{
+    circ_buff_spsc_ptr spsc=NULL;
+    pthread_t producer;
+    uint32_t index, data, mismatches=0;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_init(&spsc, SPSC_SIZE), "Fails to create the spsc buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, pthread_create(&producer, NULL, spsc_producer, spsc), "Fails to start the producer");
+
+    /*every value must show up exactly once and in order: no loss, no duplicates*/
+    for(index=0; index<STRESS_COUNT; index++)
+    {
+         while(circ_buff_spsc_read(spsc, &data)==CIRC_BUFF_EMPTY)
+              sched_yield();
+         if(data!=index)
+              mismatches++;
+    }
+    pthread_join(producer, NULL);
+
+    fprintf(fp, "spsc stress: %u elements, %u mismatches\n", STRESS_COUNT, mismatches);
+#ifdef CIRC_BUFF_STATS
+    circ_buff_stats stats;
+    circ_buff_spsc_stats_get(spsc, &stats);
+    fprintf(fp, "spsc stress stats: %llu full, %llu empty, high water %u, residency p50 %llu ns p99 %llu ns\n",
+            (unsigned long long)stats.full, (unsigned long long)stats.empty, stats.high_water,
+            (unsigned long long)circ_buff_stats_percentile(&stats, 50), (unsigned long long)circ_buff_stats_percentile(&stats, 99));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(STRESS_COUNT, stats.writes, "spsc writes miscounted");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(STRESS_COUNT, stats.reads, "spsc reads miscounted");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(STRESS_COUNT, stats.residency_count, "spsc residency not recorded for every read");
+    TEST_ASSERT_TRUE_MESSAGE(stats.high_water<=SPSC_SIZE, "spsc high water above the capacity");
+#endif
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, mismatches, "elements were lost, duplicated or reordered");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_spsc_read(spsc, &data), "extra elements after the stress run");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_destroy(spsc), "Destroy func does not return properly");
+}
+
+static void* spsc_wait_producer(void* arg)
+{
+    circ_buff_spsc_ptr spsc=(circ_buff_spsc_ptr)arg;
+    uint32_t index;
+
+    for(index=0; index<WAIT_COUNT; index++)
+    {
+         /*pause now and then so that the consumer has to park*/
+         if(index%20000==0)
+              usleep(2000);
+         if(circ_buff_spsc_write_wait(spsc, index, -1)!=CIRC_BUFF_SUCCESS)
+              break;
+    }
+    return NULL;
+}
+
+void test_spsc_blocking(void)
+{
+    circ_buff_spsc_ptr spsc=NULL;
+    pthread_t producer;
+    uint32_t index, data, mismatches=0;
+    struct timespec start, end;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_init(&spsc, WAIT_SIZE), "Fails to create the spsc buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_NULL_PTR, circ_buff_spsc_read_wait(spsc, NULL, 0), "rc!=CIRC_BUFF_NULL_PTR for a NULL pointer");
+
+    /*an empty buffer times out, after roughly the timeout and not before*/
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_spsc_read_wait(spsc, &data, WAIT_TIMEOUT_MS), "rc!=CIRC_BUFF_EMPTY after the timeout");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double waited_ms=(end.tv_sec-start.tv_sec)*1e3+(end.tv_nsec-start.tv_nsec)*1e-6;
+    TEST_ASSERT_TRUE_MESSAGE(waited_ms>=WAIT_TIMEOUT_MS-1, "read_wait returned before its timeout");
+
+    /*and so does a full one*/
+    for(index=0; index<WAIT_SIZE; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_write_wait(spsc, index, 0), "Fails to write to a buffer with space");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_spsc_write_wait(spsc, index, WAIT_TIMEOUT_MS), "rc!=CIRC_BUFF_FULL after the timeout");
+    for(index=0; index<WAIT_SIZE; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_read_wait(spsc, &data, 0), "Fails to read from a buffer with data");
+
+    /*both sides block: the buffer is tiny and the producer stalls now and then*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, pthread_create(&producer, NULL, spsc_wait_producer, spsc), "Fails to start the producer");
+    for(index=0; index<WAIT_COUNT; index++)
+    {
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_read_wait(spsc, &data, -1), "read_wait fails without a timeout");
+         if(data!=index)
+              mismatches++;
+    }
+    pthread_join(producer, NULL);
+
+    fprintf(fp, "spsc blocking: %u elements, %u mismatches\n", WAIT_COUNT, mismatches);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, mismatches, "elements were lost, duplicated or reordered");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_destroy(spsc), "Destroy func does not return properly");
+}
+
+/*child side of the two process test: attach by name and produce*/
+static int shm_producer_process(void)
+{
+    circ_buff_spsc_ptr spsc=NULL;
+    uint32_t index;
+
+    /*a fresh mapping, so not at the parent's address*/
+    if(circ_buff_spsc_shm_attach(&spsc, SHM_NAME)!=CIRC_BUFF_SUCCESS)
+         return 1;
+
+    for(index=0; index<SHM_COUNT; index++)
+    {
+         while(circ_buff_spsc_write(spsc, index)==CIRC_BUFF_FULL)
+              sched_yield();
+    }
+    circ_buff_spsc_detach(spsc);
+    return 0;
+}
+
+void test_spsc_two_process(void)
+{
+    circ_buff_spsc_ptr spsc=NULL, bad=NULL;
+    uint32_t index, data, mismatches=0;
+    struct timespec start, end;
+    int status;
+
+    /*a stale object from an earlier crashed run would make create fail*/
+    circ_buff_spsc_shm_unlink(SHM_NAME);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FILE_OPEN_FAILED, circ_buff_spsc_shm_attach(&bad, SHM_NAME), "attached to an object that does not exist");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_shm_create(&spsc, SHM_NAME, SHM_SIZE), "Fails to create the shared buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FILE_OPEN_FAILED, circ_buff_spsc_shm_create(&bad, SHM_NAME, SHM_SIZE), "created the same name twice");
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t child=fork();
+    if(child==0)
+         _exit(shm_producer_process());
+    TEST_ASSERT_TRUE_MESSAGE(child>0, "fork fails");
+
+    /*every value must show up exactly once and in order*/
+    for(index=0; index<SHM_COUNT; index++)
+    {
+         while(circ_buff_spsc_read(spsc, &data)==CIRC_BUFF_EMPTY)
+              sched_yield();
+         if(data!=index)
+              mismatches++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    waitpid(child, &status, 0);
+
+    double seconds=(end.tv_sec-start.tv_sec)+(end.tv_nsec-start.tv_nsec)*1e-9;
+    fprintf(fp, "spsc two process: %u elements in %.3f s, %.1f Melem/s, %u mismatches\n",
+            SHM_COUNT, seconds, SHM_COUNT/seconds/1e6, mismatches);
+
+    TEST_ASSERT_TRUE_MESSAGE(WIFEXITED(status)&&WEXITSTATUS(status)==0, "producer process fails");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, mismatches, "elements were lost, duplicated or reordered");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_detach(spsc), "Fails to detach");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_shm_unlink(SHM_NAME), "Fails to unlink");
+}
+
+void test_mpmc_write_read(void)
+{
+    circ_buff_mpmc_ptr mpmc=NULL;
+    uint32_t index, data;
+
+    /*invalid arguments*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_NULL_PTR, circ_buff_mpmc_init(NULL, MPMC_SIZE), "rc!=CIRC_BUFF_NULL_PTR for a NULL pointer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_mpmc_init(&mpmc, -1), "rc!=CIRC_BUFF_BAD_DATA for a negative size");
+
+    /*the capacity is rounded up to a power of two*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_mpmc_init(&mpmc, MPMC_SIZE), "Fails to create the mpmc buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(128, mpmc->total_size, "capacity is not rounded up to a power of two");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_mpmc_read(mpmc, &data), "rc!=CIRC_BUFF_EMPTY on an empty buffer");
+
+    /*three laps around the buffer*/
+    for(index=0; index<3*mpmc->total_size; index++)
+    {
+         if(index%mpmc->total_size==0&&index!=0)
+         {
+              /*the previous lap filled it*/
+              TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_mpmc_write(mpmc, index), "rc!=CIRC_BUFF_FULL on a full buffer");
+              uint32_t drain;
+              for(drain=index-mpmc->total_size; drain<index; drain++)
+              {
+                   TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_mpmc_read(mpmc, &data), "Fails to read from a buffer with data");
+                   TEST_ASSERT_EQUAL_INT_MESSAGE(drain, data, "data read out of order");
+              }
+              TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_mpmc_read(mpmc, &data), "rc!=CIRC_BUFF_EMPTY after draining");
+         }
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_mpmc_write(mpmc, index), "Fails to write to a buffer with space");
+    }
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_mpmc_destroy(mpmc), "Destroy func does not return properly");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_NULL_PTR, circ_buff_mpmc_destroy(NULL), "rc!=CIRC_BUFF_NULL_PTR for a NULL pointer");
+}
+
+
+/*shared state of the mpmc stress test*/
+static circ_buff_mpmc_ptr stress_mpmc;
+static _Atomic uint8_t mpmc_seen[MPMC_THREADS*MPMC_PER_THREAD];
+static _Atomic uint32_t mpmc_consumed, mpmc_out_of_order;
+
+/*producer 'id' writes id*MPMC_PER_THREAD .. (id+1)*MPMC_PER_THREAD-1 in order*/
+static void* mpmc_producer(void* arg)
+{
+    uint32_t id=(uint32_t)(uintptr_t)arg, index;
+
+    for(index=id*MPMC_PER_THREAD; index<(id+1)*MPMC_PER_THREAD; index++)
+    {
+         while(circ_buff_mpmc_write(stress_mpmc, index)==CIRC_BUFF_FULL)
+              sched_yield();
+    }
+    return NULL;
+}
+
+/*consumers mark what they see; each producer's values must reach a consumer in order*/
+static void* mpmc_consumer(void* arg)
+{
+    uint32_t last[MPMC_THREADS], data, index;
+    (void)arg;
+
+    for(index=0; index<MPMC_THREADS; index++)
+         last[index]=UINT32_MAX;
+
+    while(atomic_load(&mpmc_consumed)<MPMC_THREADS*MPMC_PER_THREAD)
+    {
+         if(circ_buff_mpmc_read(stress_mpmc, &data)!=CIRC_BUFF_SUCCESS)
+         {
+              sched_yield();
+              continue;
+         }
+         uint32_t producer=data/MPMC_PER_THREAD;
+         if(last[producer]!=UINT32_MAX&&data<=last[producer])
+              atomic_fetch_add(&mpmc_out_of_order, 1);
+         last[producer]=data;
+         atomic_fetch_add(&mpmc_seen[data], 1);
+         atomic_fetch_add(&mpmc_consumed, 1);
+    }
+    return NULL;
+}
+
+#ifdef CIRC_BUFF_STATS
+/*short lived threads for the stats block churn: one writes MPMC_CHURN_COUNT, one reads them*/
+static void* mpmc_churn_writer(void* arg)
+{
+    uint32_t index;
+
+    for(index=0; index<MPMC_CHURN_COUNT; index++)
+    {
+         while(circ_buff_mpmc_write((circ_buff_mpmc_ptr)arg, index)==CIRC_BUFF_FULL)
+              sched_yield();
+    }
+    return NULL;
+}
+
+static void* mpmc_churn_reader(void* arg)
+{
+    uint32_t index, data;
+
+    for(index=0; index<MPMC_CHURN_COUNT; index++)
+    {
+         while(circ_buff_mpmc_read((circ_buff_mpmc_ptr)arg, &data)==CIRC_BUFF_EMPTY)
+              sched_yield();
+    }
+    return NULL;
+}
+#endif
+
+void test_mpmc_threaded_stress(void)
+{
+    pthread_t producers[MPMC_THREADS], consumers[MPMC_THREADS];
+    uint32_t index, missing=0, duplicated=0;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_mpmc_init(&stress_mpmc, MPMC_SIZE), "Fails to create the mpmc buffer");
+
+    for(index=0; index<MPMC_THREADS; index++)
+    {
+         pthread_create(&consumers[index], NULL, mpmc_consumer, NULL);
+         pthread_create(&producers[index], NULL, mpmc_producer, (void*)(uintptr_t)index);
+    }
+    for(index=0; index<MPMC_THREADS; index++)
+    {
+         pthread_join(producers[index], NULL);
+         pthread_join(consumers[index], NULL);
+    }
+
+    /*every value exactly once*/
+    for(index=0; index<MPMC_THREADS*MPMC_PER_THREAD; index++)
+    {
+         if(mpmc_seen[index]==0)
+              missing++;
+         else if(mpmc_seen[index]>1)
+              duplicated++;
+    }
+    fprintf(fp, "mpmc stress: %u threads a side, %u missing, %u duplicated, %u out of order\n",
+            MPMC_THREADS, missing, duplicated, (uint32_t)mpmc_out_of_order);
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, missing, "elements were lost");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, duplicated, "elements were duplicated");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, mpmc_out_of_order, "a producer's elements were reordered");
+#ifdef CIRC_BUFF_STATS
+    circ_buff_stats stats;
+    circ_buff_mpmc_stats_get(stress_mpmc, &stats);
+    fprintf(fp, "mpmc stress stats: %llu full, %llu empty, high water %u, residency p50 %llu ns p99 %llu ns\n",
+            (unsigned long long)stats.full, (unsigned long long)stats.empty, stats.high_water,
+            (unsigned long long)circ_buff_stats_percentile(&stats, 50), (unsigned long long)circ_buff_stats_percentile(&stats, 99));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(MPMC_THREADS*MPMC_PER_THREAD, stats.writes, "mpmc writes miscounted");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(MPMC_THREADS*MPMC_PER_THREAD, stats.reads, "mpmc reads miscounted");
+    TEST_ASSERT_TRUE_MESSAGE(stats.high_water<=stress_mpmc->total_size, "mpmc high water above the capacity");
+#endif
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_mpmc_destroy(stress_mpmc), "Destroy func does not return properly");
+
+#ifdef CIRC_BUFF_STATS
+    /*many more threads than stats blocks come and go, two at a time; exited threads give their blocks back*/
+    circ_buff_mpmc_ptr churn=NULL;
+    uint32_t round, blocks_used=0;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_mpmc_init(&churn, MPMC_SIZE), "Fails to create the mpmc buffer");
+    for(round=0; round<2*CIRC_BUFF_MPMC_STATS_THREADS; round++)
+    {
+         pthread_create(&producers[0], NULL, mpmc_churn_writer, churn);
+         pthread_create(&consumers[0], NULL, mpmc_churn_reader, churn);
+         pthread_join(producers[0], NULL);
+         pthread_join(consumers[0], NULL);
+    }
+    for(index=0; index<CIRC_BUFF_MPMC_STATS_THREADS; index++)
+         blocks_used+=churn->thread_stats[index].stats.writes+churn->thread_stats[index].stats.reads!=0;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(2, blocks_used, "exited threads do not give their stats blocks back");
+    circ_buff_mpmc_stats_get(churn, &stats);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(2*CIRC_BUFF_MPMC_STATS_THREADS*MPMC_CHURN_COUNT, stats.writes, "mpmc writes miscounted under thread churn");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(2*CIRC_BUFF_MPMC_STATS_THREADS*MPMC_CHURN_COUNT, stats.reads, "mpmc reads miscounted under thread churn");
+    circ_buff_mpmc_destroy(churn);
+#endif
+}
+
+void test_msg_ring(void)
+{
+    circ_buff_msg_ptr mb=NULL;
+    circ_buff_msg_record record, records[16], batch[10];
+    uint8_t payload[256], out[256];
+    uint32_t index, length, count, bytes, written, sequence, lengths[64], starts[64], first, last;
+    void *slot;
+
+    for(index=0; index<sizeof(payload); index++)
+         payload[index]=(uint8_t)index;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_init(&mb, 256), "Fails to create the message ring");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_msg_peek(mb, &record), "empty ring hands out a record");
+
+    /*records come back whole, in place and 8 byte aligned*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_write(mb, "hello", 5), "Fails to write a record");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_write(mb, NULL, 0), "Fails to write an empty record");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_count(mb, &count, &bytes), "Fails to count");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(2, count, "record count is wrong");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(24, bytes, "header and padding bytes are wrong");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_peek(mb, &record), "Fails to peek");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(5, record.length, "peeked length is wrong");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, (uintptr_t)record.data%CIRC_BUFF_MSG_ALIGN, "record is not 8 byte aligned");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, memcmp(record.data, "hello", 5), "peeked data is wrong");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_msg_read(mb, out, 4, &length), "short buffer is not refused");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(5, length, "needed length not reported");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_read(mb, out, sizeof(out), &length), "Fails to read");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, memcmp(out, "hello", 5), "read data is wrong");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_read(mb, out, sizeof(out), &length), "Fails to read an empty record");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, length, "empty record has a length");
+
+    /*the largest record fills the whole storage*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_msg_write(mb, payload, 249), "oversized record is not refused");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_write(mb, payload, 248), "Fails to write the largest record");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_msg_write(mb, NULL, 0), "full ring takes a record");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_read(mb, out, sizeof(out), &length), "Fails to read the largest record");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, memcmp(out, payload, 248), "largest record is wrong");
+
+    /*a record that would wrap starts again at offset zero behind a skip marker*/
+    circ_buff_msg_destroy(mb);
+    circ_buff_msg_init(&mb, 256);
+    for(index=0; index<3; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_write(mb, payload, 60), "Fails to write");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_release(mb, 2), "Fails to release");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_reserve(mb, 50, &slot), "Fails to reserve across the end");
+    TEST_ASSERT_EQUAL_PTR_MESSAGE(mb->base+sizeof(circ_buff_msg_header), slot, "wrapped record does not start at offset zero");
+    memcpy(slot, payload+100, 50);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_commit(mb, 50), "Fails to commit");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_release(mb, 1), "Fails to release");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_peek(mb, &record), "Fails to peek past the skip marker");
+    TEST_ASSERT_EQUAL_PTR_MESSAGE(slot, record.data, "skip marker not stepped over");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, memcmp(record.data, payload+100, 50), "wrapped record is not contiguous");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_msg_release(mb, 2), "over release is not refused");
+    circ_buff_msg_release(mb, 1);
+
+    /*batches go in and come out in order*/
+    for(index=0; index<10; index++)
+    {
+         batch[index].data=payload+index;
+         batch[index].length=index*2;
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_write_batch(mb, batch, 10, &written), "Fails to write a batch");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(10, written, "batch partly written");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_msg_write_batch(mb, batch, 10, &written), "overfull batch not reported");
+    TEST_ASSERT_TRUE_MESSAGE(written<10, "overfull batch fully written");
+    first=10+written;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_read_batch(mb, records, 16, &count), "Fails to read a batch");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(first<16 ? first : 16, count, "batch read count is wrong");
+    for(index=0; index<count; index++)
+    {
+         TEST_ASSERT_EQUAL_INT_MESSAGE((index%10)*2, records[index].length, "batch length is wrong");
+         TEST_ASSERT_EQUAL_INT_MESSAGE(0, (uintptr_t)records[index].data%CIRC_BUFF_MSG_ALIGN, "batch record is not aligned");
+         TEST_ASSERT_EQUAL_INT_MESSAGE(0, memcmp(records[index].data, payload+index%10, records[index].length), "batch data is wrong");
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_release(mb, count), "Fails to release a batch");
+    circ_buff_msg_count(mb, &count, NULL);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(first>16 ? first-16 : 0, count, "batch release count is wrong");
+    circ_buff_msg_release(mb, count);
+
+    /*many laps of mixed lengths against a list of what was written*/
+    first=0;
+    last=0;
+    for(sequence=0; sequence<20000; sequence++)
+    {
+         length=(sequence*37)%120;
+         if(circ_buff_msg_write(mb, payload+sequence%100, length)==CIRC_BUFF_SUCCESS)
+         {
+              lengths[last%64]=length;
+              starts[last%64]=sequence%100;
+              last++;
+         }
+         else
+         {
+              while(first!=last&&(first+sequence)%3!=0)
+              {
+                   TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_read(mb, out, sizeof(out), &length), "Fails to read in the laps");
+                   TEST_ASSERT_EQUAL_INT_MESSAGE(lengths[first%64], length, "lap record length is wrong");
+                   TEST_ASSERT_EQUAL_INT_MESSAGE(0, memcmp(out, payload+starts[first%64], length), "lap record data is wrong");
+                   first++;
+              }
+              if(first!=last)
+              {
+                   circ_buff_msg_release(mb, 1);
+                   first++;
+              }
+         }
+    }
+    circ_buff_msg_count(mb, &count, NULL);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(last-first, count, "records lost over the laps");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_msg_destroy(mb), "Destroy func does not return properly");
+}
+
+void test_bcast_write_read(void)
+{
+    circ_buff_bcast_ptr bc=NULL;
+    uint32_t index, data, first, second, spare, count, values[16];
+    uint64_t dropped;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_bcast_init(&bc, BCAST_SIZE, 0, CIRC_BUFF_MODE_DEFAULT), "zero readers is not refused");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_init(&bc, BCAST_SIZE, 2, CIRC_BUFF_MODE_DEFAULT), "Fails to create the broadcast buffer");
+
+    /*with nobody listening the writer never waits*/
+    for(index=0; index<3*BCAST_SIZE; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_write(bc, index), "Fails to write without readers");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_register(bc, &first), "Fails to register a reader");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_register(bc, &second), "Fails to register a second reader");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_bcast_register(bc, &spare), "more readers than cursors");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_bcast_read(bc, first, &data), "new reader sees old data");
+
+    /*both readers see every element; the slower one gates the writer*/
+    for(index=0; index<BCAST_SIZE; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_write(bc, 100+index), "Fails to write");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_bcast_write(bc, 0), "writer overruns the readers");
+    for(index=0; index<BCAST_SIZE; index++)
+    {
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_read(bc, first, &data), "Fails to read");
+         TEST_ASSERT_EQUAL_INT_MESSAGE(100+index, data, "first reader gets the wrong data");
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_bcast_write(bc, 0), "writer overruns the slow reader");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_read_bulk(bc, second, values, 2, &count), "Fails to bulk read");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(2, count, "bulk read count is wrong");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(101, values[1], "second reader gets the wrong data");
+    for(index=0; index<16; index++)
+         values[index]=200+index;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_bcast_write_bulk(bc, values, 16, &count), "bulk write overruns the slow reader");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(2, count, "bulk write does not fill the room left");
+
+    /*once the slow reader leaves, only the fast one counts*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_unregister(bc, second), "Fails to unregister");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_bcast_unregister(bc, second), "double unregister is not refused");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_write(bc, 300), "slow reader still gates after leaving");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_read_bulk(bc, first, values, 16, &count), "Fails to bulk read");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(3, count, "fast reader misses data");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(200, values[0], "fast reader gets the wrong data");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(300, values[2], "fast reader gets the wrong data");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_destroy(bc), "Destroy func does not return properly");
+
+    /*lossy: a lapped reader skips to the oldest element held*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_init(&bc, BCAST_SIZE, 1, CIRC_BUFF_MODE_OVERWRITE), "Fails to create the lossy buffer");
+    circ_buff_bcast_register(bc, &first);
+    for(index=0; index<20; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_write(bc, index), "lossy writer waits");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_read_bulk(bc, first, values, 16, &count), "Fails to read when lapped");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(BCAST_SIZE, count, "lapped reader does not get a whole buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(20-BCAST_SIZE, values[0], "lapped reader does not resume at the oldest element");
+    circ_buff_bcast_dropped(bc, first, &dropped);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(20-BCAST_SIZE, dropped, "lapped elements miscounted");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_destroy(bc), "Destroy func does not return properly");
+}
+
+static circ_buff_bcast_ptr stress_bcast;
+static _Atomic uint32_t bcast_bad;
+
+static void* bcast_writer(void* arg)
+{
+    uint32_t index;
+    (void)arg;
+
+    for(index=0; index<BCAST_COUNT; index++)
+    {
+         while(circ_buff_bcast_write(stress_bcast, index)==CIRC_BUFF_FULL)
+              sched_yield();
+    }
+    return NULL;
+}
+
+/*every reader must see the whole stream in order; in the lossy mode it may
+ *skip, but what it reads plus what it drops is still the whole stream*/
+static void* bcast_reader(void* arg)
+{
+    uint32_t reader=(uint32_t)(uintptr_t)arg;
+    uint32_t values[64], count, index, expect=0;
+    uint64_t dropped=0, skipped=0;
+
+    while(expect<BCAST_COUNT)
+    {
+         if(circ_buff_bcast_read_bulk(stress_bcast, reader, values, 64, &count)!=CIRC_BUFF_SUCCESS)
+         {
+              sched_yield();
+              continue;
+         }
+         for(index=0; index<count; index++)
+         {
+              if(values[index]<expect)
+                   atomic_fetch_add(&bcast_bad, 1);
+              else
+              {
+                   skipped+=values[index]-expect;
+                   expect=values[index]+1;
+              }
+         }
+    }
+    circ_buff_bcast_dropped(stress_bcast, reader, &dropped);
+    if(skipped!=dropped)
+         atomic_fetch_add(&bcast_bad, 1);
+    return NULL;
+}
+
+void test_bcast_threaded_stress(void)
+{
+    pthread_t writer, readers[BCAST_READERS];
+    uint32_t index, reader, mode;
+    uint64_t dropped;
+
+    for(mode=0; mode<2; mode++)
+    {
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_init(&stress_bcast, SPSC_SIZE, BCAST_READERS,
+                                       mode ? CIRC_BUFF_MODE_OVERWRITE : CIRC_BUFF_MODE_DEFAULT), "Fails to create the broadcast buffer");
+         atomic_store(&bcast_bad, 0);
+         for(index=0; index<BCAST_READERS; index++)
+         {
+              TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_register(stress_bcast, &reader), "Fails to register");
+              TEST_ASSERT_EQUAL_INT_MESSAGE(0, pthread_create(&readers[index], NULL, bcast_reader, (void*)(uintptr_t)reader), "Fails to start a reader");
+         }
+         TEST_ASSERT_EQUAL_INT_MESSAGE(0, pthread_create(&writer, NULL, bcast_writer, NULL), "Fails to start the writer");
+
+         pthread_join(writer, NULL);
+         for(index=0; index<BCAST_READERS; index++)
+              pthread_join(readers[index], NULL);
+
+         dropped=0;
+         for(index=0; index<BCAST_READERS; index++)
+         {
+              uint64_t reader_dropped;
+              circ_buff_bcast_dropped(stress_bcast, index, &reader_dropped);
+              dropped+=reader_dropped;
+         }
+         fprintf(fp, "bcast stress (%s): %u elements to %u readers, %llu dropped, %u errors\n", mode ? "lossy" : "gated",
+                 BCAST_COUNT, BCAST_READERS, (unsigned long long)dropped, atomic_load(&bcast_bad));
+         TEST_ASSERT_EQUAL_INT_MESSAGE(0, atomic_load(&bcast_bad), "readers saw data out of order or miscounted drops");
+         if(!mode)
+              TEST_ASSERT_EQUAL_INT_MESSAGE(0, dropped, "gated readers dropped data");
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_bcast_destroy(stress_bcast), "Destroy func does not return properly");
+    }
+}
+
+/*Unit test for the sharded buffer*/
+void test_shard_write_read(void)
+{
+    circ_buff_shard_ptr sh=NULL;
+    uint32_t index, data, count, values[16];
+    uint64_t stolen;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_shard_init(&sh, 0, 8, 2), "zero shards are accepted");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_shard_init(&sh, 4, 8, 0), "zero consumers are accepted");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_shard_init(&sh, 4, SHARD_SIZE, 2), "Fails to create the sharded buffer");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_shard_write(sh, 4, 0), "a missing shard is written");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_shard_read(sh, 2, &data), "a missing consumer reads");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_shard_read(sh, 0, &data), "an empty buffer reads");
+
+    /*consumer 0 owns shards 0 and 2, consumer 1 owns 1 and 3*/
+    for(index=0; index<SHARD_SIZE; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_shard_write(sh, 0, index), "Fails to fill a shard");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_shard_write(sh, 0, 0), "a full shard is written");
+    for(index=0; index<6; index++)
+         circ_buff_shard_write(sh, 3, 100+index);
+
+    /*home first and in order*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_shard_read(sh, 0, &data), "Fails to read a home shard");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, data, "home shard read out of order");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_shard_read_n(sh, 0, values, 16, &count), "Fails to drain a home shard");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(SHARD_SIZE-1, count, "home shard drained wrongly");
+    for(index=0; index<count; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(1+index, values[index], "home shard drained out of order");
+
+    /*then from the fullest other shard, at most half of it per steal*/
+    circ_buff_shard_write(sh, 1, 200);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_shard_read(sh, 0, &data), "Fails to steal");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(100, data, "steals from the wrong shard");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_shard_steal(sh, 0, values, 16, &count), "Fails to steal a batch");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(3, count, "steals more than half");
+    for(index=0; index<count; index++)
+         TEST_ASSERT_EQUAL_INT_MESSAGE(101+index, values[index], "steals out of order");
+    circ_buff_shard_stolen(sh, 0, &stolen);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(4, stolen, "steals miscounted");
+
+    /*a consumer never steals from itself, and the owner gets the rest*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_shard_steal(sh, 1, values, 16, &count), "steals with nothing to steal");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_shard_read_n(sh, 1, values, 16, &count), "Fails to read the home shards");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(3, count, "home shards read wrongly");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_shard_read(sh, 1, &data), "a drained buffer reads");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_shard_destroy(sh), "Destroy func does not return properly");
+}
+
+static circ_buff_shard_ptr stress_shard;
+static _Atomic uint32_t shard_consumed, shard_bad;
+
+/*producer 'id' writes id<<24 .. id<<24|SHARD_COUNT-1 to its own shard*/
+static void* shard_producer(void* arg)
+{
+    uint32_t id=(uint32_t)(uintptr_t)arg, index, written;
+    uint32_t values[16];
+
+    for(index=0; index<SHARD_COUNT; index+=written)
+    {
+         uint32_t chunk, count=SHARD_COUNT-index<16 ? SHARD_COUNT-index : 16;
+         for(chunk=0; chunk<count; chunk++)
+              values[chunk]=id<<24|(index+chunk);
+         if(circ_buff_shard_write_n(stress_shard, id, values, count, &written)==CIRC_BUFF_FULL&&written==0)
+              sched_yield();
+    }
+    return NULL;
+}
+
+/*each shard must reach each consumer in order, and the sum checks nothing is lost*/
+static void* shard_consumer(void* arg)
+{
+    uint32_t id=(uint32_t)(uintptr_t)arg, last[SHARD_PRODUCERS], values[16], count, index;
+
+    for(index=0; index<SHARD_PRODUCERS; index++)
+         last[index]=UINT32_MAX;
+
+    while(atomic_load(&shard_consumed)<SHARD_PRODUCERS*SHARD_COUNT)
+    {
+         if(circ_buff_shard_read_n(stress_shard, id, values, 16, &count)!=CIRC_BUFF_SUCCESS)
+         {
+              sched_yield();
+              continue;
+         }
+         for(index=0; index<count; index++)
+         {
+              uint32_t producer=values[index]>>24, sequence=values[index]&0xffffff;
+              if(producer>=SHARD_PRODUCERS||(last[producer]!=UINT32_MAX&&sequence<=last[producer]))
+                   atomic_fetch_add(&shard_bad, 1);
+              else
+                   last[producer]=sequence;
+         }
+         atomic_fetch_add(&shard_consumed, count);
+    }
+    return NULL;
+}
+
+void test_shard_threaded_stress(void)
+{
+    pthread_t producers[SHARD_PRODUCERS], consumers[SHARD_CONSUMERS];
+    uint32_t index;
+    uint64_t stolen, total=0;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_shard_init(&stress_shard, SHARD_PRODUCERS, SPSC_SIZE, SHARD_CONSUMERS),
+                                  "Fails to create the sharded buffer");
+    for(index=0; index<SHARD_CONSUMERS; index++)
+         pthread_create(&consumers[index], NULL, shard_consumer, (void*)(uintptr_t)index);
+    for(index=0; index<SHARD_PRODUCERS; index++)
+         pthread_create(&producers[index], NULL, shard_producer, (void*)(uintptr_t)index);
+    for(index=0; index<SHARD_PRODUCERS; index++)
+         pthread_join(producers[index], NULL);
+    for(index=0; index<SHARD_CONSUMERS; index++)
+    {
+         pthread_join(consumers[index], NULL);
+         circ_buff_shard_stolen(stress_shard, index, &stolen);
+         total+=stolen;
+    }
+
+    fprintf(fp, "shard stress: %u producers, %u consumers, %u consumed, %llu stolen, %u errors\n", SHARD_PRODUCERS, SHARD_CONSUMERS,
+            atomic_load(&shard_consumed), (unsigned long long)total, atomic_load(&shard_bad));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, atomic_load(&shard_bad), "a shard was read out of order");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(SHARD_PRODUCERS*SHARD_COUNT, atomic_load(&shard_consumed), "elements were lost or duplicated");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_shard_destroy(stress_shard), "Destroy func does not return properly");
+}
+
+/*Unit test for the sliding time window, checked against a plain pass over the same samples*/
+void test_window(void)
+{
+    static uint32_t values[WINDOW_SAMPLES];
+    static uint64_t stamps[WINDOW_SAMPLES];
+    circ_buff_window_ptr win=NULL;
+    circ_buff_window_summary summary;
+    uint32_t index, oldest=0, bad=0;
+    uint64_t stamp=0;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_window_init(&win, 16, 0, CIRC_BUFF_MODE_DEFAULT), "zero span is accepted");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_window_init(&win, WINDOW_SIZE, WINDOW_SPAN, CIRC_BUFF_MODE_DEFAULT),
+                                  "Fails to create the window");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_window_query(win, 0, &summary), "an empty window has data");
+
+    srand(7);
+    for(index=0; index<WINDOW_SAMPLES; index++)
+    {
+         stamp+=rand()%4;
+         values[index]=(uint32_t)rand();
+         stamps[index]=stamp;
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_window_write(win, stamp, values[index]), "Fails to write");
+
+         /*the plain way: walk everything still inside the span*/
+         while(stamp-stamps[oldest]>=WINDOW_SPAN)
+              oldest++;
+         uint32_t scan, min=UINT32_MAX, max=0;
+         uint64_t sum=0;
+         for(scan=oldest; scan<=index; scan++)
+         {
+              sum+=values[scan];
+              min=values[scan]<min ? values[scan] : min;
+              max=values[scan]>max ? values[scan] : max;
+         }
+         circ_buff_window_query(win, stamp, &summary);
+         if(summary.count!=index-oldest+1||summary.sum!=sum||summary.min!=min||summary.max!=max)
+              bad++;
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, bad, "window aggregates differ from a full pass");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_window_write(win, stamp-1, 0), "a stamp going backwards is accepted");
+
+    /*everything expires once the clock moves a whole span on*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_EMPTY, circ_buff_window_query(win, stamp+WINDOW_SPAN, &summary), "old data does not expire");
+    circ_buff_window_destroy(win);
+
+    /*a full window refuses, or with overwrite evicts the oldest early*/
+    circ_buff_window_init(&win, 4, 1000, CIRC_BUFF_MODE_DEFAULT);
+    for(index=0; index<4; index++)
+         circ_buff_window_write(win, index, 10*(index+1));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_FULL, circ_buff_window_write(win, 5, 1), "a full window is written");
+    circ_buff_window_destroy(win);
+    circ_buff_window_init(&win, 4, 1000, CIRC_BUFF_MODE_OVERWRITE);
+    for(index=0; index<4; index++)
+         circ_buff_window_write(win, index, 10*(index+1));
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_window_write(win, 5, 1), "Fails to overwrite");
+    circ_buff_window_query(win, 5, &summary);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(4, summary.count, "overwrite miscounts");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(1, summary.min, "overwrite min is wrong");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(40, summary.max, "overwrite max is wrong");
+    TEST_ASSERT_EQUAL_UINT64_MESSAGE(91, summary.sum, "overwrite sum is wrong");
+    TEST_ASSERT_EQUAL_UINT64_MESSAGE(1, summary.dropped, "overwrite drops miscounted");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_window_destroy(win), "Destroy func does not return properly");
+}
+
+/*Unit test for the background drain, through io_uring where the kernel allows it and through pwritev*/
+void test_drain(void)
+{
+    circ_buff_spsc_ptr ring=NULL;
+    circ_buff_drain_ptr drain=NULL;
+    circ_buff_drain_config config={DRAIN_FLUSH_BYTES, 1000, 0, 0};
+    circ_buff_drain_status status;
+    char path[]="/tmp/test_circ_buff_drainXXXXXX";
+    static uint32_t values[DRAIN_COUNT];
+    uint32_t index, pass, bad;
+
+    int fd=mkstemp(path);
+    TEST_ASSERT_TRUE_MESSAGE(fd>=0, "Fails to create the drain file");
+    unlink(path);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_spsc_init(&ring, SPSC_SIZE), "Fails to create the ring");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_BAD_DATA, circ_buff_drain_start(&drain, ring, -1, NULL), "a bad descriptor is accepted");
+
+    for(pass=0; pass<2; pass++)
+    {
+         config.flags=pass ? CIRC_BUFF_DRAIN_PWRITEV : 0;
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_drain_start(&drain, ring, fd, &config), "Fails to start the drain");
+
+         /*a trickle is written within the latency bound, without filling a batch*/
+         for(index=0; index<10; index++)
+              circ_buff_spsc_write(ring, index);
+         for(index=0; index<200; index++)
+         {
+              circ_buff_drain_status_get(drain, &status);
+              if(status.elements==10)
+                   break;
+              usleep(1000);
+         }
+         TEST_ASSERT_EQUAL_UINT64_MESSAGE(10, status.elements, "a part batch is not flushed in time");
+
+         /*then a stream much bigger than the ring*/
+         for(index=10; index<DRAIN_COUNT; index++)
+              circ_buff_spsc_write_wait(ring, index, -1);
+         circ_buff_drain_status_get(drain, &status);
+         TEST_ASSERT_EQUAL_INT_MESSAGE(0, status.error, "a drain write fails");
+         fprintf(fp, "drain (%s): %llu flushes, %llu stalls\n", status.uring ? "io_uring" : "pwritev",
+                 (unsigned long long)status.flushes, (unsigned long long)status.stalls);
+         TEST_ASSERT_EQUAL_INT_MESSAGE(CIRC_BUFF_SUCCESS, circ_buff_drain_stop(drain), "Fails to stop the drain");
+    }
+
+    /*both passes are in the file back to back, in order*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(2*sizeof(values), lseek(fd, 0, SEEK_CUR), "the file offset is not left at the end");
+    for(pass=0; pass<2; pass++)
+    {
+         TEST_ASSERT_EQUAL_INT_MESSAGE(sizeof(values), pread(fd, values, sizeof(values), pass*sizeof(values)), "Fails to read the file back");
+         for(bad=0, index=0; index<DRAIN_COUNT; index++)
+              bad+=values[index]!=index;
+         TEST_ASSERT_EQUAL_INT_MESSAGE(0, bad, "the file does not hold the stream in order");
+    }
+    close(fd);
+    circ_buff_spsc_destroy(ring);
+}
+
+int main()
+{
+    fp=fopen(RESULTS_FILE, "a");
+
+    UNITY_BEGIN();
+    RUN_TEST(test_write_read);
+
+    RUN_TEST(test_bulk_write_read);
+
+    RUN_TEST(test_reserve_commit);
+
+    RUN_TEST(test_pow2_mode);
+
+    RUN_TEST(test_overwrite_mode);
+
+    RUN_TEST(test_mirror_mode);
+
+    RUN_TEST(test_dump);
+
+    RUN_TEST(test_snapshot);
+
+    RUN_TEST(test_resize);
+
+    RUN_TEST(test_iter_scan);
+
+    RUN_TEST(test_storage);
+
+#ifdef CIRC_BUFF_STATS
+    RUN_TEST(test_stats);
+#endif
+
+    RUN_TEST(test_typed_rings);
+
+    fprintf(fp, "\n\nUnit test for the spsc circular buffer:\n\n");
+    RUN_TEST(test_spsc_write_read);
+
+    RUN_TEST(test_spsc_two_thread_stress);
+
+    RUN_TEST(test_spsc_blocking);
+
+    RUN_TEST(test_spsc_two_process);
+
+    fprintf(fp, "\n\nUnit test for the mpmc circular buffer:\n\n");
+    RUN_TEST(test_mpmc_write_read);
+
+    RUN_TEST(test_mpmc_threaded_stress);
+
+    fprintf(fp, "\n\nUnit test for the message ring:\n\n");
+    RUN_TEST(test_msg_ring);
+
+    fprintf(fp, "\n\nUnit test for the broadcast circular buffer:\n\n");
+    RUN_TEST(test_bcast_write_read);
+
+    RUN_TEST(test_bcast_threaded_stress);
+
+    RUN_TEST(test_shard_write_read);
+
+    RUN_TEST(test_shard_threaded_stress);
+
+    RUN_TEST(test_window);
+
+    RUN_TEST(test_drain);
+
+    fclose(fp);
+    return UNITY_END();
+}
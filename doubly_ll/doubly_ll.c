@@ -14,8 +14,189 @@
 #include<stdlib.h>
 #include<stdio.h>
 
-//#define DEBUG
 //#define DEBUG_SEARCH 
+
+
+/*								                
+ * Function:     dll_list_wrap(dll_node_ptr head, dll_list_ptr list)
+ * -----------------------------------------------------------------------------
+ * Description:  Fills in a header for the bare dll starting at head, so that
+ *               the head pointer functions can share the dll_list ones. Finding
+ *               the tail and the count takes one walk of the dll, which these
+ *               functions paid for in dll_size at any non-zero position.
+ *               Position zero never needs it and does not call this.
+ * ----------------------------------------------------------------------------
+ */
+static void dll_list_wrap(dll_node_ptr head, dll_list_ptr list)
+{
+    list->head=head;
+    list->tail=NULL;
+    list->count=0;
+    list->pool=NULL;                                                        //bare dlls are always malloc'd
+    list->own_pool=0;
+
+    /*walk to the last node, counting on the way*/
+    while(head!=NULL)
+    {
+         list->tail=head;
+	 list->count++;
+	 head=head->next_ptr;
+    }
+}
+
+/*								                
+ * Function:     dll_list_seek(dll_list_ptr list, uint32_t position)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the node at position, which must be less than the
+ *               size of the dll. Walks forward from the head if position is
+ *               in the first half and back from the tail otherwise, so no
+ *               walk is longer than half the dll.
+ * ----------------------------------------------------------------------------
+ */
+static dll_node_ptr dll_list_seek(dll_list_ptr list, uint32_t position)
+{
+    dll_node_ptr node;
+    uint32_t index;
+
+    if(position<list->count/2)
+    {
+         node=list->head;
+         for(index=0; index<position; index++)
+              node=node->next_ptr;
+    }
+    else
+    {
+         node=list->tail;
+         for(index=list->count-1; index>position; index--)
+              node=node->prev_ptr;
+    }
+
+    return node;
+}
+
+/*								                
+ * Function:     dll_pool_grab(dll_pool_ptr pool)
+ * -----------------------------------------------------------------------------
+ * Description:  Grabs a new slab, chains it to the pool and puts all its
+ *               nodes on the free list, first node first.
+ * ----------------------------------------------------------------------------
+ */
+static dll_code dll_pool_grab(dll_pool_ptr pool)
+{
+    dll_slab_ptr slab=(dll_slab_ptr)malloc(sizeof(dll_slab)+sizeof(dll_node)*pool->slab_nodes);
+    uint32_t index;
+
+    if(slab==NULL)
+         return DLL_MALLOC_FAIL;
+
+    slab->next_slab=pool->slabs;
+    pool->slabs=slab;
+
+    /*thread the nodes onto the free list back to front*/
+    for(index=pool->slab_nodes; index>0; index--)
+    {
+         slab->nodes[index-1].next_ptr=pool->free_list;
+	 pool->free_list=&slab->nodes[index-1];
+    }
+
+    return DLL_SUCCESS;
+}
+
+/*								                
+ * Function:     dll_node_alloc(dll_list_ptr list)
+ *               dll_node_free(dll_list_ptr list, dll_node_ptr node)
+ * -----------------------------------------------------------------------------
+ * Description:  Get a node from, and give it back to, the pool of the header,
+ *               or malloc and free if it has none.
+ * ----------------------------------------------------------------------------
+ */
+static dll_node_ptr dll_node_alloc(dll_list_ptr list)
+{
+    dll_pool_ptr pool=list->pool;
+    dll_node_ptr node;
+
+    if(pool==NULL)
+         return (dll_node_ptr)malloc(sizeof(dll_node));
+
+    if(pool->free_list==NULL&&dll_pool_grab(pool)!=DLL_SUCCESS)
+         return NULL;
+
+    node=pool->free_list;
+    pool->free_list=node->next_ptr;
+    return node;
+}
+
+static void dll_node_free(dll_list_ptr list, dll_node_ptr node)
+{
+    if(list->pool==NULL)
+    {
+         free(node);
+	 return;
+    }
+
+    node->next_ptr=list->pool->free_list;
+    list->pool->free_list=node;
+}
+
+/*								                
+ * Function:     dll_list_link(dll_list_ptr list, dll_node_ptr next, uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Gets a node holding data and links it in just before
+ *               next, or after the tail if next is NULL. Keeps the head, the
+ *               tail and the count of the header up to date.
+ * ----------------------------------------------------------------------------
+ */
+static dll_code dll_list_link(dll_list_ptr list, dll_node_ptr next, uint32_t data)
+{
+    dll_node_ptr new_node=dll_node_alloc(list);                             //allocate memory
+
+    /*malloc check*/
+    if(new_node==NULL)
+         return DLL_MALLOC_FAIL;
+
+    new_node->data=data;
+    new_node->next_ptr=next;
+    new_node->prev_ptr=(next!=NULL)?next->prev_ptr:list->tail;
+
+    /*link the nodes surrounding the new node to the new node*/
+    if(new_node->prev_ptr!=NULL)
+         (new_node->prev_ptr)->next_ptr=new_node;
+    else
+         list->head=new_node;                                               //nothing before it- this is the new head
+    if(next!=NULL)
+         next->prev_ptr=new_node;
+    else
+         list->tail=new_node;                                               //nothing after it- this is the new tail
+
+    list->count++;
+    return DLL_SUCCESS;
+}
+
+/*								                
+ * Function:     dll_list_unlink(dll_list_ptr list, dll_node_ptr node, uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Links the nodes before and after node to each other, returns
+ *               the data of node in *data and gives it back. Keeps the head, the
+ *               tail and the count of the header up to date.
+ * ----------------------------------------------------------------------------
+ */
+static void dll_list_unlink(dll_list_ptr list, dll_node_ptr node, uint32_t* data)
+{
+    *data=node->data;
+
+    if(node->prev_ptr!=NULL)
+         (node->prev_ptr)->next_ptr=node->next_ptr;
+    else
+         list->head=node->next_ptr;
+    if(node->next_ptr!=NULL)
+         (node->next_ptr)->prev_ptr=node->prev_ptr;
+    else
+         list->tail=node->prev_ptr;
+
+    list->count--;
+    dll_node_free(list, node);
+}
+
 /*								                
  * Function:     dll_add_node(dll_node_ptr* head, uint32_t data, uint32_t position)
  * -----------------------------------------------------------------------------
@@ -29,11 +210,16 @@
  *               and enter zero for the position index.
  *               If a non-null head is detected with position zero, a new node
  *               will be created at position zero.
+ *               Position zero is linked in directly without walking the dll.
+ *               Any other position goes through dll_list_add; a dll_list
+ *               avoids the walk needed to find the size.
  * 
  * Returns:      Error codes:
  *               DLL_NULL_POINTER: The pointer passed is detected to be a 
  *               null. The function halts execution and returns w/o completion. 
  *        
+ *               DLL_BAD_POSITION: The position is greater than the size.
+ *
  *               DLL_MALLOC_FAIL: The call to malloc fails.
  *
  *               DLL_SUCCESS: The funcion returns successfully.
@@ -51,71 +237,29 @@ dll_code dll_add_node(dll_node_ptr* head, uint32_t position, uint32_t data)
     if(*head==NULL&&position!=0)
 	 return DLL_NULL_PTR;                                               
 
-    /*this case works even if the head is NULL*/
+    /*this case works even if the head is NULL, and needs no walk*/
     if(position==0)
     {
          dll_node_ptr new_node=(dll_node_ptr)malloc(sizeof(dll_node));      //allocate memory
-	 
 	 if(new_node==NULL)
 	      return DLL_MALLOC_FAIL;
 
 	 new_node->prev_ptr=NULL;                                           //this is now the head pointer, so the previous should be NULL
 	 new_node->next_ptr=*head;                                          //the older version of the head ptr is the next pointer for this linked list
-	 new_node->data= data;                                              //assign data
+	 new_node->data=data;                                               //assign data
 	 if(*head!=NULL)
 	      (*head)->prev_ptr=new_node;                                   //link the older head to this new node before modifying the older head
 	 *head=new_node;                                                    //position zero is always the head.
-         
 	 return DLL_SUCCESS;
     }
-    else
-    {
-         dll_node_ptr tmp_head=*head;
-         uint32_t index;
-         /*check if given position is valid*/
-         uint32_t size;
-         dll_code size_rc=dll_size(tmp_head, &size);
-
-         if(size_rc!=DLL_NULL_PTR)                                                   //only fail rc for dll_size
-         {
-              if(position>size)                                                    //the position cannot be 2 for a dll of size 2; position starts from 0
-                   return DLL_BAD_POSITION;
-         }    
-         else
-	      return DLL_NULL_PTR;
-#ifdef DEBUG 
-         printf("before traversing to p-1\n"); 
-#endif
-	 /*go to index=position-1 in the dll*/
-	 for(index=0; index<position-1; index++)
-              tmp_head=tmp_head->next_ptr; 
 
-#ifdef DEBUG         
-         printf("after traversing to p-1\n"); 
-#endif
+    /*wrap the bare dll in a header and let dll_list_add do the work*/
+    dll_list list;
+    dll_list_wrap(*head, &list);
 
-	 dll_node_ptr new_node=(dll_node_ptr)malloc(sizeof(dll_node));      //allocate memory
-	 
-	 /*malloc check*/
-	 if(new_node==NULL)
-	      return DLL_MALLOC_FAIL;
-         
-	 new_node->data=data;
-
-	 /*link the new node to the nodes before and after it in the dll*/
-	 new_node->prev_ptr=tmp_head;
-	 new_node->next_ptr=tmp_head->next_ptr;
-        
-	 /*link the nodes surrounding the new node to the new node*/ 
-         tmp_head->next_ptr=new_node;
-	 
-	 if(new_node->next_ptr!=NULL)
-	      (new_node->next_ptr)->prev_ptr=new_node;
-#ifdef DEBUG 
-         printf("after making all the assignments\n"); 
-#endif
-	 return DLL_SUCCESS;                          //return successfully
-    } 
+    dll_code add_rc=dll_list_add(&list, position, data);
+    *head=list.head;
+    return add_rc;
 }	
 
 
@@ -164,13 +308,15 @@ dll_code dll_destroy(dll_node_ptr head)
  * -----------------------------------------------------------------------------
  * Description:  Removes node from the dll safely at a given index.
  *               
- * Working:      Takes a ptr to the head and traverses the dll to reach 
- *               position-1, grabs node at position and frees its memory. Links 
+ * Working:      Position zero unlinks the head directly without walking the
+ *               dll. Any other position wraps the dll in a header and calls
+ *               dll_list_remove, which grabs the node at position and frees
+ *               its memory. Links 
  *               node before and after position safely. Returns node data in
- *               the pointer passed.
+ *               the pointer passed. Removing the only node sets *head to NULL.
  * 
  * Returns:      Error codes:
- *               DLL_NULL_PTR: The pointer passed to the function is a
+ *               DLL_NULL_PTR: A pointer passed to the function is a
  *               NULL and is thus invalid. The function halts execution and 
  *               returns.
  *
@@ -188,58 +334,58 @@ dll_code dll_remove_node(dll_node_ptr* head, uint32_t position, uint32_t* data)
     if(*head==NULL)
 	 return DLL_NULL_PTR;
 
+    if(data==NULL)
+	 return DLL_NULL_PTR;
 
-    dll_node_ptr tmp_head=*head;                                                 //assign head to temp variable
-
-    /*handle position equals zero case*/	 
+    /*handle position equals zero case without a walk*/
     if(position==0)
     {
-         *data=tmp_head->data;                                                  //get node data in the input pointer parameter
+         dll_node_ptr old_head=*head;
+         *data=old_head->data;                                                  //get node data in the input pointer parameter
 
-	 if((*head)->next_ptr!=NULL)                                               //if the next is NULL, the size is 1
-	 {    
-	      *head=(*head)->next_ptr;
+	 *head=old_head->next_ptr;                                              //NULL once the last node goes
+	 if(*head!=NULL)
 	      (*head)->prev_ptr=NULL;
-	 }
 
-	 free(tmp_head);
+	 free(old_head);
 	 return DLL_SUCCESS;
     }
-    
-    /*check if given position is valid*/
-    uint32_t size;
-    dll_code size_rc=dll_size(tmp_head, &size);
 
-    if(size_rc!=DLL_NULL_PTR)                                                   //only fail rc for dll_size
-    {
-         if(position>size-1)                                                    //the position cannot be 2 for a dll of size 2; position starts from 0
-              return DLL_BAD_POSITION;
-    }    
-    else
-	 return DLL_NULL_PTR;
+    /*wrap the bare dll in a header and let dll_list_remove do the work*/
+    dll_list list;
+    dll_list_wrap(*head, &list);
 
+    dll_code remove_rc=dll_list_remove(&list, position, data);
+    *head=list.head;
+    return remove_rc;
+}
 
-    uint32_t index;                                                             //loop variable
-    
-    /*reach node of position-1*/
-    for(index=0; index<position-1; index++)
-         tmp_head=tmp_head->next_ptr;
-    
-    /*store the node to be deleted*/
-    dll_node_ptr delete_node=tmp_head->next_ptr;  
-    
-    /*get node data in the input parameter*/
-    *data=delete_node->data;
-
-    /*link the previous and the next node of the node to be deleted appropriately*/
-    tmp_head->next_ptr=delete_node->next_ptr;
-    
-    if(delete_node->next_ptr!=NULL)                                             //complete this only if the next node is not NULL
-         (delete_node->next_ptr)->prev_ptr=tmp_head;
+/*								                
+ * Function:     dll_get(dll_node_ptr head, uint32_t position, uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the data of the node at position in *data.
+ *               
+ * Working:      Wraps the dll in a header and calls dll_list_get.
+ * 
+ * Returns:      Error codes:
+ *               DLL_NULL_PTR: A pointer passed to the function is a
+ *               NULL and is thus invalid.
+ *
+ *               DLL_BAD_POSITION: There is no node at position.
+ *
+ *               DLL_SUCCESS: The function completes execution successfully   
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_get(dll_node_ptr head, uint32_t position, uint32_t* data)
+{
+    //basic pointer check; error handling	
+    if(head==NULL)
+	 return DLL_NULL_PTR;
 
-    free(delete_node);
+    dll_list list;
+    dll_list_wrap(head, &list);
 
-    return DLL_SUCCESS;
+    return dll_list_get(&list, position, data);
 }
 
 /*								                
@@ -394,3 +540,312 @@ dll_code dll_dump(dll_node_ptr head, FILE *fp)
     /*return successfully*/
     return DLL_SUCCESS;
 }
+
+/*								                
+ * Function:     dll_list_create(dll_list_ptr* list, dll_pool_ptr pool, uint32_t own_pool)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates an empty dll header on the heap that takes its nodes
+ *               from pool, or from malloc if pool is NULL.
+ * ----------------------------------------------------------------------------
+ */
+static dll_code dll_list_create(dll_list_ptr* list, dll_pool_ptr pool, uint32_t own_pool)
+{
+    dll_list_ptr new_list=(dll_list_ptr)malloc(sizeof(dll_list));          //allocate memory
+    if(new_list==NULL)
+         return DLL_MALLOC_FAIL;
+
+    new_list->head=NULL;
+    new_list->tail=NULL;
+    new_list->count=0;
+    new_list->pool=pool;
+    new_list->own_pool=own_pool;
+
+    *list=new_list;
+    return DLL_SUCCESS;
+}
+
+/*								                
+ * Function:     dll_list_init(dll_list_ptr* list)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates an empty dll header on the heap whose nodes come
+ *               from malloc.
+ *
+ * Returns:      Error codes:
+ *               DLL_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               DLL_MALLOC_FAIL: The call to malloc fails.
+ *
+ *               DLL_SUCCESS: The funcion returns successfully.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_init(dll_list_ptr* list)
+{
+    //basic pointer check; error handling	
+    if(list==NULL)
+         return DLL_NULL_PTR;
+
+    return dll_list_create(list, NULL, 0);
+}
+
+/*								                
+ * Function:     dll_list_init_pool(dll_list_ptr* list, uint32_t slab_nodes)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates a pool and an empty dll header that owns it.
+ *
+ * Returns:      DLL_NULL_PTR, DLL_MALLOC_FAIL or DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_init_pool(dll_list_ptr* list, uint32_t slab_nodes)
+{
+    //basic pointer check; error handling	
+    if(list==NULL)
+         return DLL_NULL_PTR;
+
+    dll_pool_ptr pool;
+    dll_code pool_rc=dll_pool_init(&pool, slab_nodes);
+    if(pool_rc!=DLL_SUCCESS)
+         return pool_rc;
+
+    dll_code list_rc=dll_list_create(list, pool, 1);
+    if(list_rc!=DLL_SUCCESS)
+         dll_pool_destroy(pool);                                               //do not leak the pool
+
+    return list_rc;
+}
+
+/*								                
+ * Function:     dll_list_init_shared(dll_list_ptr* list, dll_pool_ptr pool)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates an empty dll header that uses the caller's pool.
+ *
+ * Returns:      DLL_NULL_PTR, DLL_MALLOC_FAIL or DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_init_shared(dll_list_ptr* list, dll_pool_ptr pool)
+{
+    //basic pointer check; error handling	
+    if(list==NULL||pool==NULL)
+         return DLL_NULL_PTR;
+
+    return dll_list_create(list, pool, 0);
+}
+
+/*								                
+ * Function:     dll_list_destroy(dll_list_ptr list)
+ * -----------------------------------------------------------------------------
+ * Description:  De-allocates all the nodes of the dll and the header itself.
+ *
+ * Returns:      DLL_NULL_PTR or DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_destroy(dll_list_ptr list)
+{
+    //basic pointer check; error handling	
+    if(list==NULL)
+         return DLL_NULL_PTR;
+
+    if(list->pool==NULL)
+    {
+         if(list->head!=NULL)
+              dll_destroy(list->head);
+    }
+    else if(list->own_pool)
+         dll_pool_destroy(list->pool);                                         //every node goes with its slab
+    else if(list->head!=NULL)
+    {
+         /*the dll is already chained through next_ptr- splice it onto the free list*/
+         list->tail->next_ptr=list->pool->free_list;
+	 list->pool->free_list=list->head;
+    }
+    free(list);
+
+    return DLL_SUCCESS;
+}
+
+/*								                
+ * Function:     dll_list_add(dll_list_ptr list, uint32_t position, uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Links a new node in before the node at position, or after the
+ *               tail if position equals the size.
+ *
+ * Returns:      DLL_NULL_PTR, DLL_BAD_POSITION, DLL_MALLOC_FAIL or DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_add(dll_list_ptr list, uint32_t position, uint32_t data)
+{
+    //basic pointer check; error handling	
+    if(list==NULL)
+         return DLL_NULL_PTR;
+    if(position>list->count)                                                   //position equal to the size appends
+         return DLL_BAD_POSITION;
+
+    if(position==list->count)
+         return dll_list_link(list, NULL, data);
+
+    return dll_list_link(list, dll_list_seek(list, position), data);
+}
+
+/*								                
+ * Function:     dll_list_remove(dll_list_ptr list, uint32_t position, uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Unlinks and frees the node at position, returning its data.
+ *
+ * Returns:      DLL_NULL_PTR, DLL_BAD_POSITION or DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_remove(dll_list_ptr list, uint32_t position, uint32_t* data)
+{
+    //basic pointer check; error handling	
+    if(list==NULL||data==NULL)
+         return DLL_NULL_PTR;
+    if(position>=list->count)                                                  //position starts from 0
+         return DLL_BAD_POSITION;
+
+    dll_list_unlink(list, dll_list_seek(list, position), data);
+    return DLL_SUCCESS;
+}
+
+/*								                
+ * Function:     dll_list_get(dll_list_ptr list, uint32_t position, uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the data of the node at position in *data.
+ *
+ * Returns:      DLL_NULL_PTR, DLL_BAD_POSITION or DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_get(dll_list_ptr list, uint32_t position, uint32_t* data)
+{
+    //basic pointer check; error handling	
+    if(list==NULL||data==NULL)
+         return DLL_NULL_PTR;
+    if(position>=list->count)                                                  //position starts from 0
+         return DLL_BAD_POSITION;
+
+    *data=dll_list_seek(list, position)->data;
+    return DLL_SUCCESS;
+}
+
+/*								                
+ * Function:     dll_list_push_front(dll_list_ptr list, uint32_t data)
+ *               dll_list_push_back(dll_list_ptr list, uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Link a new node in before the head or after the tail.
+ *
+ * Returns:      DLL_NULL_PTR, DLL_MALLOC_FAIL or DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_push_front(dll_list_ptr list, uint32_t data)
+{
+    if(list==NULL)
+         return DLL_NULL_PTR;
+
+    return dll_list_link(list, list->head, data);
+}
+
+dll_code dll_list_push_back(dll_list_ptr list, uint32_t data)
+{
+    if(list==NULL)
+         return DLL_NULL_PTR;
+
+    return dll_list_link(list, NULL, data);
+}
+
+/*								                
+ * Function:     dll_list_pop_front(dll_list_ptr list, uint32_t* data)
+ *               dll_list_pop_back(dll_list_ptr list, uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Unlink and free the head or the tail, returning its data.
+ *
+ * Returns:      DLL_NULL_PTR, DLL_BAD_POSITION or DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_pop_front(dll_list_ptr list, uint32_t* data)
+{
+    if(list==NULL||data==NULL)
+         return DLL_NULL_PTR;
+    if(list->head==NULL)                                                       //nothing to pop
+         return DLL_BAD_POSITION;
+
+    dll_list_unlink(list, list->head, data);
+    return DLL_SUCCESS;
+}
+
+dll_code dll_list_pop_back(dll_list_ptr list, uint32_t* data)
+{
+    if(list==NULL||data==NULL)
+         return DLL_NULL_PTR;
+    if(list->tail==NULL)                                                       //nothing to pop
+         return DLL_BAD_POSITION;
+
+    dll_list_unlink(list, list->tail, data);
+    return DLL_SUCCESS;
+}
+
+/*								                
+ * Function:     dll_list_size(dll_list_ptr list, uint32_t* size)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the count kept in the header in *size.
+ *
+ * Returns:      DLL_NULL_PTR or DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_size(dll_list_ptr list, uint32_t* size)
+{
+    if(list==NULL||size==NULL)
+         return DLL_NULL_PTR;
+
+    *size=list->count;
+    return DLL_SUCCESS;
+}
+
+/*								                
+ * Function:     dll_pool_init(dll_pool_ptr* pool, uint32_t slab_nodes)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates an empty node pool on the heap.
+ *
+ * Returns:      DLL_NULL_PTR, DLL_MALLOC_FAIL or DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_pool_init(dll_pool_ptr* pool, uint32_t slab_nodes)
+{
+    //basic pointer check; error handling	
+    if(pool==NULL)
+         return DLL_NULL_PTR;
+
+    dll_pool_ptr new_pool=(dll_pool_ptr)malloc(sizeof(dll_pool));          //allocate memory
+    if(new_pool==NULL)
+         return DLL_MALLOC_FAIL;
+
+    new_pool->slabs=NULL;
+    new_pool->free_list=NULL;
+    new_pool->slab_nodes=(slab_nodes!=0)?slab_nodes:DLL_POOL_SLAB_NODES;
+
+    *pool=new_pool;
+    return DLL_SUCCESS;
+}
+
+/*								                
+ * Function:     dll_pool_destroy(dll_pool_ptr pool)
+ * -----------------------------------------------------------------------------
+ * Description:  Frees the slabs of the pool and the pool itself.
+ *
+ * Returns:      DLL_NULL_PTR or DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_pool_destroy(dll_pool_ptr pool)
+{
+    //basic pointer check; error handling	
+    if(pool==NULL)
+         return DLL_NULL_PTR;
+
+    dll_slab_ptr slab=pool->slabs;
+    while(slab!=NULL)
+    {
+         dll_slab_ptr next_slab=slab->next_slab;
+	 free(slab);
+	 slab=next_slab;
+    }
+    free(pool);
+
+    return DLL_SUCCESS;
+}
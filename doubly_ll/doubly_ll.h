@@ -39,6 +39,79 @@ typedef struct dll_node
 }dll_node;
 
 
+/*default number of nodes in a slab of a dll_pool*/
+#define DLL_POOL_SLAB_NODES 256
+
+
+/*								                
+ * Structure:    dll node slab
+ * -----------------------------------------------------------------------------
+ * Description:  One block of nodes grabbed by a dll_pool with a single call to
+ *               malloc. The slabs of a pool are chained through next_slab so
+ *               that they can all be freed when the pool goes.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct dll_slab *dll_slab_ptr;
+
+typedef struct dll_slab
+{
+    dll_slab_ptr next_slab;
+    dll_node nodes[];
+}dll_slab;
+
+
+/*								                
+ * Structure:    dll node pool
+ * -----------------------------------------------------------------------------
+ * Description:  Hands out nodes to dll_list headers in place of malloc and
+ *               takes them back in place of free. Free nodes are kept on
+ *               free_list, chained through their next_ptr, and a new slab of
+ *               slab_nodes nodes is grabbed only when the free list is empty.
+ *               Nothing is returned to the heap until dll_pool_destroy.
+ *
+ * Usage:        A pool is not locked. Give each thread its own pool and only
+ *               create lists on it from that thread. Do not access the members
+ *               directly.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct dll_pool *dll_pool_ptr;
+
+typedef struct dll_pool
+{
+    dll_slab_ptr slabs;
+    dll_node_ptr free_list;
+    uint32_t slab_nodes;
+}dll_pool;
+
+
+/*								                
+ * Structure:    doubly linked list(dll) header
+ * -----------------------------------------------------------------------------
+ * Description:  Owns the nodes of one dll and keeps its head, its tail and the
+ *               number of nodes in it, so that the size and both ends are
+ *               reached without walking the list.
+ *           
+ * Usage:        Create it with dll_list_init and use the dll_list_* functions
+ *               below; do not modify the members directly. The head member is
+ *               an ordinary dll, so it can be passed to dll_search or dll_dump.
+ *               The nodes come from malloc, or from 'pool' if the header was
+ *               created with dll_list_init_pool or dll_list_init_shared; the
+ *               head pointer functions that add or remove nodes must not be
+ *               used on the nodes of a pooled dll.
+ * ----------------------------------------------------------------------------
+ */
+typedef struct dll_list *dll_list_ptr;
+
+typedef struct dll_list
+{
+    dll_node_ptr head;
+    dll_node_ptr tail;
+    uint32_t count;
+    dll_pool_ptr pool;
+    uint32_t own_pool;
+}dll_list;
+
+
 
 /*								                
  * Function:     dll_add_node(dll_node_ptr* head, uint32_t data, uint32_t position)
@@ -111,6 +184,26 @@ dll_code dll_destroy(dll_node_ptr head);
 dll_code dll_remove_node(dll_node_ptr* head, uint32_t position, uint32_t* data);
 
 
+/*								                
+ * Function:     dll_get(dll_node_ptr head, uint32_t position, uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the data of the node at position in *data without
+ *               modifying the dll.
+ *               
+ * Returns:      Error codes:
+ *               DLL_NULL_PTR: A pointer passed to the function is a
+ *               NULL and is thus invalid. The function halts execution and 
+ *               returns.
+ *
+ *               DLL_BAD_POSITION: The dll's size is lesser than or equal to
+ *               the position specified.
+ *
+ *               DLL_SUCCESS: The function completes execution successfully   
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_get(dll_node_ptr head, uint32_t position, uint32_t* data);
+
+
 /*								                
  * Function:     dll_size(dll_node_ptr head, uint32_t* size)
  * -----------------------------------------------------------------------------
@@ -158,4 +251,201 @@ dll_code dll_size(dll_node_ptr head, uint32_t* size);
 dll_code dll_search(dll_node_ptr head, uint32_t data, uint32_t* position);
 /*add some documentation soon*/
 dll_code dll_dump(dll_node_ptr head, FILE* fp);
+
+
+/*								                
+ * Function:     dll_list_init(dll_list_ptr* list)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates an empty dll header on the heap.
+ *           
+ * Usage:        Pass a pointer to a dll_list_ptr; it points to the new header
+ *               on success.
+ * 
+ * Returns:      Error codes:
+ *               DLL_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               DLL_MALLOC_FAIL: The call to malloc fails.
+ *
+ *               DLL_SUCCESS: The funcion returns successfully.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_init(dll_list_ptr* list);
+
+/*								                
+ * Function:     dll_list_init_pool(dll_list_ptr* list, uint32_t slab_nodes)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates an empty dll header with a pool of its own that
+ *               grabs slab_nodes nodes at a time; zero takes
+ *               DLL_POOL_SLAB_NODES. Removed nodes are recycled for later
+ *               adds, and dll_list_destroy frees the slabs without walking
+ *               the dll.
+ * 
+ * Returns:      Error codes:
+ *               DLL_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               DLL_MALLOC_FAIL: The call to malloc fails. Nothing is leaked.
+ *
+ *               DLL_SUCCESS: The funcion returns successfully.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_init_pool(dll_list_ptr* list, uint32_t slab_nodes);
+
+/*								                
+ * Function:     dll_list_init_shared(dll_list_ptr* list, dll_pool_ptr pool)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates an empty dll header that takes its nodes from a pool
+ *               created with dll_pool_init, for instance one per thread shared
+ *               by all the lists of that thread. dll_list_destroy hands the
+ *               nodes back to the pool in one step; the pool must outlive the
+ *               dll.
+ * 
+ * Returns:      Error codes:
+ *               DLL_NULL_PTR: A pointer passed is a NULL.
+ *
+ *               DLL_MALLOC_FAIL: The call to malloc fails.
+ *
+ *               DLL_SUCCESS: The funcion returns successfully.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_init_shared(dll_list_ptr* list, dll_pool_ptr pool);
+
+/*								                
+ * Function:     dll_list_destroy(dll_list_ptr list)
+ * -----------------------------------------------------------------------------
+ * Description:  De-allocates all the nodes of the dll and the header itself.
+ *               Nodes from malloc are freed one by one, a pool of the dll's
+ *               own is freed slab by slab, and the nodes of a shared pool are
+ *               handed back to it.
+ * 
+ * Returns:      Error codes:
+ *               DLL_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               DLL_SUCCESS: The function completes execution successfully.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_destroy(dll_list_ptr list);
+
+/*								                
+ * Function:     dll_list_add(dll_list_ptr list, uint32_t position, uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Adds a new node holding data at position, exactly like
+ *               dll_add_node. Position zero is the head and position equal to
+ *               the size is the end; neither walks the list. Any other
+ *               position is reached from whichever end is closer.
+ * 
+ * Returns:      Error codes:
+ *               DLL_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               DLL_BAD_POSITION: The position is greater than the size.
+ *
+ *               DLL_MALLOC_FAIL: The call to malloc fails.
+ *
+ *               DLL_SUCCESS: The funcion returns successfully.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_add(dll_list_ptr list, uint32_t position, uint32_t data);
+
+/*								                
+ * Function:     dll_list_remove(dll_list_ptr list, uint32_t position, uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Removes the node at position and returns its data in *data,
+ *               exactly like dll_remove_node. The node is reached from
+ *               whichever end is closer, so the head and the last node are
+ *               removed without walking the list.
+ * 
+ * Returns:      Error codes:
+ *               DLL_NULL_PTR: A pointer passed is a NULL.
+ *
+ *               DLL_BAD_POSITION: There is no node at position; this
+ *               includes every position of an empty dll.
+ *
+ *               DLL_SUCCESS: The function completes execution successfully.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_remove(dll_list_ptr list, uint32_t position, uint32_t* data);
+
+/*								                
+ * Function:     dll_list_get(dll_list_ptr list, uint32_t position, uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the data of the node at position in *data, exactly
+ *               like dll_get. Walks from whichever end is closer, so at most
+ *               half the dll.
+ * 
+ * Returns:      Error codes:
+ *               DLL_NULL_PTR: A pointer passed is a NULL.
+ *
+ *               DLL_BAD_POSITION: There is no node at position.
+ *
+ *               DLL_SUCCESS: The function completes execution successfully.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_get(dll_list_ptr list, uint32_t position, uint32_t* data);
+
+/*								                
+ * Function:     dll_list_push_front(dll_list_ptr list, uint32_t data)
+ *               dll_list_push_back(dll_list_ptr list, uint32_t data)
+ * -----------------------------------------------------------------------------
+ * Description:  Add a new node holding data before the head or after the
+ *               tail. O(1).
+ * 
+ * Returns:      DLL_NULL_PTR, DLL_MALLOC_FAIL or DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_push_front(dll_list_ptr list, uint32_t data);
+dll_code dll_list_push_back(dll_list_ptr list, uint32_t data);
+
+/*								                
+ * Function:     dll_list_pop_front(dll_list_ptr list, uint32_t* data)
+ *               dll_list_pop_back(dll_list_ptr list, uint32_t* data)
+ * -----------------------------------------------------------------------------
+ * Description:  Remove the head or the tail and return its data in *data.
+ *               O(1).
+ * 
+ * Returns:      DLL_NULL_PTR, DLL_BAD_POSITION when the dll is empty, or
+ *               DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_pop_front(dll_list_ptr list, uint32_t* data);
+dll_code dll_list_pop_back(dll_list_ptr list, uint32_t* data);
+
+/*								                
+ * Function:     dll_list_size(dll_list_ptr list, uint32_t* size)
+ * -----------------------------------------------------------------------------
+ * Description:  Returns the number of nodes in the dll in *size. Reads the
+ *               count kept in the header, so it is O(1), unlike dll_size.
+ * 
+ * Returns:      DLL_NULL_PTR or DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_list_size(dll_list_ptr list, uint32_t* size);
+
+
+/*								                
+ * Function:     dll_pool_init(dll_pool_ptr* pool, uint32_t slab_nodes)
+ * -----------------------------------------------------------------------------
+ * Description:  Allocates an empty node pool that grabs slab_nodes nodes at a
+ *               time; zero takes DLL_POOL_SLAB_NODES. No slab is grabbed
+ *               until the first node is needed.
+ * 
+ * Returns:      Error codes:
+ *               DLL_NULL_PTR: The pointer passed is a NULL.
+ *
+ *               DLL_MALLOC_FAIL: The call to malloc fails.
+ *
+ *               DLL_SUCCESS: The funcion returns successfully.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_pool_init(dll_pool_ptr* pool, uint32_t slab_nodes);
+
+/*								                
+ * Function:     dll_pool_destroy(dll_pool_ptr pool)
+ * -----------------------------------------------------------------------------
+ * Description:  Frees every slab of the pool and the pool itself. The nodes of
+ *               any dll still using the pool go with it; destroy those headers
+ *               first.
+ * 
+ * Returns:      DLL_NULL_PTR or DLL_SUCCESS.
+ * ----------------------------------------------------------------------------
+ */
+dll_code dll_pool_destroy(dll_pool_ptr pool);
 #endif
@@ -1,10 +1,12 @@
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
 #include "doubly_ll.h"
 #include "Unity/src/unity.h"
 
 #define FILE_NAME "results.txt"
 #define NON_ZERO_VALUE 12
+#define BARE_FRONT_SIZE 200000
 
 
 FILE *fp;
@@ -430,6 +432,240 @@ void test_dump(void)
     TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_NULL_PTR, dll_dump(NULL, fp), "rc!=DLL_NULL_PTR when null ptr is passed as head"); 
 }
 
+/*walk the dll both ways and compare it against the expected contents*/
+void check_list(dll_list_ptr list, uint32_t* expected, uint32_t expected_size)
+{
+    uint32_t size, index;
+    dll_node_ptr node;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_size(list, &size), "Something's wrong with the list size function");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(expected_size, size, "the count kept in the header is incorrect");
+
+    node=list->head;
+    for(index=0; index<expected_size; index++, node=node->next_ptr)
+	 TEST_ASSERT_EQUAL_INT_MESSAGE(expected[index], node->data, "the dll read from the head is incorrect");
+    TEST_ASSERT_NULL_MESSAGE(node, "the dll is longer than its count");
+
+    node=list->tail;
+    for(index=expected_size; index>0; index--, node=node->prev_ptr)
+	 TEST_ASSERT_EQUAL_INT_MESSAGE(expected[index-1], node->data, "the dll read from the tail is incorrect");
+    TEST_ASSERT_NULL_MESSAGE(node, "the prev links do not end at the head");
+}
+
+void test_list(void)
+{
+    dll_list_ptr list=NULL;
+    uint32_t expected[64], expected_size=0, data, position;
+    int index;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_NULL_PTR, dll_list_init(NULL), "rc!=DLL_NULL_PTR when a NULL is passed");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_init(&list), "Fails to create an empty dll header");
+    check_list(list, expected, 0);
+
+    /*popping an empty dll is a bad position*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_BAD_POSITION, dll_list_pop_front(list, &data), "pops from an empty dll");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_BAD_POSITION, dll_list_pop_back(list, &data), "pops from an empty dll");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_BAD_POSITION, dll_list_remove(list, 0, &data), "removes from an empty dll");
+
+    /*push at both ends*/
+    for(index=0; index<8; index++)
+    {
+	 TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_push_back(list, 100+index), "Fails to push at the back");
+	 expected[8+index]=100+index;
+	 TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_push_front(list, 99-index), "Fails to push at the front");
+	 expected[7-index]=99-index;
+    }
+    expected_size=16;
+    check_list(list, expected, expected_size);
+
+    /*add and remove at random positions, including both ends*/
+    for(index=0; index<200; index++)
+    {
+	 if(expected_size<32&&(random()%2||expected_size==0))
+	 {
+	      position=random()%(expected_size+1);
+	      data=random()%1000;
+	      TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_add(list, position, data), "Fails to add at a valid position");
+	      memmove(expected+position+1, expected+position, sizeof(uint32_t)*(expected_size-position));
+	      expected[position]=data;
+	      expected_size++;
+	 }
+	 else
+	 {
+	      position=random()%expected_size;
+	      TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_remove(list, position, &data), "Fails to remove at a valid position");
+	      TEST_ASSERT_EQUAL_INT_MESSAGE(expected[position], data, "removes the wrong node");
+	      memmove(expected+position, expected+position+1, sizeof(uint32_t)*(expected_size-position-1));
+	      expected_size--;
+	 }
+	 check_list(list, expected, expected_size);
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_BAD_POSITION, dll_list_add(list, expected_size+1, 0), "adds beyond the end of the dll");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_BAD_POSITION, dll_list_remove(list, expected_size, &data), "removes beyond the end of the dll");
+
+    /*pop everything off, alternating ends*/
+    while(expected_size>0)
+    {
+	 if(expected_size%2)
+	 {
+	      TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_pop_back(list, &data), "Fails to pop at the back");
+	      TEST_ASSERT_EQUAL_INT_MESSAGE(expected[expected_size-1], data, "pops the wrong node at the back");
+	 }
+	 else
+	 {
+	      TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_pop_front(list, &data), "Fails to pop at the front");
+	      TEST_ASSERT_EQUAL_INT_MESSAGE(expected[0], data, "pops the wrong node at the front");
+	      memmove(expected, expected+1, sizeof(uint32_t)*(expected_size-1));
+	 }
+	 expected_size--;
+	 check_list(list, expected, expected_size);
+    }
+
+    /*the bare head functions remove the last node cleanly*/
+    dll_node_ptr head=NULL;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_add_node(&head, 0, 7), "Fails to create new dll when it does not exist");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_remove_node(&head, 0, &data), "Fails to remove the only node");
+    TEST_ASSERT_NULL_MESSAGE(head, "head is left dangling after removing the only node");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_push_back(list, 1), "Fails to push at the back");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_destroy(list), "fails to destroy initialized dll");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_NULL_PTR, dll_list_destroy(NULL), "rc!=DLL_NULL_PTR when a dll that DNE is tried to be destroyed");
+}
+
+void test_get(void)
+{
+    dll_list_ptr list=NULL;
+    uint32_t data, position;
+    int index;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_init(&list), "Fails to create an empty dll header");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_BAD_POSITION, dll_list_get(list, 0, &data), "gets from an empty dll");
+
+    /*odd and even sizes put the middle on different sides of the halfway mark*/
+    for(index=0; index<17; index++)
+    {
+	 TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_push_back(list, index*5), "Fails to push at the back");
+	 for(position=0; position<=(uint32_t)index; position++)
+	 {
+	      TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_get(list, position, &data), "Fails to get at a valid position");
+	      TEST_ASSERT_EQUAL_INT_MESSAGE(position*5, data, "gets the wrong node");
+	 }
+	 TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_BAD_POSITION, dll_list_get(list, index+1, &data), "gets beyond the end of the dll");
+    }
+
+    /*insert and remove near the tail, which is now reached from the back*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_add(list, 15, 999), "Fails to add near the end");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_get(list, 15, &data), "Fails to get at a valid position");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(999, data, "the node added near the end is not where it should be");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_get(list, 16, &data), "Fails to get at a valid position");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(75, data, "the nodes after the one added moved wrongly");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_remove(list, 16, &data), "Fails to remove near the end");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(75, data, "removes the wrong node");
+
+    /*the bare head version*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_get(list->head, 14, &data), "Fails to get at a valid position");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(70, data, "gets the wrong node");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_BAD_POSITION, dll_get(list->head, 17, &data), "gets beyond the end of the dll");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_NULL_PTR, dll_get(NULL, 0, &data), "rc!=DLL_NULL_PTR when the dll DNE");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_NULL_PTR, dll_get(list->head, 0, NULL), "rc!=DLL_NULL_PTR when arguments are invalid");
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_destroy(list), "fails to destroy initialized dll");
+}
+
+void test_pool(void)
+{
+    dll_list_ptr list=NULL, other=NULL;
+    dll_pool_ptr pool=NULL;
+    uint32_t expected[64], expected_size=0, data, position;
+    int index;
+
+    /*a pool of its own, with small slabs so that several are grabbed*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_NULL_PTR, dll_list_init_pool(NULL, 4), "rc!=DLL_NULL_PTR when a NULL is passed");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_init_pool(&list, 4), "Fails to create a pooled dll");
+    for(index=0; index<500; index++)
+    {
+	 if(expected_size<64&&(random()%2||expected_size==0))
+	 {
+	      position=random()%(expected_size+1);
+	      data=random()%1000;
+	      TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_add(list, position, data), "Fails to add at a valid position");
+	      memmove(expected+position+1, expected+position, sizeof(uint32_t)*(expected_size-position));
+	      expected[position]=data;
+	      expected_size++;
+	 }
+	 else
+	 {
+	      position=random()%expected_size;
+	      TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_remove(list, position, &data), "Fails to remove at a valid position");
+	      TEST_ASSERT_EQUAL_INT_MESSAGE(expected[position], data, "removes the wrong node");
+	      memmove(expected+position, expected+position+1, sizeof(uint32_t)*(expected_size-position-1));
+	      expected_size--;
+	 }
+	 check_list(list, expected, expected_size);
+    }
+
+    /*a removed node is the next one handed out*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_push_back(list, 1), "Fails to push at the back");
+    dll_node_ptr recycled=list->tail;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_pop_back(list, &data), "Fails to pop at the back");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_push_front(list, 2), "Fails to push at the front");
+    TEST_ASSERT_TRUE_MESSAGE(recycled==list->head, "the pool does not recycle removed nodes");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_destroy(list), "fails to destroy a pooled dll");
+
+    /*a shared pool, as one per thread would be*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_NULL_PTR, dll_pool_init(NULL, 0), "rc!=DLL_NULL_PTR when a NULL is passed");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_pool_init(&pool, 0), "Fails to create a pool");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_NULL_PTR, dll_list_init_shared(&list, NULL), "rc!=DLL_NULL_PTR when the pool DNE");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_init_shared(&list, pool), "Fails to create a dll on a shared pool");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_init_shared(&other, pool), "Fails to create a dll on a shared pool");
+    for(index=0; index<300; index++)
+    {
+	 TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_push_back(list, index), "Fails to push at the back");
+	 TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_push_front(other, index), "Fails to push at the front");
+    }
+    dll_slab_ptr slabs=pool->slabs;
+    recycled=list->head;
+
+    /*destroying one dll hands its nodes back without freeing them*/
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_destroy(list), "fails to destroy a dll on a shared pool");
+    TEST_ASSERT_TRUE_MESSAGE(recycled==pool->free_list, "the nodes of the destroyed dll are not back in the pool");
+    for(index=0; index<300; index++)
+	 TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_push_back(other, index), "Fails to push at the back");
+    TEST_ASSERT_TRUE_MESSAGE(slabs==pool->slabs, "grabs a new slab while the pool has free nodes");
+
+    for(index=0; index<300; index++)
+    {
+	 TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_pop_front(other, &data), "Fails to pop at the front");
+	 TEST_ASSERT_EQUAL_INT_MESSAGE(299-index, data, "pops the wrong node at the front");
+    }
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_list_destroy(other), "fails to destroy a dll on a shared pool");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_pool_destroy(pool), "fails to destroy a pool");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_NULL_PTR, dll_pool_destroy(NULL), "rc!=DLL_NULL_PTR when a pool that DNE is tried to be destroyed");
+}
+
+void test_bare_front(void)
+{
+    dll_node_ptr head=NULL;
+    uint32_t index, size, data;
+
+    /*building a long bare dll at the front must not walk it on every add*/
+    for(index=0; index<BARE_FRONT_SIZE; index++)
+	 TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_add_node(&head, 0, index), "Fails to add nodes at the start");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_size(head, &size), "Something's wrong with the size function");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(BARE_FRONT_SIZE, size, "the size returned is incorrect");
+    TEST_ASSERT_NULL_MESSAGE(head->prev_ptr, "the head has a previous node");
+    TEST_ASSERT_TRUE_MESSAGE(head->next_ptr->prev_ptr==head, "the old head is not linked back to the new one");
+
+    /*and emptying it from the front*/
+    for(index=0; index<BARE_FRONT_SIZE; index++)
+    {
+	 TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_SUCCESS, dll_remove_node(&head, 0, &data), "Fails to remove nodes from the start");
+	 TEST_ASSERT_EQUAL_INT_MESSAGE(BARE_FRONT_SIZE-1-index, data, "removes the wrong node at the start");
+    }
+    TEST_ASSERT_NULL_MESSAGE(head, "head is left dangling after removing the only node");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(DLL_NULL_PTR, dll_remove_node(&head, 0, &data), "rc!=DLL_NULL_PTR when remove from a non existant dll is requested");
+}
+
 int main()
 {
     fp=fopen(FILE_NAME, "a");
@@ -450,6 +686,14 @@ int main()
 
     fprintf(fp, "\n\nUnit test for the dump function:\n\n");
     RUN_TEST(test_dump);
+
+    RUN_TEST(test_list);
+
+    RUN_TEST(test_get);
+
+    RUN_TEST(test_pool);
+
+    RUN_TEST(test_bare_front);
     
     fclose(fp);
     return UNITY_END();